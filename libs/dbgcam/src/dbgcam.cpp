@@ -1,27 +1,338 @@
-#include <iostream>
+/*********************************************************************
+ * @file  dbgcam.cpp
+ *
+ * @brief Synthetic PVCAM camera used for development without hardware.
+ *
+ * pl_exp_start_cont starts a timer thread that renders frames into the
+ * circular buffer supplied by the caller, fills in FRAME_INFO and fires the
+ * EOF callback registered with pl_cam_register_callback_ex3, the same
+ * sequence a real camera produces. All output is deterministic for a given
+ * configuration so runs can be compared against each other.
+ *
+ * Configuration is read from the environment when the camera is opened:
+ *   DBGCAM_WIDTH, DBGCAM_HEIGHT   sensor size in pixels (2200x2200)
+ *   DBGCAM_BITDEPTH               sensor bit depth, 1-16 (12)
+ *   DBGCAM_FPS                    frame rate, 0 derives it from the exposure time (0)
+ *   DBGCAM_PATTERN                ramp, noise or wells (wells)
+ *   DBGCAM_WELL_ROWS, _COLS       well grid used by the wells pattern (4x6)
+ *   DBGCAM_SEED                   seed for the noise pattern (1)
+ *   DBGCAM_STALL_EVERY, _MS       delay every Nth EOF callback by MS milliseconds (0, 0)
+ *   DBGCAM_SKIP_EVERY             skip every Nth frame number to emulate drops (0)
+ *********************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <numbers>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <spdlog/spdlog.h>
 
 #include <pvcam/master.h>
 #include <pvcam/pvcam.h>
 
+namespace {
+    enum class Pattern { Ramp, Noise, Wells };
+
+    struct SimConfig {
+        uns16 width{2200};
+        uns16 height{2200};
+        int16 bitDepth{12};
+        double fps{0.0};
+        Pattern pattern{Pattern::Wells};
+        uint32_t wellRows{4};
+        uint32_t wellCols{6};
+        uint64_t seed{1};
+        uint32_t stallEvery{0};
+        uint32_t stallMS{0};
+        uint32_t skipEvery{0};
+    };
+
+    struct SimCamera {
+        SimConfig cfg;
+        std::mutex lock;
+
+        PL_CALLBACK_SIG_EX3 eofCallback{nullptr};
+        void* eofCtx{nullptr};
+
+        //region set by pl_exp_setup_cont
+        uns16 width{0};
+        uns16 height{0};
+        uns32 frameBytes{0};
+        uns32 exposureMS{0};
+        std::vector<int16_t> wellMap;
+
+        //circular buffer set by pl_exp_start_cont
+        uint8_t* buffer{nullptr};
+        size_t slots{0};
+
+        std::thread timer;
+        std::atomic<bool> running{false};
+
+        int64_t latestSlot{-1};
+        FRAME_INFO latestInfo{};
+    };
+
+    SimCamera g_cam;
+    constexpr int16 cSimHandle = 0;
+    constexpr uns16 cSimPixTimeNS = 10;
+    constexpr const char* cSimGainName = "Synthetic";
+
+
+    uint64_t envU64(const char* name, uint64_t def) {
+        const char* v = std::getenv(name);
+        return (v && *v) ? std::strtoull(v, nullptr, 10) : def;
+    }
+
+
+    double envDouble(const char* name, double def) {
+        const char* v = std::getenv(name);
+        return (v && *v) ? std::strtod(v, nullptr) : def;
+    }
+
+
+    SimConfig loadConfig() {
+        SimConfig cfg;
+        cfg.width = static_cast<uns16>(envU64("DBGCAM_WIDTH", cfg.width));
+        cfg.height = static_cast<uns16>(envU64("DBGCAM_HEIGHT", cfg.height));
+        cfg.bitDepth = static_cast<int16>(std::clamp<uint64_t>(envU64("DBGCAM_BITDEPTH", cfg.bitDepth), 1, 16));
+        cfg.fps = envDouble("DBGCAM_FPS", cfg.fps);
+        cfg.wellRows = std::max<uint32_t>(1, envU64("DBGCAM_WELL_ROWS", cfg.wellRows));
+        cfg.wellCols = std::max<uint32_t>(1, envU64("DBGCAM_WELL_COLS", cfg.wellCols));
+        cfg.seed = envU64("DBGCAM_SEED", cfg.seed);
+        cfg.stallEvery = envU64("DBGCAM_STALL_EVERY", cfg.stallEvery);
+        cfg.stallMS = envU64("DBGCAM_STALL_MS", cfg.stallMS);
+        cfg.skipEvery = envU64("DBGCAM_SKIP_EVERY", cfg.skipEvery);
+
+        const char* pattern = std::getenv("DBGCAM_PATTERN");
+        if (pattern) {
+            const std::string p(pattern);
+            if (p == "ramp") { cfg.pattern = Pattern::Ramp; }
+            else if (p == "noise") { cfg.pattern = Pattern::Noise; }
+            else if (p == "wells") { cfg.pattern = Pattern::Wells; }
+            else { spdlog::warn("dbgcam: unknown pattern {}, using wells", p); }
+        }
+        return cfg;
+    }
+
+
+    uint64_t splitmix64(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+
+    /*
+     * Labels each pixel of the region with the index of the well it falls in,
+     * or -1 for background. Wells are discs centered in a rows x cols grid.
+     */
+    void buildWellMap(SimCamera& cam) {
+        const uint32_t rows = cam.cfg.wellRows, cols = cam.cfg.wellCols;
+        const double cellW = double(cam.width) / cols, cellH = double(cam.height) / rows;
+        const double r = 0.35 * std::min(cellW, cellH);
+
+        cam.wellMap.assign(size_t(cam.width) * cam.height, -1);
+        for (uint32_t y = 0; y < cam.height; y++) {
+            const uint32_t wr = std::min<uint32_t>(uint32_t(y / cellH), rows - 1);
+            const double dy = y + 0.5 - (wr + 0.5) * cellH;
+            for (uint32_t x = 0; x < cam.width; x++) {
+                const uint32_t wc = std::min<uint32_t>(uint32_t(x / cellW), cols - 1);
+                const double dx = x + 0.5 - (wc + 0.5) * cellW;
+                if (dx * dx + dy * dy <= r * r) {
+                    cam.wellMap[size_t(y) * cam.width + x] = int16_t(wr * cols + wc);
+                }
+            }
+        }
+    }
+
+
+    template<typename T>
+    void renderFrame(SimCamera& cam, T* out, uint32_t frameNr, double fps) {
+        const uint32_t maxVal = (1u << cam.cfg.bitDepth) - 1;
+        const size_t w = cam.width, h = cam.height;
+
+        switch (cam.cfg.pattern) {
+            case Pattern::Ramp:
+                for (size_t y = 0; y < h; y++) {
+                    for (size_t x = 0; x < w; x++) {
+                        out[y * w + x] = T((x + y + frameNr) & maxVal);
+                    }
+                }
+                break;
+            case Pattern::Noise:
+                {
+                    uint64_t state = cam.cfg.seed ^ (uint64_t(frameNr) << 32);
+                    const size_t n = w * h;
+                    size_t i = 0;
+                    for (; i + 4 <= n; i += 4) {
+                        const uint64_t r = splitmix64(state);
+                        out[i + 0] = T((r >> 0) & maxVal);
+                        out[i + 1] = T((r >> 16) & maxVal);
+                        out[i + 2] = T((r >> 32) & maxVal);
+                        out[i + 3] = T((r >> 48) & maxVal);
+                    }
+                    for (; i < n; i++) {
+                        out[i] = T(splitmix64(state) & maxVal);
+                    }
+                }
+                break;
+            case Pattern::Wells:
+                {
+                    //each well oscillates at its own frequency and phase
+                    const size_t wells = size_t(cam.cfg.wellRows) * cam.cfg.wellCols;
+                    const double t = double(frameNr) / fps;
+                    const T background = T(maxVal / 16);
+                    std::vector<T> levels(wells);
+                    for (size_t i = 0; i < wells; i++) {
+                        const double freq = 0.5 + 0.1 * double(i);
+                        const double phase = double(i) * std::numbers::pi / 7.0;
+                        const double s = 0.5 * (1.0 + std::sin(2.0 * std::numbers::pi * freq * t + phase));
+                        levels[i] = T(maxVal / 4 + s * (maxVal / 2));
+                    }
+
+                    const int16_t* map = cam.wellMap.data();
+                    for (size_t i = 0; i < w * h; i++) {
+                        out[i] = map[i] < 0 ? background : levels[map[i]];
+                    }
+                }
+                break;
+        }
+    }
+
+
+    /*
+     * Timer thread started by pl_exp_start_cont. Renders a frame into the next
+     * slot of the circular buffer on a fixed schedule and fires the EOF callback.
+     */
+    void runTimer() {
+        SimCamera& cam = g_cam;
+        const double fps = cam.cfg.fps > 0.0 ? cam.cfg.fps
+            : (cam.exposureMS > 0 ? 1000.0 / cam.exposureMS : 10.0);
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / fps));
+        const auto start = std::chrono::steady_clock::now();
+        //timestamps are reported in 100ns units
+        auto ticks = [start](std::chrono::steady_clock::time_point tp) {
+            return long64(std::chrono::duration_cast<std::chrono::nanoseconds>(tp - start).count() / 100);
+        };
+
+        spdlog::info("dbgcam: streaming {}x{} {}bit at {} fps into {} slots", cam.width, cam.height, cam.cfg.bitDepth, fps, cam.slots);
+
+        auto next = start;
+        uint64_t produced = 0;
+        int32 frameNr = 0;
+        while (cam.running.load(std::memory_order_acquire)) {
+            const auto bof = next;
+            next += period;
+            std::this_thread::sleep_until(next);
+
+            frameNr++;
+            if (cam.cfg.skipEvery > 0 && frameNr % cam.cfg.skipEvery == 0) {
+                frameNr++;
+            }
+
+            const size_t slot = produced++ % cam.slots;
+            uint8_t* data = cam.buffer + slot * cam.frameBytes;
+            if (cam.cfg.bitDepth > 8) {
+                renderFrame(cam, reinterpret_cast<uint16_t*>(data), uint32_t(frameNr), fps);
+            } else {
+                renderFrame(cam, data, uint32_t(frameNr), fps);
+            }
+
+            FRAME_INFO info{};
+            info.hCam = cSimHandle;
+            info.FrameNr = frameNr;
+            info.TimeStampBOF = ticks(bof);
+            info.TimeStamp = ticks(std::chrono::steady_clock::now());
+            info.ReadoutTime = int32(info.TimeStamp - info.TimeStampBOF);
+
+            PL_CALLBACK_SIG_EX3 callback;
+            void* callbackCtx;
+            {
+                std::lock_guard<std::mutex> lock(cam.lock);
+                cam.latestSlot = int64_t(slot);
+                cam.latestInfo = info;
+                callback = cam.eofCallback;
+                callbackCtx = cam.eofCtx;
+            }
+
+            if (cam.cfg.stallEvery > 0 && frameNr % cam.cfg.stallEvery == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(cam.cfg.stallMS));
+            }
+
+            if (callback) {
+                callback(&info, callbackCtx);
+            }
+        }
+    }
+
+
+    void stopTimer() {
+        g_cam.running.store(false, std::memory_order_release);
+        if (g_cam.timer.joinable()) {
+            g_cam.timer.join();
+        }
+    }
+
+
+    /*
+     * Enum values reported by pl_get_enum_param, one entry per parameter.
+     */
+    bool enumEntry(uns32 param_id, int32& value, const char*& name) {
+        switch (param_id) {
+            case PARAM_EXPOSE_OUT_MODE: value = EXPOSE_OUT_FIRST_ROW; name = "First Row"; return true;
+            case PARAM_EXPOSURE_MODE: value = EXT_TRIG_INTERNAL; name = "Internal Trigger"; return true;
+            case PARAM_CLEAR_MODE: value = CLEAR_PRE_SEQUENCE; name = "Pre-Sequence"; return true;
+            case PARAM_COLOR_MODE: value = COLOR_NONE; name = "Grayscale"; return true;
+            case PARAM_READOUT_PORT: value = READOUT_PORT_0; name = "Sensitivity"; return true;
+            case PARAM_IMAGE_FORMAT:
+                value = g_cam.cfg.bitDepth > 8 ? PL_IMAGE_FORMAT_MONO16 : PL_IMAGE_FORMAT_MONO8;
+                name = g_cam.cfg.bitDepth > 8 ? "Mono16" : "Mono8";
+                return true;
+            default:
+                return false;
+        }
+    }
+}
+
 rs_bool PV_DECL pl_pvcam_init(void) {
     return PV_OK;
 }
 
 
 rs_bool PV_DECL pl_cam_close(int16 hcam) {
+  stopTimer();
   return PV_OK;
 }
 
 rs_bool PV_DECL pl_cam_deregister_callback(int16 hcam, int32 callback_event) {
+  if (callback_event == PL_CALLBACK_EOF) {
+    std::lock_guard<std::mutex> lock(g_cam.lock);
+    g_cam.eofCallback = nullptr;
+    g_cam.eofCtx = nullptr;
+  }
   return PV_OK;
 }
 
 rs_bool PV_DECL pl_cam_open(char* camera_name, int16* hcam, int16 o_mode) {
+  g_cam.cfg = loadConfig();
+  *hcam = cSimHandle;
   return PV_OK;
 }
 
 rs_bool PV_DECL pl_cam_register_callback_ex3(int16 hcam, int32 callback_event, void* callback, void* context) {
+  if (callback_event == PL_CALLBACK_EOF) {
+    std::lock_guard<std::mutex> lock(g_cam.lock);
+    g_cam.eofCallback = reinterpret_cast<PL_CALLBACK_SIG_EX3>(callback);
+    g_cam.eofCtx = context;
+  }
   return PV_OK;
 }
 
@@ -55,7 +366,43 @@ rs_bool PV_DECL pl_cam_get_name(int16 index, char* name) {
 }
 
 rs_bool PV_DECL pl_get_param(int16 hcam, uns32 param_id, int16 param_attribute, void* param_value) {
-  return PV_OK;
+  int32 enumValue;
+  const char* enumName;
+  const bool isEnum = enumEntry(param_id, enumValue, enumName);
+
+  switch (param_attribute) {
+    case ATTR_AVAIL:
+      switch (param_id) {
+        case PARAM_SMART_STREAM_MODE:
+          *static_cast<rs_bool*>(param_value) = FALSE;
+          break;
+        default:
+          *static_cast<rs_bool*>(param_value) = TRUE;
+          break;
+      }
+      return PV_OK;
+    case ATTR_COUNT:
+      *static_cast<uns32*>(param_value) = 1;
+      return PV_OK;
+    case ATTR_CURRENT:
+      switch (param_id) {
+        case PARAM_DD_VERSION: *static_cast<uns16*>(param_value) = 0xFF; break;
+        case PARAM_SER_SIZE: *static_cast<uns16*>(param_value) = g_cam.cfg.width; break;
+        case PARAM_PAR_SIZE: *static_cast<uns16*>(param_value) = g_cam.cfg.height; break;
+        case PARAM_BIT_DEPTH: *static_cast<int16*>(param_value) = g_cam.cfg.bitDepth; break;
+        case PARAM_PIX_TIME: *static_cast<uns16*>(param_value) = cSimPixTimeNS; break;
+        case PARAM_FRAME_CAPABLE: *static_cast<rs_bool*>(param_value) = FALSE; break;
+        case PARAM_GAIN_NAME: strncpy(static_cast<char*>(param_value), cSimGainName, MAX_GAIN_NAME_LEN); break;
+        default:
+          if (isEnum) {
+            *static_cast<int32*>(param_value) = enumValue;
+          }
+          break;
+      }
+      return PV_OK;
+    default:
+      return PV_OK;
+  }
 }
 
 rs_bool PV_DECL pl_pp_reset(int16 hcam) {
@@ -63,6 +410,12 @@ rs_bool PV_DECL pl_pp_reset(int16 hcam) {
 }
 
 rs_bool PV_DECL pl_enum_str_length(int16 hcam, uns32 param_id, uns32 index, uns32* length) {
+  int32 value;
+  const char* name;
+  if (!enumEntry(param_id, value, name)) {
+    return PV_FAIL;
+  }
+  *length = uns32(std::strlen(name) + 1);
   return PV_OK;
 }
 
@@ -74,6 +427,12 @@ rs_bool PV_DECL pl_get_enum_param(
   char* desc,
   uns32 length)
 {
+  const char* name;
+  if (!enumEntry(param_id, *value, name)) {
+    return PV_FAIL;
+  }
+  strncpy(desc, name, length);
+  desc[length - 1] = '\0';
   return PV_OK;
 }
 
@@ -90,11 +449,42 @@ rs_bool PV_DECL pl_exp_setup_cont(
   uns32* exp_bytes,
   int16 buffer_mode)
 {
-  *exp_bytes = 9680000;
+  if (g_cam.running.load()) {
+    return PV_FAIL;
+  }
+
+  const rgn_type& rgn = rgn_array[0];
+  const uns16 sbin = std::max<uns16>(rgn.sbin, 1), pbin = std::max<uns16>(rgn.pbin, 1);
+  const uns16 width = uns16((rgn.s2 - rgn.s1 + 1) / sbin);
+  const uns16 height = uns16((rgn.p2 - rgn.p1 + 1) / pbin);
+  const uns32 bytes = uns32(width) * height * (g_cam.cfg.bitDepth > 8 ? 2 : 1);
+
+  if (width != g_cam.width || height != g_cam.height || g_cam.wellMap.empty()) {
+    g_cam.width = width;
+    g_cam.height = height;
+    buildWellMap(g_cam);
+  }
+  g_cam.frameBytes = bytes;
+  g_cam.exposureMS = exposure_time;
+
+  *exp_bytes = bytes;
   return PV_OK;
 };
 
 rs_bool PV_DECL pl_exp_start_cont(int16 hcam, void* pixel_stream, uns32 size) {
+  if (g_cam.running.load() || g_cam.frameBytes == 0 || size < g_cam.frameBytes) {
+    return PV_FAIL;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(g_cam.lock);
+    g_cam.buffer = static_cast<uint8_t*>(pixel_stream);
+    g_cam.slots = size / g_cam.frameBytes;
+    g_cam.latestSlot = -1;
+  }
+
+  g_cam.running.store(true, std::memory_order_release);
+  g_cam.timer = std::thread(runTimer);
   return PV_OK;
 }
 
@@ -107,14 +497,22 @@ rs_bool pl_error_message(int16 code, char* errMsg) {
 }
 
 rs_bool pl_exp_abort(int16 hcam, int16 cam_state) {
+  stopTimer();
   return true;
 }
 
 rs_bool PV_DECL pl_exp_finish_seq(int16 hcam, void* pixel_stream, int16 hbuf) {
+  stopTimer();
   return true;
 }
 
 rs_bool PV_DECL pl_exp_get_latest_frame_ex(int16 hcam, void** data, FRAME_INFO* frameInfo) {
-    return true;
-}
+    std::lock_guard<std::mutex> lock(g_cam.lock);
+    if (g_cam.latestSlot < 0) {
+        return PV_FAIL;
+    }
 
+    *data = g_cam.buffer + size_t(g_cam.latestSlot) * g_cam.frameBytes;
+    *frameInfo = g_cam.latestInfo;
+    return PV_OK;
+}
@@ -58,6 +58,8 @@ Config::Config(std::filesystem::path cfg, std::filesystem::path profile, cxxopts
         ffmpegDir = toml::find<std::string>(config, "nautilai", "ffmpeg_dir");
         if (userargs.count("ffmpeg_dir")) { ffmpegDir = userargs["ffmpeg_dir"].as<std::string>(); }
 
+        threadPoolThreads = toml::find_or<uint32_t>(config, "nautilai", "thread_pool_threads", 0);
+
         xyPixelSize = toml::find<double>(machineVars, "nautilai", "xy_pixel_size");
 
         //acquisition table options
@@ -93,6 +95,43 @@ Config::Config(std::filesystem::path cfg, std::filesystem::path profile, cxxopts
         tileMap = toml::find<std::vector<uint8_t>>(config, "acquisition", "tile_map");
         bufferCount = toml::find_or<uint32_t>(config, "acquisition", "buffers", 0);
         if (userargs.count("buffers")) { bufferCount = userargs["buffers"].as<uint32_t>(); }
+        zeroCopy = toml::find_or<bool>(config, "acquisition", "zero_copy", false);
+        framePoolMB = toml::find_or<uint64_t>(config, "acquisition", "frame_pool_mb", 0);
+        poolTimeoutMs = toml::find_or<uint32_t>(config, "acquisition", "frame_pool_timeout_ms", 50);
+        poolPolicyName = toml::find_or<std::string>(config, "acquisition", "frame_pool_policy", std::string("drop_newest"));
+
+        if (poolPolicyName == "block") {
+            poolPolicy = PoolPolicy::Block;
+        } else if (poolPolicyName == "drop_oldest") {
+            poolPolicy = PoolPolicy::DropOldest;
+        } else {
+            if (poolPolicyName != "drop_newest") {
+                spdlog::error("Invalid frame pool policy {}, using drop_newest", poolPolicyName);
+            }
+            poolPolicy = PoolPolicy::DropNewest;
+            poolPolicyName = "drop_newest";
+        }
+
+        writerQueueDepth = toml::find_or<uint32_t>(config, "acquisition", "writer_queue_depth", 16);
+        directIo = toml::find_or<bool>(config, "acquisition", "direct_io", false);
+        processingWorkers = toml::find_or<uint32_t>(config, "acquisition", "processing_workers", 2);
+        processingQueueDepth = toml::find_or<uint32_t>(config, "acquisition", "processing_queue_depth", 64);
+        copyThreads = toml::find_or<uint32_t>(config, "acquisition", "copy_threads", 0);
+        wellSignals = toml::find_or<bool>(config, "acquisition", "well_signals", true);
+        tileAtCapture = toml::find_or<bool>(config, "acquisition", "tile_at_capture", false);
+        writerBackendName = toml::find_or<std::string>(config, "acquisition", "writer_backend", std::string("auto"));
+
+        if (writerBackendName == "io_uring") {
+            writerBackend = WriterBackend::IoUring;
+        } else if (writerBackendName == "threads") {
+            writerBackend = WriterBackend::Threads;
+        } else {
+            if (writerBackendName != "auto") {
+                spdlog::error("Invalid writer backend {}, using auto", writerBackendName);
+            }
+            writerBackend = WriterBackend::Auto;
+            writerBackendName = "auto";
+        }
 
         frameCount = static_cast<uint32_t>(duration * fps);
         expTimeMs = 1000 * (1.0 / fps);
@@ -118,6 +157,24 @@ Config::Config(std::filesystem::path cfg, std::filesystem::path profile, cxxopts
         displayRoisDuringLiveView = toml::find_or<bool>(config, "acquisition", "live_view", "display_rois_during_live_view", true);
         vflip = toml::find<bool>(machineVars, "acquisition", "live_view", "vflip");
         hflip = toml::find<bool>(machineVars, "acquisition", "live_view", "hflip");
+        sampledStats = toml::find_or<bool>(config, "acquisition", "live_view", "sampled_stats", true);
+        statsSampleFraction = toml::find_or<double>(config, "acquisition", "live_view", "stats_sample_fraction", 0.0625);
+        if (statsSampleFraction <= 0.0 || statsSampleFraction > 1.0) {
+            spdlog::error("Invalid acquisition.live_view.stats_sample_fraction {}, using 0.0625", statsSampleFraction);
+            statsSampleFraction = 0.0625;
+        }
+        const std::string samplingName = toml::find_or<std::string>(config, "acquisition", "live_view", "stats_sampling", "strided");
+        const auto sampling = ParseLiveStatsSampling(samplingName);
+        if (!sampling) {
+            spdlog::error("Invalid acquisition.live_view.stats_sampling {}, using strided", samplingName);
+        }
+        statsSampling = sampling.value_or(LiveStatsSampling::Strided);
+        statsLowPercentile = toml::find_or<double>(config, "acquisition", "live_view", "stats_low_percentile", 0.1);
+        statsHighPercentile = toml::find_or<double>(config, "acquisition", "live_view", "stats_high_percentile", 99.9);
+
+        //postprocess
+        tileReadAhead = toml::find_or<uint32_t>(config, "postprocess", "tile_read_ahead", 2);
+        tileBuffers = toml::find_or<uint32_t>(config, "postprocess", "tile_buffers", 3);
 
         //postprocess.video
         videoQualityOptions = {
@@ -127,6 +184,21 @@ Config::Config(std::filesystem::path cfg, std::filesystem::path profile, cxxopts
         };
         selectedVideoQualityOption = "medium";
 
+        //threads
+        for (size_t i = 1; i < cThreadRoles; i++) {
+            const ThreadRole role = static_cast<ThreadRole>(i);
+            const std::string name = ThreadRoleName(role);
+            ThreadPolicy& policy = threadPolicies[i];
+
+            policy.cores = toml::find_or<std::vector<uint32_t>>(config, "threads", name, "cores", std::vector<uint32_t>{});
+            const std::string priorityName = toml::find_or<std::string>(config, "threads", name, "priority", std::string("normal"));
+            const auto priority = ParseThreadPriority(priorityName);
+            if (!priority) {
+                spdlog::error("Invalid threads.{}.priority {}, using normal", name, priorityName);
+            }
+            policy.priority = priority.value_or(ThreadPriority::Normal);
+        }
+
         //device.photometrics options
         triggerMode = toml::find<int16_t>(config, "device", "photometrics", "trigger_mode");
 
@@ -283,6 +355,7 @@ void Config::Dump() {
     spdlog::info("nautilai.auto_contrast_brightness: {}", !noAutoConBright);
     spdlog::info("nautilai.ext_analysis {}", extAnalysis.string());
     spdlog::info("nautilai.ffmpeg_dir {}", ffmpegDir.string());
+    spdlog::info("nautilai.thread_pool_threads: {}", threadPoolThreads);
     spdlog::info("nautilai.xy_pixel_size: {}", xyPixelSize);
     spdlog::info("nautilai.machine_vars_file_path: {}", machineVarsFilePath.string());
 
@@ -291,6 +364,18 @@ void Config::Dump() {
     spdlog::info("acquisition.duration: {}", duration);
     spdlog::info("acquisition.led_intensity: {}", ledIntensity);
     spdlog::info("acquisition.buffers: {}", bufferCount);
+    spdlog::info("acquisition.zero_copy: {}", zeroCopy);
+    spdlog::info("acquisition.frame_pool_mb: {}", framePoolMB);
+    spdlog::info("acquisition.frame_pool_policy: {}", poolPolicyName);
+    spdlog::info("acquisition.frame_pool_timeout_ms: {}", poolTimeoutMs);
+    spdlog::info("acquisition.writer_backend: {}", writerBackendName);
+    spdlog::info("acquisition.writer_queue_depth: {}", writerQueueDepth);
+    spdlog::info("acquisition.direct_io: {}", directIo);
+    spdlog::info("acquisition.processing_workers: {}", processingWorkers);
+    spdlog::info("acquisition.processing_queue_depth: {}", processingQueueDepth);
+    spdlog::info("acquisition.copy_threads: {}", copyThreads);
+    spdlog::info("acquisition.well_signals: {}", wellSignals);
+    spdlog::info("acquisition.tile_at_capture: {}", tileAtCapture);
     spdlog::info("acquisition.frameCount: {}", frameCount);
     spdlog::info("acquisition.expTimeMs: {}", expTimeMs);
     spdlog::info("acquisition.tile_map: [{}]", fmt::join(tileMap, ", "));
@@ -315,6 +400,21 @@ void Config::Dump() {
     spdlog::info("acquisition.live_view.display_rois_during_live_view: {}", displayRoisDuringLiveView);
     spdlog::info("acquisition.live_view.vflip: {}", vflip);
     spdlog::info("acquisition.live_view.hflip: {}", hflip);
+    spdlog::info("acquisition.live_view.sampled_stats: {}", sampledStats);
+    spdlog::info("acquisition.live_view.stats_sample_fraction: {}", statsSampleFraction);
+    spdlog::info("acquisition.live_view.stats_sampling: {}", LiveStatsSamplingName(statsSampling));
+    spdlog::info("acquisition.live_view.stats_low_percentile: {}", statsLowPercentile);
+    spdlog::info("acquisition.live_view.stats_high_percentile: {}", statsHighPercentile);
+
+    //postprocess
+    spdlog::info("postprocess.tile_read_ahead: {}", tileReadAhead);
+    spdlog::info("postprocess.tile_buffers: {}", tileBuffers);
+
+    //threads
+    for (size_t i = 1; i < cThreadRoles; i++) {
+        const ThreadRole role = static_cast<ThreadRole>(i);
+        spdlog::info("threads.{}: cores: [{}], priority: {}", ThreadRoleName(role), fmt::join(threadPolicies[i].cores, ", "), ThreadPriorityName(threadPolicies[i].priority));
+    }
 
     //device.photometrics
     spdlog::info("device.photometrics.trigger_mode  {} ({})", triggerMode, triggerModeName);
@@ -11,6 +11,9 @@
 #include <cxxopts.hpp>
 #include <interfaces/CameraInterface.h>
 #include <interfaces/AcquisitionInterface.h>
+#include <AsyncFileWriter.h>
+#include <LiveStats.h>
+#include <ThreadPolicy.h>
 
 
 std::filesystem::path enableLongPath(std::filesystem::path path);
@@ -42,6 +45,21 @@ class Config {
         uint8_t rows;
         uint8_t cols;
         uint32_t bufferCount;
+        bool zeroCopy;
+        uint64_t framePoolMB;
+        PoolPolicy poolPolicy;
+        std::string poolPolicyName;
+        uint32_t poolTimeoutMs;
+        WriterBackend writerBackend;
+        std::string writerBackendName;
+        uint32_t writerQueueDepth;
+        bool directIo;
+        uint32_t processingWorkers;
+        uint32_t processingQueueDepth;
+        uint32_t copyThreads;
+        bool wellSignals;
+        bool tileAtCapture;
+        uint32_t threadPoolThreads;
         uint32_t frameCount;
         double expTimeMs;
         std::vector<uint8_t> tileMap;
@@ -62,11 +80,23 @@ class Config {
         bool displayRoisDuringLiveView;
         bool vflip;
         bool hflip;
+        bool sampledStats;
+        double statsSampleFraction;
+        LiveStatsSampling statsSampling;
+        double statsLowPercentile;
+        double statsHighPercentile;
+
+        //postprocess options
+        uint32_t tileReadAhead;
+        uint32_t tileBuffers;
 
         //postprocess.video options
         tsl::ordered_map<std::string, uint16_t> videoQualityOptions;
         std::string selectedVideoQualityOption;
 
+        //threads options, indexed by ThreadRole
+        std::array<ThreadPolicy, cThreadRoles> threadPolicies;
+
         //device.photometrics options
         int16_t triggerMode;
         std::string triggerModeName;
@@ -78,6 +78,24 @@ void HistView::Update(uint32_t histMax, uint32_t imgMin, uint32_t imgMax) {
     m_max = histMax;
     m_imin = imgMin;
     m_imax = imgMax;
+    m_binned = false;
+    this->update();
+}
+
+
+/*
+ * @brief Update histogram with display bins.
+ *
+ * Update histogram with bins that are already rescaled to 256 bins,
+ * drawn as is without rebinning the full histogram.
+ *
+ * @param bins The 256 display bins.
+ * @param binsMax The max value of bins.
+ */
+void HistView::Update(const std::array<uint32_t, 256>& bins, uint32_t binsMax) {
+    m_bins = bins;
+    m_max = binsMax;
+    m_binned = true;
     this->update();
 }
 
@@ -104,19 +122,24 @@ void HistView::drawHistogram(QPainter* p) {
     auto w = this->size().width();
     auto h = this->size().height();
 
-    //rescale to 256 bins
     uint32_t hmax = 0;
-    uint32_t hist[257] = {0};
+    uint32_t rebinned[257] = {0};
+    const uint32_t* hist = rebinned;
     double scalex = w / 256.0;
 
-    double bscale = (m_imax - m_imin) / 256.0;
-    double bwidth = (256.0 / static_cast<double>(m_imax - m_imin + 1));
+    if (m_binned) {
+        hist = m_bins.data();
+        hmax = m_max;
+    } else {
+        //rescale to 256 bins
+        double bwidth = (256.0 / static_cast<double>(m_imax - m_imin + 1));
 
-    for (size_t i = m_imin; i <= m_imax; i++) {
-        uint32_t index = static_cast<uint32_t>(bwidth * (i-m_imin));
-        hist[index] += m_hist[i];
+        for (size_t i = m_imin; i <= m_imax; i++) {
+            uint32_t index = static_cast<uint32_t>(bwidth * (i-m_imin));
+            rebinned[index] += m_hist[i];
 
-        if (hist[index] > hmax) { hmax = hist[index]; }
+            if (rebinned[index] > hmax) { hmax = rebinned[index]; }
+        }
     }
 
     for(size_t i = 0; i < 256; i++) {
@@ -143,7 +166,7 @@ void HistView::paintGL() {
     f->glClear(GL_COLOR_BUFFER_BIT);
 
     QPainter painter(this);
-    if (m_hist) {
+    if (m_hist || m_binned) {
         drawHistogram(&painter);
     }
 }
@@ -31,6 +31,7 @@
 #ifndef HISTVIEW_H
 #define HISTVIEW_H
 
+#include <array>
 #include <mutex>
 #include <QOpenGLWidget>
 #include <QOpenGLContext>
@@ -49,6 +50,8 @@ class HistView : public QOpenGLWidget {
         uint32_t* m_hist{nullptr};
         size_t m_size{0};
         uint32_t m_max{0}, m_imin{0}, m_imax{0};
+        std::array<uint32_t, 256> m_bins{};
+        bool m_binned{false};
 
     public:
         HistView(QWidget* parent = nullptr);
@@ -56,6 +59,7 @@ class HistView : public QOpenGLWidget {
 
         void Init(uint32_t* hist, size_t size);
         void Update(uint32_t histMax, uint32_t imgMin, uint32_t imgMax);
+        void Update(const std::array<uint32_t, 256>& bins, uint32_t binsMax);
 
     private:
         void drawHistogram(QPainter* p);
@@ -55,6 +55,8 @@
 #include "mainwindow.h"
 #include <NIDAQmx_wrapper.h>
 #include <interfaces/CameraInterface.h>
+#include <ThreadPool.h>
+#include <ThreadPolicy.h>
 
 
 /*
@@ -149,6 +151,13 @@ int main(int argc, char* argv[]) {
     if (config->configError.empty()) {
         config->Dump();
     }
+    ThreadPool::SetSharedThreadCount(config->threadPoolThreads);
+
+    // roles apply their policy when their threads start, the gui thread is this one
+    for (size_t i = 1; i < cThreadRoles; i++) {
+        SetThreadPolicy(static_cast<ThreadRole>(i), config->threadPolicies[i]);
+    }
+    ApplyThreadPolicy(ThreadRole::Ui);
 
     if (!std::filesystem::exists(config->backgroundRecordingDir)) {
         spdlog::info("Creating {}", config->backgroundRecordingDir.string());
@@ -206,7 +215,15 @@ int main(int argc, char* argv[]) {
             .trigMode = config->triggerMode,
             .expModeOut = config->exposureMode,
             .frameCount = config->frameCount,
-            .bufferCount = config->bufferCount
+            .bufferCount = config->bufferCount,
+            .zeroCopy = config->zeroCopy,
+            .framePoolBytes = config->framePoolMB * 1024 * 1024,
+            .poolPolicy = config->poolPolicy,
+            .poolTimeoutMS = config->poolTimeoutMs,
+            .directIo = config->directIo,
+            .processingWorkers = config->processingWorkers,
+            .processingQueueDepth = config->processingQueueDepth,
+            .copyThreads = config->copyThreads
         };
 
         camera->SetupExp(m_expSettings);
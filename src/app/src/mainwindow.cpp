@@ -35,6 +35,7 @@
 #include <format>
 #include <fstream>
 #include <future>
+#include <numeric>
 #include <iostream>
 #include <fstream>
 #include <cstddef>
@@ -67,6 +68,9 @@
 #include <Database.h>
 #include <processing/WriteRawFrame.h>
 #include <processing/BackgroundProcess.h>
+#include <processing/ExtractWellSignals.h>
+#include <MosaicStreamFile.h>
+#include <WellStats.h>
 #include <Rois.h>
 #include "plateidedit.h"
 
@@ -356,6 +360,14 @@ MainWindow::MainWindow(std::shared_ptr<Config> params, QMainWindow *parent) : QM
     m_expSettings.expTimeMS = m_config->expTimeMs,
     m_expSettings.frameCount = m_config->frameCount;
     m_expSettings.bufferCount = m_config->bufferCount;
+    m_expSettings.zeroCopy = m_config->zeroCopy;
+    m_expSettings.framePoolBytes = m_config->framePoolMB * 1024 * 1024;
+    m_expSettings.poolPolicy = m_config->poolPolicy;
+    m_expSettings.poolTimeoutMS = m_config->poolTimeoutMs;
+    m_expSettings.directIo = m_config->directIo;
+    m_expSettings.processingWorkers = m_config->processingWorkers;
+    m_expSettings.processingQueueDepth = m_config->processingQueueDepth;
+    m_expSettings.copyThreads = m_config->copyThreads;
     m_expSettings.storageType = m_config->storageType;
     m_expSettings.trigMode = m_config->triggerMode;
     m_expSettings.expModeOut = m_config->exposureMode;
@@ -400,8 +412,8 @@ MainWindow::MainWindow(std::shared_ptr<Config> params, QMainWindow *parent) : QM
     connect(m_liveViewTimer, &QTimer::timeout, this, &MainWindow::updateLiveView);
 
     //initialize histogram buffer
-    m_hist = new uint32_t[(1<<16) - 1];
-    memset((void*)m_hist, 0, sizeof(uint32_t)*((1<<16)-1));
+    m_hist = new uint32_t[1<<16];
+    memset((void*)m_hist, 0, sizeof(uint32_t)*(1<<16));
 
     //initialize lut buffer
     m_lut16 = new uint8_t[(1<<16) - 1];
@@ -409,6 +421,9 @@ MainWindow::MainWindow(std::shared_ptr<Config> params, QMainWindow *parent) : QM
 
     //create task pools
     m_taskFrameStats = std::make_shared<TaskFrameStats>(TASKS);
+    if (m_config->sampledStats) {
+        m_liveStats = std::make_unique<LiveStats>(m_config->statsSampleFraction, m_config->statsLowPercentile, m_config->statsHighPercentile, m_config->statsSampling);
+    }
     emit sig_update_state(Initializing);
 }
 
@@ -700,6 +715,7 @@ bool MainWindow::stopLiveView() {
     ledOFF();
 
     m_liveViewTimer->stop();
+    if (m_liveStats) { m_liveStats->Drain(); }
     m_liveView->update();
     m_acquisition->StopAll();
     m_acquisition->WaitForStop();
@@ -714,6 +730,7 @@ bool MainWindow::stopLiveView_PostProcessing() {
     ledOFF();
 
     m_liveViewTimer->stop();
+    if (m_liveStats) { m_liveStats->Drain(); }
     m_liveView->update();
     m_acquisition->StopAll();
     m_acquisition->WaitForStop();
@@ -835,6 +852,7 @@ bool MainWindow::stopLiveView_AcquisitionRunning() {
     spdlog::info("Stopping Live view, acquisition still running");
     ui.liveScanBtn->setText("Live Scan");
     m_liveViewTimer->stop();
+    if (m_liveStats) { m_liveStats->Drain(); }
     m_liveView->update();
 
     return true;
@@ -1397,6 +1415,10 @@ bool MainWindow::availableDriveSpace(StartAcqCheckLogOpts opts) {
 
         uint64_t frameBytesPerStagePos = fps * duration * frameBytes;
         uint64_t unstitchedRawFileBytes = numActiveStagePositions * frameBytesPerStagePos; // num bytes across all untiled raw files
+        if (m_config->autoTile && m_config->tileAtCapture) {
+            // frames go straight into the tiled raw file, no untiled raw files are written
+            unstitchedRawFileBytes = 0;
+        }
 
         uint64_t totalAcquisitionBytesEstimate = unstitchedRawFileBytes;
         uint64_t finalAcquisitionBytesEstimate = unstitchedRawFileBytes;
@@ -1510,10 +1532,24 @@ void MainWindow::updateLiveView() noexcept {
             uint8_t bytes_per_pixel = m_camera->ctx->effectiveBitDepth / 8;
             uint8_t* data = static_cast<uint8_t*>(frame->GetData());
 
-            //Calculate histogram
-            m_taskFrameStats->Setup(data, m_hist, m_width, m_height, bytes_per_pixel);
-            m_parTask.Start(m_taskFrameStats);
-            m_taskFrameStats->Results(m_min, m_max, m_hmax);
+            if (m_liveStats) {
+                //sampled stats run on the live stats thread, show the last finished result
+                //the fine histogram covers the sensor range, pixels are stored in effectiveBitDepth
+                m_liveStats->Submit(data, m_width, m_height, bytes_per_pixel, static_cast<uint8_t>(m_camera->ctx->bitDepth));
+                if (m_liveStats->Latest(m_liveStatsResult)) {
+                    m_min = m_liveStatsResult.low;
+                    m_max = m_liveStatsResult.high;
+                    m_hmax = m_liveStatsResult.hmax;
+                    ui.histView->Update(m_liveStatsResult.hist, m_liveStatsResult.hmax);
+                }
+            } else {
+                //Calculate histogram
+                //one bin per sensor value, pixels are stored in effectiveBitDepth
+                m_taskFrameStats->Setup(data, m_hist, m_width, m_height, bytes_per_pixel, static_cast<uint8_t>(m_camera->ctx->bitDepth));
+                m_parTask.Start(m_taskFrameStats);
+                m_taskFrameStats->Results(m_min, m_max, m_hmax);
+                ui.histView->Update(m_hmax, m_min, m_max);
+            }
 
             float scale = 1.0f;
             float autoMin = 0.0f;
@@ -1526,7 +1562,6 @@ void MainWindow::updateLiveView() noexcept {
             }
 
             m_liveView->UpdateImage(data, scale, autoMin);
-            ui.histView->Update(m_hmax, m_min, m_max);
         }
     }
 }
@@ -1552,7 +1587,9 @@ void MainWindow::postProcess() {
 
         uint16_t rowsxcols = m_config->rows * m_config->cols;
 
-        if (m_config->autoTile) {
+        if (m_config->autoTile && m_tiledAtCapture) {
+            spdlog::info("Frames were tiled during acquisition, skipping auto tile");
+        } else if (m_config->autoTile) {
             if (rowsxcols != stagePos.size() || rowsxcols != m_config->tileMap.size()) {
                 spdlog::warn("Auto tile enabled but acquisition count {} does not match rows * cols {}, skipping", stagePos.size(), rowsxcols);
                 return;
@@ -1591,13 +1628,16 @@ void MainWindow::postProcess() {
                 m_width,
                 m_height,
                 m_camera->ctx->effectiveBitDepth,
+                m_config->directIo,
                 m_config->vflip,
                 m_config->hflip,
                 !m_config->noAutoConBright,
                 [&](size_t n) { emit sig_progress_update(n); },
                 raw,
                 rawDownsampled,
-                m_config->binFactor
+                m_config->binFactor,
+                m_config->tileReadAhead,
+                m_config->tileBuffers
             );
 
             raw->Close();
@@ -1616,7 +1656,6 @@ void MainWindow::postProcess() {
 // handle acquisition done signal from thread finished slot
 void MainWindow::acquisitionThread(MainWindow* cls) {
     auto progressCB = [&](size_t n) { emit cls->sig_progress_update(n); };
-    auto processFrame = [](FrameCtx* frameCtx, pm::Frame* frame) { processing::writeRawFrame(frameCtx, frame); };
 
     double voltage = (cls->m_config->ledIntensity / 100.0) * cls->m_config->maxVoltage;
     cls->ledON(voltage);
@@ -1653,6 +1692,63 @@ void MainWindow::acquisitionThread(MainWindow* cls) {
         }
     }
     emit cls->sig_progress_start("Acquiring images", numActiveFovs * cls->m_expSettings.frameCount);
+    cls->m_poolStats.clear();
+
+    //frames are written asynchronously and handed back to the acquisition once on disk
+    std::shared_ptr<AsyncFileWriter> writer{nullptr};
+    std::function<void(pm::Frame*)> releaseFrame = [cls](pm::Frame* frame) { cls->m_acquisition->ReleaseFrame(frame); };
+
+    //per well mean intensity of every frame, written next to each raw stream
+    std::unique_ptr<processing::RoiEngine> wellRois{nullptr};
+    if (cls->m_config->wellSignals) {
+        if (cls->m_config->plateFormat == "") {
+            spdlog::warn("Platemap format is not set, skipping well signals");
+        } else {
+            wellRois = std::make_unique<processing::RoiEngine>(&cls->m_roiCfg, cls->m_width, cls->m_height);
+        }
+    }
+
+    //with tile at capture every position is written straight into its tile of the final mosaic file
+    uint16_t rowsxcols = cls->m_config->rows * cls->m_config->cols;
+    bool sizeMatches = (rowsxcols == cls->m_stageControl->GetPositions().size() && rowsxcols == cls->m_config->tileMap.size());
+
+    std::shared_ptr<MosaicStreamFile> mosaic{nullptr};
+    cls->m_tiledAtCapture = false;
+    if (cls->m_config->autoTile && cls->m_config->tileAtCapture) {
+        //every position has to own exactly one tile
+        std::vector<uint8_t> tiles(rowsxcols);
+        std::iota(tiles.begin(), tiles.end(), 0);
+
+        if (!sizeMatches) {
+            spdlog::warn("Tile at capture enabled but position count does not match rows * cols {}, writing positions separately", rowsxcols);
+        } else if (!std::is_permutation(cls->m_config->tileMap.begin(), cls->m_config->tileMap.end(), tiles.begin())) {
+            spdlog::warn("Tile at capture enabled but tile map [{}] is not a permutation of 0..{}, writing positions separately", fmt::join(cls->m_config->tileMap, ", "), rowsxcols - 1);
+        } else {
+            if (cls->m_config->directIo) {
+                spdlog::warn("Direct io is not used with tile at capture, tile rows are not sector aligned");
+            }
+
+            std::filesystem::path binnedPath{};
+            if (cls->m_config->enableDownsampleRawFiles) {
+                binnedPath = cls->m_expSettings.acquisitionDir / fmt::format("{}_{}_bin{}.raw", cls->m_config->prefix, std::string(cls->m_startAcquisitionTS), cls->m_config->binFactor);
+            }
+
+            mosaic = std::make_shared<MosaicStreamFile>(
+                cls->m_expSettings.acquisitionDir / fmt::format("{}_{}.raw", cls->m_config->prefix, std::string(cls->m_startAcquisitionTS)),
+                cls->m_camera->ctx->effectiveBitDepth,
+                cls->m_width,
+                cls->m_height,
+                cls->m_config->rows,
+                cls->m_config->cols,
+                cls->m_expSettings.frameCount,
+                cls->m_config->vflip,
+                cls->m_config->hflip,
+                binnedPath,
+                cls->m_config->binFactor
+            );
+            cls->m_tiledAtCapture = true;
+        }
+    }
 
     for (auto& loc : cls->m_stageControl->GetPositions()) {
         if (loc->skipped) {
@@ -1676,9 +1772,75 @@ void MainWindow::acquisitionThread(MainWindow* cls) {
         cls->m_acquisition->StopAll();
         cls->m_acquisition->WaitForStop();
 
+        if (!writer) {
+            writer = std::make_shared<AsyncFileWriter>(cls->m_config->writerBackend, cls->m_config->writerQueueDepth);
+            writer->RegisterBuffers({ cls->m_acquisition->GetFramePoolRegion() });
+        }
+        writer->ResetStats();
+
         cls->m_expSettings.trigMode = cls->m_config->triggerMode;
         cls->m_camera->UpdateExp(cls->m_expSettings);
 
+        //one preallocated raw stream per position, kept open for the whole acquisition
+        std::shared_ptr<RawStreamFile> rawStream{nullptr};
+        if (mosaic) {
+            //auto tile places position tileMap[tile] + 1 at tile
+            auto it = std::find(cls->m_config->tileMap.begin(), cls->m_config->tileMap.end(), static_cast<uint8_t>(pos - 2));
+            const uint32_t tile = static_cast<uint32_t>(std::distance(cls->m_config->tileMap.begin(), it));
+            if (it == cls->m_config->tileMap.end() || !mosaic->BeginTile(tile, cls->m_expSettings.acquisitionDir / DATA_DIR / fmt::format("{}_{}.idx", cls->m_config->prefix, pos - 1))) {
+                spdlog::error("No mosaic tile for position {}, stopping acquisition", pos - 1);
+                cls->m_needsPostProcessing = false;
+                break;
+            }
+        } else {
+            rawStream = std::make_shared<RawStreamFile>(
+                cls->m_expSettings.acquisitionDir / DATA_DIR / fmt::format("{}_{}.raw", cls->m_config->prefix, pos - 1),
+                cls->m_camera->ctx->effectiveBitDepth,
+                cls->m_width,
+                cls->m_height,
+                cls->m_expSettings.frameCount,
+                cls->m_config->directIo
+            );
+        }
+
+        std::shared_ptr<WellSignalFile> wellSignals{nullptr};
+        if (wellRois) {
+            //pos was already advanced past this position
+            const size_t fovIdx = static_cast<size_t>(pos - 2);
+            const size_t tile = (fovIdx < cls->m_config->tileMap.size()) ? cls->m_config->tileMap[fovIdx] : fovIdx;
+            auto wells = Rois::roiWells(&cls->m_roiCfg, tile, cls->m_config->cols, cls->m_config->vflip, cls->m_config->hflip);
+
+            std::vector<WellSignalColumn> columns;
+            for (size_t i = 0; i < wells.size(); i++) {
+                columns.push_back(WellSignalColumn {
+                    .row = static_cast<uint16_t>(std::get<0>(wells[i])),
+                    .col = static_cast<uint16_t>(std::get<1>(wells[i])),
+                    .pixels = wellRois->Pixels(i),
+                });
+            }
+
+            wellSignals = std::make_shared<WellSignalFile>(
+                cls->m_expSettings.acquisitionDir / DATA_DIR / fmt::format("{}_{}.wells", cls->m_config->prefix, pos - 1),
+                std::move(columns),
+                cls->m_expSettings.frameCount,
+                cls->m_config->fps,
+                static_cast<uint32_t>(std::ceil(cls->m_roiCfg.width / cls->m_roiCfg.scale)),
+                static_cast<uint32_t>(std::ceil(cls->m_roiCfg.height / cls->m_roiCfg.scale)),
+                cls->m_camera->ctx->effectiveBitDepth
+            );
+        }
+
+        auto processFrame = [rawStream, mosaic, writer, wellSignals, rois = wellRois.get(), &releaseFrame](FrameCtx* frameCtx, pm::Frame* frame) {
+            if (wellSignals) {
+                processing::extractWellSignals(frameCtx, frame, *rois, wellSignals.get());
+            }
+            if (mosaic) {
+                mosaic->Write(frameCtx, frame, writer.get());
+            } else {
+                processing::writeRawFrame(frameCtx, frame, rawStream.get(), writer.get(), releaseFrame);
+            }
+        };
+
         emit cls->sig_progress_text(fmt::format("Acquiring images for position ({}, {})", loc->x, loc->y));
         cls->m_acquisition->StartAcquisition(progressCB, processFrame);
 
@@ -1688,6 +1850,24 @@ void MainWindow::acquisitionThread(MainWindow* cls) {
 
         spdlog::info("Waiting for acquisition");
         cls->m_acquisition->WaitForAcquisition();
+        cls->m_poolStats.push_back({ pos - 1, cls->m_acquisition->GetPoolStats() });
+        if (mosaic) {
+            mosaic->EndTile(); //frames are written by the processing stage, drained by now
+        } else {
+            rawStream->Close(); //waits for in flight writes
+        }
+        if (wellSignals) {
+            wellSignals->Close();
+        }
+
+        const StageStats writeStats = writer->Stats();
+        spdlog::info("Write stage in flight high water: {}/{}, frames: {}, mean: {:.1f}us, max: {:.1f}us",
+            writeStats.highWater, writeStats.capacity, writeStats.processed, writeStats.ServiceMeanUS(), writeStats.serviceMaxNS / 1000.0);
+
+        //lost frames, latencies and high water marks for this position
+        pm::AcquisitionTelemetry telemetry = cls->m_acquisition->GetTelemetry();
+        telemetry.write = writeStats;
+        telemetry.WriteJson(cls->m_expSettings.acquisitionDir / fmt::format("{}_{}_telemetry.json", cls->m_config->prefix, pos - 1));
 
         //TODO check for user cancel and jump out
         if (cls->m_userCanceled) {
@@ -1700,8 +1880,9 @@ void MainWindow::acquisitionThread(MainWindow* cls) {
     }
     emit cls->sig_set_platemap(0);
 
-    uint16_t rowsxcols = cls->m_config->rows * cls->m_config->cols;
-    bool sizeMatches = (rowsxcols == cls->m_stageControl->GetPositions().size() && rowsxcols == cls->m_config->tileMap.size());
+    if (mosaic) {
+        mosaic->Close();
+    }
 
     if (cls->m_config->autoTile && sizeMatches && cls->m_needsPostProcessing) {
         emit cls->sig_update_state(PostProcessing);
@@ -1720,32 +1901,27 @@ void MainWindow::backgroundRecordingThread(MainWindow* cls) {
         spdlog::error("Platemap format is not set");
         return;
     }
+    cls->m_tiledAtCapture = false;
 
     //progress bar callback
     auto progressCB = [&](size_t n) { emit cls->sig_progress_update(n); };
-    std::vector<std::tuple<uint32_t, uint32_t>> rois = Rois::roiOffsets(&cls->m_roiCfg, cls->m_width, cls->m_height);
+    //all well sums of a frame in one pass, bands of wells are split across the shared pool
+    processing::RoiEngine roiEngine(&cls->m_roiCfg, cls->m_width, cls->m_height);
 
     //TODO parameterize intensity count
-    std::vector<double> *wellAvgs[3];
-    for (auto &v : wellAvgs) {
-        v = new std::vector<double>[rois.size() * cls->m_config->rows * cls->m_config->cols]{};
+    // only need 1 sec of data for background recordings
+    const uint32_t bgFrameCount = cls->m_config->fps;
+
+    //frames are processed on several workers, each adds its well averages to running stats per led intensity,
+    //the first and last 10% of frames are dropped
+    const size_t wellCount = roiEngine.Count() * cls->m_config->rows * cls->m_config->cols;
+    std::unique_ptr<WellAccumulators> wellStats[3];
+    for (auto& v : wellStats) {
+        v = std::make_unique<WellAccumulators>(wellCount, bgFrameCount, 0.1, std::max<uint32_t>(1, cls->m_config->processingWorkers));
     }
 
-    //Fall back to unvectorized version if we don't know about the roi size for a platemap
-    //otherwise use the specialized version
-    auto roiFn = processing::roiAvgGeneric;
-    if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 16 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 16) { roiFn = processing::roiAvg<16, 16>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 32 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 32) { roiFn = processing::roiAvg<32, 32>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 40 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 40) { roiFn = processing::roiAvg<40, 40>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 64 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 64) { roiFn = processing::roiAvg<64, 64>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 32 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 16) { roiFn = processing::roiAvg<32, 16>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 64 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 32) { roiFn = processing::roiAvg<64, 32>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 110 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 64) { roiFn = processing::roiAvg<110, 64>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 128 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 64) { roiFn = processing::roiAvg<128, 64>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 128 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 128) { roiFn = processing::roiAvg<128, 128>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 220 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 128) { roiFn = processing::roiAvg<220, 128>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 256 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 128) { roiFn = processing::roiAvg<256, 128>; }
-    else if (cls->m_roiCfg.width / cls->m_roiCfg.scale == 256 && cls->m_roiCfg.height / cls->m_roiCfg.scale == 256) { roiFn = processing::roiAvg<256, 256>; }
+    //pixels at the top of the camera range are saturated
+    const uint32_t saturation = (uint32_t(1) << cls->m_camera->ctx->bitDepth) - 1;
 
     //process frame callback
     auto processFrame = [&](size_t intensityIdx, size_t fovIdx) {
@@ -1754,26 +1930,23 @@ void MainWindow::backgroundRecordingThread(MainWindow* cls) {
         auto wellsPerRow = cls->m_roiCfg.cols * plateCols;
 
         return [&, wellsPerRow, intensityIdx, fovIdx, plateCols, plateRows](FrameCtx* frameCtx, pm::Frame* frame) {
-            for (auto r = 0; r < cls->m_roiCfg.rows; r++) {
-                for (auto c = 0; c < cls->m_roiCfg.cols; c++) {
-                    auto idx = fovIdx * cls->m_roiCfg.rows * cls->m_roiCfg.cols;
-                    idx += c + r*cls->m_roiCfg.cols;
-
-                    size_t x, y;
-                    std::tie(x, y) = rois[c + r*cls->m_roiCfg.cols];
-
-                    double avg = roiFn(&cls->m_roiCfg, (uint8_t*)(frame->GetData()), x, y, frameCtx->width, frameCtx->bitDepth);
-                    wellAvgs[intensityIdx][idx].push_back(avg);
-                }
-            }
+            thread_local std::vector<double> avgs;
+            thread_local std::vector<uint64_t> saturated;
+            avgs.resize(roiEngine.Count());
+            saturated.resize(roiEngine.Count());
+            roiEngine.Means(static_cast<const uint8_t*>(frame->GetData()), frameCtx->bitDepth, avgs.data(), &ThreadPool::Shared(), saturated.data(), saturation);
+
+            //rois of a fov are stored one after the other in roi order
+            wellStats[intensityIdx]->Add(frameCtx->index, fovIdx * roiEngine.Count(), avgs.data(), saturated.data(), roiEngine.Count());
         };
     };
 
-    std::vector<double> ledIntensities = {
-        cls->m_config->ledIntensity,
-        0.5 * cls->m_config->ledIntensity,
-        0.25 * cls->m_config->ledIntensity,
-    };
+    //percent of the configured led intensity, also used to label the output files
+    const std::vector<uint32_t> ledPercents = { 100, 50, 25 };
+    std::vector<double> ledIntensities;
+    for (auto pct : ledPercents) {
+        ledIntensities.push_back(pct / 100.0 * cls->m_config->ledIntensity);
+    }
 
     cls->ledON((cls->m_config->ledIntensity / 100.0) * cls->m_config->maxVoltage);
     cls->m_needsPostProcessing = false;
@@ -1781,8 +1954,7 @@ void MainWindow::backgroundRecordingThread(MainWindow* cls) {
     spdlog::info("Starting background recording thread");
     cls->m_expSettings.expTimeMS = (1 / cls->m_config->fps) * 1000;
 
-    // only need 1 sec of data for background recordings
-    cls->m_expSettings.frameCount = cls->m_config->fps;
+    cls->m_expSettings.frameCount = bgFrameCount;
 
     auto stagePositions = cls->m_stageControl->GetPositions();
     emit cls->sig_progress_start("Acquiring images", stagePositions.size() * ledIntensities.size() * cls->m_expSettings.frameCount);
@@ -1823,20 +1995,9 @@ void MainWindow::backgroundRecordingThread(MainWindow* cls) {
         spdlog::info("Background Recording for location x: {}, y: {} finished", loc->x, loc->y);
     }
 
-    std::vector<double> wellAverageIntensity[3];
-
+    std::vector<RunningStats> wellSummary[3];
     for (auto i = 0; i < ledIntensities.size(); i++) {
-        for (auto w = 0; w < rois.size() * cls->m_config->rows * cls->m_config->cols; w++) {
-
-            //drop first and last 0.1 seconds of data and average each well per led intensity
-            auto n = 0.1 * wellAvgs[i][w].size();
-            wellAvgs[i][w].erase(wellAvgs[i][w].begin(), wellAvgs[i][w].begin() + n);
-            wellAvgs[i][w].resize(wellAvgs[i][w].size() - n);
-
-            //avgerage intensity for well
-            double wavg = std::reduce(wellAvgs[i][w].begin(), wellAvgs[i][w].end(), 0.0) / wellAvgs[i][w].size();
-            wellAverageIntensity[i].push_back(wavg);
-        }
+        wellSummary[i] = wellStats[i]->Summary();
     }
 
     if (cls->m_config->plateId != "") {
@@ -1851,13 +2012,15 @@ void MainWindow::backgroundRecordingThread(MainWindow* cls) {
 
         std::ofstream backgroundFile;
         backgroundFile.open(backgroundFilePath.string());
-        backgroundFile << "Well\t" << "Background Fluorescence, 100% LED Intensity (AU)\t"
-                       << "Background Fluorescence, 50% LED Intensity (AU)\t"
-                       << "Background Fluorescence, 25% LED Intensity (AU)"
-                       << std::endl;
+        backgroundFile << "Well";
+        for (auto pct : ledPercents) {
+            backgroundFile << fmt::format("\tBackground Fluorescence, {}% LED Intensity (AU)", pct);
+        }
+        backgroundFile << std::endl;
 
 
         std::vector<std::tuple<size_t, std::string>> file_rows{};
+        std::vector<std::tuple<size_t, std::string>> stats_rows{};
 
         for (auto fovIdx = 0; fovIdx < cls->m_config->cols * cls->m_config->rows; fovIdx++) {
             for (auto r = 0; r < cls->m_roiCfg.rows; r++) {
@@ -1872,13 +2035,21 @@ void MainWindow::backgroundRecordingThread(MainWindow* cls) {
                     auto row = r + (cls->m_roiCfg.rows * (fovIdx / cls->m_config->cols));
                     auto wellIdx = row * (cls->m_roiCfg.rows * cls->m_config->cols) + col;
 
+                    std::string well_name = Rois::wellName(row, col);
                     std::vector<double> file_row;
+                    std::vector<std::string> stats_row;
                     for (auto i = 0; i < ledIntensities.size(); i++) {
-                        file_row.push_back(wellAverageIntensity[i][idx]);
+                        const RunningStats& ws = wellSummary[i][idx];
+                        file_row.push_back(ws.Mean());
+                        stats_row.push_back(fmt::format("{}\t{}\t{}\t{}\t{}", ws.Mean(), ws.StdDev(), ws.min, ws.max, ws.saturated));
+
+                        if (ws.saturated > 0) {
+                            spdlog::warn("Well {} has {} saturated pixels at {}% LED intensity", well_name, ws.saturated, ledPercents[i]);
+                        }
                     }
 
-                    std::string well_name = Rois::wellName(row, col);
                     file_rows.push_back(std::make_tuple(wellIdx, fmt::format("{}\t{}", well_name, fmt::join(file_row, "\t"))));
+                    stats_rows.push_back(std::make_tuple(wellIdx, fmt::format("{}\t{}", well_name, fmt::join(stats_row, "\t"))));
                 }
             }
         }
@@ -1889,10 +2060,27 @@ void MainWindow::backgroundRecordingThread(MainWindow* cls) {
         }
 
         backgroundFile.close();
+
+        //mean, spread and saturation of each well over the kept frames
+        std::filesystem::path statsFilePath = backgroundRecSubDir / (cls->m_config->plateId + "_stats.tsv");
+        spdlog::info("Writing background recording well statistics to {}", statsFilePath.string());
+
+        std::ofstream statsFile(statsFilePath.string());
+        statsFile << "Well";
+        for (auto pct : ledPercents) {
+            statsFile << fmt::format("\tMean, {0}% LED\tStd Dev, {0}% LED\tMin, {0}% LED\tMax, {0}% LED\tSaturated Pixels, {0}% LED", pct);
+        }
+        statsFile << std::endl;
+
+        std::sort(stats_rows.begin(), stats_rows.end());
+        for (auto sr : stats_rows) {
+            statsFile << std::get<1>(sr) << std::endl;
+        }
+        statsFile.close();
+
         cls->writeSettingsFile(cls->m_config->backgroundRecordingDir / cls->m_config->plateId);
     }
 
-    for (auto& v : wellAvgs) { delete[] v; }
     cls->saveBackgroundRecordingMetadata();
 
     //write settings file
@@ -1947,6 +2135,7 @@ void MainWindow::writeSettingsFile(std::filesystem::path fp) {
         { "vflip", m_config->vflip },
         { "hflip", m_config->hflip },
         { "auto_tile", m_config->autoTile },
+        { "tile_at_capture", m_tiledAtCapture },
         { "width", m_width },
         { "height", m_height },
         { "num_horizontal_pixels", m_config->cols * m_width },
@@ -1978,6 +2167,28 @@ void MainWindow::writeSettingsFile(std::filesystem::path fp) {
 
     outfile << std::setw(300) << paths << std::endl;
 
+    //per position frame pool counters, flat arrays so they stay in the root table
+    if (!m_poolStats.empty()) {
+        std::vector<int> positions;
+        std::vector<uint64_t> dropped, late, recycled;
+        for (auto& [position, stats] : m_poolStats) {
+            positions.push_back(position);
+            dropped.push_back(stats.dropped);
+            late.push_back(stats.late);
+            recycled.push_back(stats.recycled);
+        }
+
+        const toml::basic_value<toml::preserve_comments, tsl::ordered_map> frameStats {
+            { "frame_pool_policy", m_config->poolPolicyName },
+            { "frame_stats_positions", positions },
+            { "dropped_frames", dropped },
+            { "late_frames", late },
+            { "recycled_frames", recycled }
+        };
+
+        outfile << std::setw(100) << frameStats << std::endl;
+    }
+
     //output platemap format
     if (m_config->plateFormat != "") {
         auto platemapFormat = toml::parse(m_config->plateFormat);
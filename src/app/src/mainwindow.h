@@ -35,6 +35,7 @@
 #include <vector>
 #include <bitset>
 #include <stack>
+#include <tuple>
 
 #include <toml.hpp>
 #include <tsl/ordered_map.h>
@@ -61,6 +62,7 @@
 #include <Database.h>
 #include <ParTask.h>
 #include <TaskFrameStats.h>
+#include <LiveStats.h>
 #include <TaskFrameLut16.h>
 #include <TaskApplyLut16.h>
 #include <Rois.h>
@@ -245,8 +247,8 @@ class MainWindow : public QMainWindow {
         std::future<void> m_autoUpdateCheck = {};
 
         uint32_t m_width, m_height;
-        uint32_t m_min, m_max;
-        uint32_t m_hmax;
+        uint32_t m_min{0}, m_max{0};
+        uint32_t m_hmax{0};
 
         std::bitset<32> m_curMask;
         std::bitset<32> m_savedMask;
@@ -257,16 +259,20 @@ class MainWindow : public QMainWindow {
         uint8_t* m_lut16{nullptr};
         uint32_t* m_hist{nullptr};
 
-        ParTask m_parTask{TASKS};
+        ParTask m_parTask{TASKS, ThreadRole::LiveView};
         std::shared_ptr<TaskFrameStats> m_taskFrameStats;
+        std::unique_ptr<LiveStats> m_liveStats;
+        LiveStatsResult m_liveStatsResult{};
         std::string m_testImgPath;
 
+        std::vector<std::tuple<int, pm::PoolStats>> m_poolStats;
         char m_startAcquisitionTS[std::size(TIMESTAMP_STR)+4] = {};
         char m_recordingDateFmt[std::size(RECORDING_DATE_FMT)+4] = {};
 
         bool m_userCanceled{false};
         bool m_userCanceledAcquisition{false};
         bool m_needsPostProcessing{false};
+        bool m_tiledAtCapture{false};
 
         std::mutex m_fileCleanupLock;
         std::condition_variable m_fileCleanupCond;
@@ -0,0 +1,389 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  bench_acquisition.cpp
+ *
+ * @brief End-to-end acquisition throughput benchmark.
+ *
+ * Drives pm::Acquisition against the synthetic camera in libs/dbgcam and
+ * sweeps frame rate, region size, bit depth, buffer count and writer mode.
+ * Sustained frame rate, dropped frames, disk throughput, per stage cpu and
+ * latency percentiles of every configuration are written as JSON.
+ *********************************************************************/
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <interfaces/AcquisitionInterface.h>
+#include <interfaces/CameraInterface.h>
+#include <pm/Acquisition.h>
+#include <pm/Camera.h>
+#include <pm/ColorConfig.h>
+#include <pm/Frame.h>
+#include <AsyncFileWriter.h>
+#include <RawStreamFile.h>
+#include <processing/WriteRawFrame.h>
+
+using pmCamera = Camera<pm::Camera, pm::Frame>;
+using pmAcquisition = Acquisition<pm::Acquisition, pm::ColorConfig, ph_color_context, pm::Camera, pm::Frame>;
+
+/*
+* Shared settings for every configuration of a sweep.
+*/
+struct BenchOptions {
+    uint16_t sensorWidth{3200};
+    uint16_t sensorHeight{3200};
+    double durationS{5.0};
+    std::string pattern{"ramp"};
+    uint32_t processingWorkers{2};
+    uint32_t processingQueueDepth{64};
+    uint32_t writerQueueDepth{16};
+    uint64_t framePoolMB{0};
+    bool zeroCopy{false};
+    bool directIo{false};
+    bool keepFiles{false};
+    std::filesystem::path dir;
+};
+
+/*
+* A single point of the sweep.
+*/
+struct BenchConfig {
+    double fps{0.0};
+    uint16_t width{0};
+    uint16_t height{0};
+    int16_t bitDepth{0};
+    uint32_t bufferCount{0};
+    std::string writer;  // none, sync, auto, io_uring or threads
+};
+
+/*
+* Measurements of a single configuration.
+*/
+struct BenchResult {
+    BenchConfig cfg;
+    bool ok{false};
+    uint32_t frameBytes{0};
+    uint32_t frameCount{0};
+    double wallS{0.0};
+    double cpuS{0.0};
+    uint64_t framesWritten{0};
+    pm::AcquisitionTelemetry telemetry;
+};
+
+
+static double cpuSeconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+
+/*
+* Runs one acquisition against the synthetic camera.
+*
+* @param cfg Sweep point.
+* @param opts Sweep wide settings.
+* @param result Output measurements.
+*
+* @return true if the acquisition ran, false otherwise.
+*/
+static bool runConfig(const BenchConfig& cfg, const BenchOptions& opts, BenchResult& result) {
+    result.cfg = cfg;
+
+    if (cfg.width > opts.sensorWidth || cfg.height > opts.sensorHeight) {
+        spdlog::error("Region {}x{} does not fit the {}x{} sensor", cfg.width, cfg.height, opts.sensorWidth, opts.sensorHeight);
+        return false;
+    }
+
+    //synthetic camera reads its configuration when opened
+    setenv("DBGCAM_WIDTH", std::to_string(opts.sensorWidth).c_str(), 1);
+    setenv("DBGCAM_HEIGHT", std::to_string(opts.sensorHeight).c_str(), 1);
+    setenv("DBGCAM_BITDEPTH", std::to_string(cfg.bitDepth).c_str(), 1);
+    setenv("DBGCAM_FPS", fmt::format("{}", cfg.fps).c_str(), 1);
+    setenv("DBGCAM_PATTERN", opts.pattern.c_str(), 1);
+
+    auto camera = std::make_shared<pmCamera>();
+    if (!camera->Open(0)) {
+        spdlog::error("Failed to open camera");
+        return false;
+    }
+
+    //center the region on the sensor, same as acquisition.region
+    const uint16_t s1 = (opts.sensorWidth - cfg.width) / 2;
+    const uint16_t p1 = (opts.sensorHeight - cfg.height) / 2;
+    ExpSettings settings {
+        .acqMode = AcqMode::LiveCircBuffer,
+        .workingDir = opts.dir,
+        .acquisitionDir = opts.dir,
+        .filePrefix = "bench",
+        .region = {
+            .s1 = s1, .s2 = uint16_t(s1 + cfg.width - 1), .sbin = 1,
+            .p1 = p1, .p2 = uint16_t(p1 + cfg.height - 1), .pbin = 1
+        },
+        .storageType = StorageType::Raw,
+        .spdTableIdx = 0,
+        .expTimeMS = std::max<uint32_t>(1, uint32_t(1000.0 / cfg.fps)),
+        .trigMode = EXT_TRIG_INTERNAL,
+        .expModeOut = EXPOSE_OUT_FIRST_ROW,
+        .frameCount = uint32_t(cfg.fps * opts.durationS),
+        .bufferCount = cfg.bufferCount,
+        .zeroCopy = opts.zeroCopy,
+        .framePoolBytes = opts.framePoolMB * 1024 * 1024,
+        .directIo = opts.directIo,
+        .processingWorkers = opts.processingWorkers,
+        .processingQueueDepth = opts.processingQueueDepth
+    };
+
+    if (!camera->SetupExp(settings)) {
+        spdlog::error("Failed to set up exposure");
+        return false;
+    }
+    result.frameBytes = camera->ctx->frameBytes;
+    result.frameCount = settings.frameCount;
+
+    auto acquisition = std::make_unique<pmAcquisition>(camera);
+
+    std::shared_ptr<AsyncFileWriter> writer{nullptr};
+    if (cfg.writer == "auto" || cfg.writer == "io_uring" || cfg.writer == "threads") {
+        const WriterBackend backend = (cfg.writer == "io_uring") ? WriterBackend::IoUring
+            : (cfg.writer == "threads") ? WriterBackend::Threads : WriterBackend::Auto;
+        writer = std::make_shared<AsyncFileWriter>(backend, opts.writerQueueDepth);
+        writer->RegisterBuffers({ acquisition->GetFramePoolRegion() });
+    }
+
+    const std::filesystem::path rawPath = opts.dir / fmt::format("bench_{}x{}_{}bit_{}fps.raw", cfg.width, cfg.height, cfg.bitDepth, cfg.fps);
+    std::shared_ptr<RawStreamFile> rawStream{nullptr};
+    if (cfg.writer != "none") {
+        rawStream = std::make_shared<RawStreamFile>(rawPath, camera->ctx->effectiveBitDepth, cfg.width, cfg.height, settings.frameCount, opts.directIo);
+    }
+
+    std::function<void(pm::Frame*)> releaseFrame = [&acquisition](pm::Frame* frame) { acquisition->ReleaseFrame(frame); };
+    std::function<void(FrameCtx*, pm::Frame*)> processFrame = [](FrameCtx*, pm::Frame*) {};
+    if (rawStream) {
+        processFrame = [rawStream, writer, &releaseFrame](FrameCtx* frameCtx, pm::Frame* frame) {
+            processing::writeRawFrame(frameCtx, frame, rawStream.get(), writer.get(), releaseFrame);
+        };
+    }
+
+    const double cpuStart = cpuSeconds();
+    const auto start = std::chrono::steady_clock::now();
+    acquisition->StartAcquisition(nullptr, processFrame);
+    acquisition->WaitForAcquisition();
+    if (rawStream) {
+        rawStream->Close(); //waits for in flight writes
+        result.framesWritten = rawStream->FramesWritten();
+    }
+    result.wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.cpuS = cpuSeconds() - cpuStart;
+
+    result.telemetry = acquisition->GetTelemetry();
+    if (writer) {
+        result.telemetry.write = writer->Stats();
+    }
+
+    acquisition->StopAll();
+    acquisition->WaitForStop();
+    writer.reset();
+    acquisition.reset();
+    camera->Close();
+
+    if (rawStream && !opts.keepFiles) {
+        std::error_code ec;
+        std::filesystem::remove(rawPath, ec);
+        std::filesystem::remove(std::filesystem::path(rawPath).replace_extension(".idx"), ec);
+    }
+
+    result.ok = true;
+    return true;
+}
+
+
+/*
+* Formats the measurements of one configuration as a JSON object.
+*/
+static std::string resultJson(const BenchResult& r) {
+    const pm::AcquisitionTelemetry& t = r.telemetry;
+    const double wall = std::max(r.wallS, 1e-9);
+    const uint64_t dropped = t.lostFrames + t.pipelineGaps;
+    auto busy = [wall](const StageStats& s) { return 100.0 * s.serviceTotalNS / 1e9 / wall; };
+    auto latency = [](const LatencySummary& l) {
+        return fmt::format(R"({{"p50_us": {:.3f}, "p99_us": {:.3f}, "max_us": {:.3f}}})", l.p50NS / 1000.0, l.p99NS / 1000.0, l.maxNS / 1000.0);
+    };
+
+    std::string json = "  {\n";
+    json += fmt::format(R"(    "config": {{"fps": {}, "width": {}, "height": {}, "bit_depth": {}, "buffer_count": {}, "writer": "{}"}},)" "\n",
+        r.cfg.fps, r.cfg.width, r.cfg.height, r.cfg.bitDepth, r.cfg.bufferCount, r.cfg.writer);
+    json += fmt::format(R"(    "ok": {},)" "\n", r.ok);
+    if (r.ok) {
+        const double fps = t.framesProcessed / wall;
+        json += fmt::format(R"(    "frame_bytes": {},)" "\n", r.frameBytes);
+        json += fmt::format(R"(    "frame_count": {},)" "\n", r.frameCount);
+        json += fmt::format(R"(    "wall_s": {:.3f},)" "\n", r.wallS);
+        json += fmt::format(R"(    "sustained_fps": {:.2f},)" "\n", fps);
+        json += fmt::format(R"(    "sustained": {},)" "\n", dropped == 0 && t.framesProcessed >= r.frameCount);
+        json += fmt::format(R"(    "dropped_frames": {},)" "\n", dropped);
+        json += fmt::format(R"(    "disk_mb_s": {:.2f},)" "\n", r.framesWritten * double(r.frameBytes) / (1024.0 * 1024.0) / wall);
+        json += fmt::format(R"(    "cpu": {{"process_pct": {:.1f}, "copy_pct": {:.1f}, "process_stage_pct": {:.1f}, "write_pct": {:.1f}}},)" "\n",
+            100.0 * r.cpuS / wall, busy(t.pipeline.copy), busy(t.pipeline.process), busy(t.write));
+        json += fmt::format(R"(    "latency": {{"copy": {}, "process": {}, "write": {}}},)" "\n",
+            latency(t.copyLatency), latency(t.processLatency), latency(t.writeLatency));
+
+        //full telemetry, indented to nest in this object
+        std::string telemetry = t.ToJson();
+        while (!telemetry.empty() && telemetry.back() == '\n') { telemetry.pop_back(); }
+        std::string nested;
+        for (char c : telemetry) {
+            nested += c;
+            if (c == '\n') { nested += "    "; }
+        }
+        json += fmt::format(R"(    "telemetry": {})" "\n", nested);
+    }
+    json += "  }";
+    return json;
+}
+
+
+/*
+* Parses a "WxH" region size.
+*/
+static bool parseRoi(const std::string& s, uint16_t& width, uint16_t& height) {
+    const size_t x = s.find('x');
+    if (x == std::string::npos) {
+        return false;
+    }
+    width = uint16_t(std::strtoul(s.substr(0, x).c_str(), nullptr, 10));
+    height = uint16_t(std::strtoul(s.substr(x + 1).c_str(), nullptr, 10));
+    return width > 0 && height > 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("bench_acquisition", "End-to-end acquisition throughput benchmark against the synthetic camera");
+    options.add_options()
+      ("f,fps", "Frame rates to sweep", cxxopts::value<std::vector<double>>()->default_value("100,250"))
+      ("r,roi", "Region sizes to sweep, WxH", cxxopts::value<std::vector<std::string>>()->default_value("1024x1024"))
+      ("b,bit_depth", "Sensor bit depths to sweep", cxxopts::value<std::vector<int>>()->default_value("12"))
+      ("n,buffers", "Camera circular buffer counts to sweep", cxxopts::value<std::vector<uint32_t>>()->default_value("64"))
+      ("w,writer", "Writer modes to sweep (none, sync, auto, io_uring, threads)", cxxopts::value<std::vector<std::string>>()->default_value("auto"))
+      ("d,duration", "Seconds per configuration", cxxopts::value<double>()->default_value("5"))
+      ("sensor", "Synthetic sensor size, WxH", cxxopts::value<std::string>()->default_value("3200x3200"))
+      ("pattern", "Synthetic frame pattern (ramp, noise, wells)", cxxopts::value<std::string>()->default_value("ramp"))
+      ("workers", "Frame processing workers", cxxopts::value<uint32_t>()->default_value("2"))
+      ("queue_depth", "Frame processing queue depth", cxxopts::value<uint32_t>()->default_value("64"))
+      ("writer_queue_depth", "Async writer queue depth", cxxopts::value<uint32_t>()->default_value("16"))
+      ("pool_mb", "Frame pool budget in MB, 0 for default", cxxopts::value<uint64_t>()->default_value("0"))
+      ("zero_copy", "Enable zero copy frames")
+      ("direct_io", "Write raw files with direct io")
+      ("o,outdir", "Directory raw files are written to", cxxopts::value<std::string>()->default_value("."))
+      ("j,json", "Results file, stdout if not set", cxxopts::value<std::string>())
+      ("keep", "Keep raw files")
+      ("v,verbose", "Log acquisition messages")
+      ("h,help", "Usage")
+    ;
+
+    auto userargs = options.parse(argc, argv);
+    if (userargs.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    spdlog::set_level(userargs.count("verbose") ? spdlog::level::info : spdlog::level::warn);
+
+    BenchOptions opts {
+        .durationS = userargs["duration"].as<double>(),
+        .pattern = userargs["pattern"].as<std::string>(),
+        .processingWorkers = userargs["workers"].as<uint32_t>(),
+        .processingQueueDepth = userargs["queue_depth"].as<uint32_t>(),
+        .writerQueueDepth = userargs["writer_queue_depth"].as<uint32_t>(),
+        .framePoolMB = userargs["pool_mb"].as<uint64_t>(),
+        .zeroCopy = userargs.count("zero_copy") > 0,
+        .directIo = userargs.count("direct_io") > 0,
+        .keepFiles = userargs.count("keep") > 0,
+        .dir = userargs["outdir"].as<std::string>(),
+    };
+    if (!parseRoi(userargs["sensor"].as<std::string>(), opts.sensorWidth, opts.sensorHeight)) {
+        spdlog::error("Invalid sensor size {}", userargs["sensor"].as<std::string>());
+        return 1;
+    }
+    std::filesystem::create_directories(opts.dir);
+
+    std::vector<BenchConfig> sweep;
+    for (double fps : userargs["fps"].as<std::vector<double>>()) {
+        for (const auto& roi : userargs["roi"].as<std::vector<std::string>>()) {
+            uint16_t width, height;
+            if (!parseRoi(roi, width, height)) {
+                spdlog::error("Invalid region size {}", roi);
+                return 1;
+            }
+            for (int bitDepth : userargs["bit_depth"].as<std::vector<int>>()) {
+                for (uint32_t buffers : userargs["buffers"].as<std::vector<uint32_t>>()) {
+                    for (const auto& writer : userargs["writer"].as<std::vector<std::string>>()) {
+                        sweep.push_back({ fps, width, height, int16_t(bitDepth), buffers, writer });
+                    }
+                }
+            }
+        }
+    }
+
+    std::string json = "[\n";
+    for (size_t i = 0; i < sweep.size(); i++) {
+        const BenchConfig& cfg = sweep[i];
+        std::cerr << fmt::format("[{}/{}] {} fps, {}x{}, {} bit, {} buffers, writer {}", i + 1, sweep.size(),
+            cfg.fps, cfg.width, cfg.height, cfg.bitDepth, cfg.bufferCount, cfg.writer) << std::endl;
+
+        BenchResult result;
+        if (!runConfig(cfg, opts, result)) {
+            spdlog::error("Configuration {} failed", i + 1);
+        }
+        json += resultJson(result);
+        json += (i + 1 < sweep.size()) ? ",\n" : "\n";
+    }
+    json += "]\n";
+
+    if (userargs.count("json")) {
+        std::ofstream out(userargs["json"].as<std::string>(), std::ios::trunc);
+        out << json;
+        if (!out) {
+            spdlog::error("Could not write {}", userargs["json"].as<std::string>());
+            return 1;
+        }
+    } else {
+        std::cout << json;
+    }
+
+    return 0;
+}
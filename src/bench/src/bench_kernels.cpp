@@ -0,0 +1,520 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  bench_kernels.cpp
+ *
+ * @brief Microbenchmarks for the pixel kernels in src/common.
+ *
+ * Every kernel runs on fixed seed frames at the camera frame size and the
+ * stitched mosaic size for each bit depth and, for the ParTask kernels, each
+ * thread count. Median time, GB/s and ns/pixel are written as JSON together
+ * with a checksum of the kernel output so optimised kernels can be checked
+ * against earlier runs.
+ *********************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <ParTask.h>
+#include <MappedFile.h>
+#include <PMemCopy.h>
+#include <PostProcess.h>
+#include <RawFile.h>
+#include <Rois.h>
+#include <TaskApplyLinear16.h>
+#include <TaskApplyLut16.h>
+#include <TaskFrameLut16.h>
+#include <TaskFrameStats.h>
+#include <TaskTileMosaic.h>
+#include <processing/BackgroundProcess.h>
+
+/*
+* Input of a kernel run.
+*/
+struct KernelInput {
+    uint32_t width{0};
+    uint32_t height{0};
+    uint8_t bitDepth{0};
+    uint8_t bytesPerPixel{0};
+    uint8_t threads{1};
+    std::vector<uint8_t> data;
+};
+
+/*
+* Timings of one kernel, size, bit depth and thread count.
+*/
+struct KernelResult {
+    std::string kernel;
+    uint32_t width{0};
+    uint32_t height{0};
+    uint8_t bitDepth{0};
+    uint8_t threads{1};
+    uint64_t pixels{0};     // pixels (or table entries) processed per iteration
+    uint64_t bytes{0};      // bytes read and written per iteration
+    uint32_t iterations{0};
+    double medianNS{0.0};
+    double minNS{0.0};
+    uint64_t checksum{0};
+};
+
+/*
+* A benchmarked kernel, run returns a checksum of its output when asked for one.
+*/
+struct Kernel {
+    std::string name;
+    bool threaded{false};
+    std::function<bool(const KernelInput&)> supported;
+    std::function<uint64_t(const KernelInput&, uint64_t& pixels, uint64_t& bytes, bool checksum)> run;
+};
+
+
+/*
+* Fills a frame with fixed seed pixel values of the given bit depth.
+*/
+static std::vector<uint8_t> makeFrame(uint32_t width, uint32_t height, uint8_t bitDepth, uint64_t seed) {
+    const uint8_t bytesPerPixel = bitDepth > 8 ? 2 : 1;
+    const uint32_t mask = (1u << bitDepth) - 1;
+    std::vector<uint8_t> data(size_t(width) * height * bytesPerPixel);
+    std::mt19937_64 rng(seed ^ (uint64_t(width) << 32) ^ (uint64_t(height) << 16) ^ bitDepth);
+
+    const size_t n = size_t(width) * height;
+    for (size_t i = 0; i < n; i++) {
+        const uint32_t v = uint32_t(rng()) & mask;
+        if (bytesPerPixel == 1) {
+            data[i] = uint8_t(v);
+        } else {
+            reinterpret_cast<uint16_t*>(data.data())[i] = uint16_t(v);
+        }
+    }
+    return data;
+}
+
+
+static uint64_t fnv1a(const void* data, size_t bytes, uint64_t h = 0xcbf29ce484222325ULL) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < bytes; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+
+/*
+* Builds the kernel table. ParTask kernels share one executor per thread count,
+* the thread waiting on a task counts as one of its threads.
+*/
+static std::vector<Kernel> makeKernels(const std::filesystem::path& tmpDir) {
+    auto executor = [](uint8_t threads) {
+        static std::vector<std::shared_ptr<ParTask>> executors(256);
+        if (!executors[threads]) {
+            executors[threads] = std::make_shared<ParTask>(threads - 1);
+        }
+        return executors[threads];
+    };
+
+    std::vector<Kernel> kernels;
+
+    kernels.push_back({
+        .name = "TaskFrameStats",
+        .threaded = true,
+        .supported = [](const KernelInput&) { return true; },
+        .run = [executor](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            static std::vector<uint32_t> hist(1 << 16);
+            static std::vector<std::shared_ptr<TaskFrameStats>> tasks(256);
+            auto& task = tasks[in.threads];
+            if (!task) {
+                task = std::make_shared<TaskFrameStats>(in.threads);
+            }
+            task->Setup(in.data.data(), hist.data(), in.width, in.height, in.bytesPerPixel, in.bitDepth);
+            executor(in.threads)->Start(task);
+
+            uint32_t min, max, hmax;
+            task->Results(min, max, hmax);
+            pixels = uint64_t(in.width) * in.height;
+            bytes = in.data.size();
+            return checksum ? fnv1a(hist.data(), sizeof(uint32_t) * task->Bins(), (uint64_t(min) << 32) | max) : 0;
+        },
+    });
+
+    kernels.push_back({
+        .name = "TaskFrameLut16",
+        .threaded = true,
+        .supported = [](const KernelInput&) { return true; },
+        .run = [executor](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            static auto task = std::make_shared<TaskFrameLut16>();
+            task->Setup(0, (1u << in.bitDepth) - 1);
+            executor(in.threads)->Start(task, in.threads);
+
+            //table build, independent of the frame size
+            pixels = 1 << 16;
+            bytes = pixels * sizeof(uint16_t);
+            return checksum ? fnv1a(task->Results(), bytes) : 0;
+        },
+    });
+
+    kernels.push_back({
+        .name = "TaskApplyLut16",
+        .threaded = true,
+        .supported = [](const KernelInput& in) { return in.bytesPerPixel == 2; },
+        .run = [executor](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            static std::vector<uint16_t> lut(1 << 16);
+            static std::vector<uint16_t> out;
+            const size_t n = size_t(in.width) * in.height;
+            if (lut[1] == 0) {
+                for (size_t i = 0; i < lut.size(); i++) { lut[i] = uint16_t(65535 - i); }
+            }
+            out.resize(n);
+
+            auto task = std::make_shared<TaskApplyLut16>();
+            task->Setup(reinterpret_cast<const uint16_t*>(in.data.data()), out.data(), lut.data(), n);
+            executor(in.threads)->Start(task, in.threads);
+
+            pixels = n;
+            bytes = 2 * n * sizeof(uint16_t);
+            return checksum ? fnv1a(out.data(), n * sizeof(uint16_t)) : 0;
+        },
+    });
+
+    kernels.push_back({
+        .name = "TaskApplyLinear16",
+        .threaded = true,
+        .supported = [](const KernelInput& in) { return in.bytesPerPixel == 2; },
+        .run = [executor](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            static std::vector<uint16_t> out;
+            const size_t n = size_t(in.width) * in.height;
+            out.resize(n);
+
+            auto task = std::make_shared<TaskApplyLinear16>();
+            task->Setup(reinterpret_cast<const uint16_t*>(in.data.data()), out.data(), n, 64, (1u << in.bitDepth) - 64);
+            executor(in.threads)->Start(task, in.threads);
+
+            pixels = n;
+            bytes = 2 * n * sizeof(uint16_t);
+            return checksum ? fnv1a(out.data(), n * sizeof(uint16_t)) : 0;
+        },
+    });
+
+    kernels.push_back({
+        .name = "TaskApplyLinear8",
+        .threaded = true,
+        .supported = [](const KernelInput& in) { return in.bytesPerPixel == 2; },
+        .run = [executor](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            static std::vector<uint8_t> out;
+            const size_t n = size_t(in.width) * in.height;
+            out.resize(n);
+
+            auto task = std::make_shared<TaskApplyLinear16>();
+            task->Setup(reinterpret_cast<const uint16_t*>(in.data.data()), out.data(), n, 64, (1u << in.bitDepth) - 64);
+            executor(in.threads)->Start(task, in.threads);
+
+            pixels = n;
+            bytes = n * (sizeof(uint16_t) + sizeof(uint8_t));
+            return checksum ? fnv1a(out.data(), n) : 0;
+        },
+    });
+
+    kernels.push_back({
+        .name = "PMemCopy",
+        .threaded = true,
+        .supported = [](const KernelInput&) { return true; },
+        .run = [executor](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            static std::vector<uint8_t> out;
+            out.resize(in.data.size());
+
+            auto task = std::make_shared<PMemCopy>();
+            task->Copy(out.data(), in.data.data(), in.data.size());
+            executor(in.threads)->Start(task, PMemCopy::Parts(in.data.size()));
+
+            pixels = uint64_t(in.width) * in.height;
+            bytes = 2 * in.data.size();
+            return checksum ? fnv1a(out.data(), out.size()) : 0;
+        },
+    });
+
+    kernels.push_back({
+        .name = "Downsample",
+        .threaded = false,
+        .supported = [](const KernelInput&) { return true; },
+        .run = [tmpDir](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            constexpr uint8_t binFactor = 2;
+            static std::shared_ptr<RawFile<6>> out;
+            static std::tuple<uint32_t, uint32_t, uint8_t> outShape{};
+            const auto shape = std::make_tuple(in.width, in.height, in.bitDepth);
+            if (!out || outShape != shape) {
+                out.reset();
+                out = std::make_shared<RawFile<6>>(tmpDir / "bench_downsample.raw", in.bytesPerPixel * 8, in.width / binFactor, in.height / binFactor);
+                outShape = shape;
+            }
+
+            if (in.bytesPerPixel == 1) {
+                PostProcess::Downsample<uint8_t>(0, const_cast<uint8_t*>(in.data.data()), out, in.width, in.height, binFactor);
+            } else {
+                PostProcess::Downsample<uint16_t>(0, reinterpret_cast<uint16_t*>(const_cast<uint8_t*>(in.data.data())), out, in.width, in.height, binFactor);
+            }
+
+            pixels = uint64_t(in.width) * in.height;
+            bytes = in.data.size() + in.data.size() / (binFactor * binFactor);
+            return uint64_t(0);
+        },
+    });
+
+    kernels.push_back({
+        .name = "CopyRawTask",
+        .threaded = false,
+        .supported = [](const KernelInput&) { return true; },
+        .run = [tmpDir](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            //the file is mapped once and read every iteration, as auto tiling does
+            static std::unique_ptr<MappedFile> file;
+            static std::vector<uint8_t> out;
+            static std::tuple<uint32_t, uint32_t, uint8_t> fileShape{};
+            const auto shape = std::make_tuple(in.width, in.height, in.bitDepth);
+            if (!file || fileShape != shape) {
+                const std::filesystem::path path = tmpDir / "bench_copyraw.raw";
+                file.reset();
+                {
+                    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+                    f.write(reinterpret_cast<const char*>(in.data.data()), in.data.size());
+                }
+                file = std::make_unique<MappedFile>(path);
+                fileShape = shape;
+            }
+            out.resize(in.data.size());
+
+            PostProcess::CopyRawTask(*file, 0, out.data(), in.width, in.height, 1, in.bytesPerPixel, false, true);
+
+            pixels = uint64_t(in.width) * in.height;
+            bytes = 2 * in.data.size();
+            return checksum ? fnv1a(out.data(), out.size()) : 0;
+        },
+    });
+
+    kernels.push_back({
+        .name = "TaskTileMosaic",
+        .threaded = true,
+        .supported = [](const KernelInput&) { return true; },
+        .run = [executor](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            //the frame as all four tiles of a flipped 2x2 mosaic, binned by 2
+            constexpr uint8_t binFactor = 2;
+            static std::vector<uint8_t> mosaic, binned;
+            mosaic.resize(4 * in.data.size());
+            binned.resize(in.data.size());
+
+            static auto task = std::make_shared<TaskTileMosaic>();
+            std::vector<const uint8_t*> tiles(4, in.data.data());
+            task->Setup(tiles, in.width, in.height, 2, 2, in.bytesPerPixel, true, true, mosaic.data(), binned.data(), binFactor);
+            executor(in.threads)->Start(task, in.threads);
+
+            pixels = 4 * uint64_t(in.width) * in.height;
+            bytes = 2 * mosaic.size() + binned.size();
+            return checksum ? fnv1a(binned.data(), binned.size(), fnv1a(mosaic.data(), mosaic.size())) : 0;
+        },
+    });
+
+    kernels.push_back({
+        .name = "RoiEngine<64,64>",
+        .threaded = false,
+        .supported = [](const KernelInput&) { return true; },
+        .run = [](const KernelInput& in, uint64_t& pixels, uint64_t& bytes, bool checksum) {
+            //one 64x64 roi every 128 pixels, about the density of a 96 well plate fov
+            static std::unique_ptr<processing::RoiEngine> engine;
+            static uint32_t engineWidth = 0, engineHeight = 0;
+            if (!engine || engineWidth != in.width || engineHeight != in.height) {
+                std::vector<std::tuple<uint32_t, uint32_t>> offsets;
+                for (uint32_t y = 0; y + 64 <= in.height; y += 128) {
+                    for (uint32_t x = 0; x + 64 <= in.width; x += 128) {
+                        offsets.emplace_back(x, y);
+                    }
+                }
+                engine = std::make_unique<processing::RoiEngine>(offsets, 64, 64, in.width, in.height);
+                engineWidth = in.width;
+                engineHeight = in.height;
+            }
+
+            static std::vector<double> means;
+            means.resize(engine->Count());
+            engine->Means(in.data.data(), in.bytesPerPixel * 8, means.data());
+
+            pixels = engine->Count() * 64 * 64;
+            bytes = pixels * in.bytesPerPixel;
+            return checksum ? uint64_t(std::reduce(means.begin(), means.end(), 0.0) * 1000.0) : 0;
+        },
+    });
+
+    return kernels;
+}
+
+
+/*
+* Runs a kernel until both the minimum iteration count and minimum time are reached.
+*/
+static KernelResult timeKernel(const Kernel& kernel, const KernelInput& in, uint32_t minIterations, double minTimeS) {
+    KernelResult result {
+        .kernel = kernel.name,
+        .width = in.width,
+        .height = in.height,
+        .bitDepth = in.bitDepth,
+        .threads = in.threads,
+    };
+
+    //warm up caches and lazily created executors, output buffers and files
+    result.checksum = kernel.run(in, result.pixels, result.bytes, true);
+
+    std::vector<double> samples;
+    const auto start = std::chrono::steady_clock::now();
+    while (samples.size() < minIterations || std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < minTimeS) {
+        const auto t0 = std::chrono::steady_clock::now();
+        kernel.run(in, result.pixels, result.bytes, false);
+        samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    result.iterations = uint32_t(samples.size());
+    result.medianNS = samples[samples.size() / 2];
+    result.minNS = samples.front();
+    return result;
+}
+
+
+/*
+* Parses a "WxH" frame size.
+*/
+static bool parseSize(const std::string& s, uint32_t& width, uint32_t& height) {
+    const size_t x = s.find('x');
+    if (x == std::string::npos) {
+        return false;
+    }
+    width = uint32_t(std::strtoul(s.substr(0, x).c_str(), nullptr, 10));
+    height = uint32_t(std::strtoul(s.substr(x + 1).c_str(), nullptr, 10));
+    return width > 0 && height > 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("bench_kernels", "Microbenchmarks for the pixel kernels");
+    options.add_options()
+      ("s,size", "Frame sizes, WxH", cxxopts::value<std::vector<std::string>>()->default_value("1024x1024,3072x2048"))
+      ("b,bit_depth", "Bit depths", cxxopts::value<std::vector<int>>()->default_value("8,12,16"))
+      ("t,threads", "Thread counts for the ParTask kernels", cxxopts::value<std::vector<int>>()->default_value("1,2,4"))
+      ("k,kernel", "Only run kernels whose name contains this", cxxopts::value<std::string>()->default_value(""))
+      ("i,iterations", "Minimum iterations per measurement", cxxopts::value<uint32_t>()->default_value("10"))
+      ("min_time", "Minimum seconds per measurement", cxxopts::value<double>()->default_value("0.25"))
+      ("seed", "Input data seed", cxxopts::value<uint64_t>()->default_value("1"))
+      ("tmpdir", "Directory for the files written by Downsample and CopyRawTask", cxxopts::value<std::string>()->default_value(std::filesystem::temp_directory_path().string()))
+      ("j,json", "Results file, stdout if not set", cxxopts::value<std::string>())
+      ("h,help", "Usage")
+    ;
+
+    auto userargs = options.parse(argc, argv);
+    if (userargs.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    const std::filesystem::path tmpDir = userargs["tmpdir"].as<std::string>();
+    const std::string filter = userargs["kernel"].as<std::string>();
+    const uint32_t minIterations = userargs["iterations"].as<uint32_t>();
+    const double minTimeS = userargs["min_time"].as<double>();
+    const uint64_t seed = userargs["seed"].as<uint64_t>();
+    const std::vector<Kernel> kernels = makeKernels(tmpDir);
+
+    std::vector<KernelResult> results;
+    for (const auto& size : userargs["size"].as<std::vector<std::string>>()) {
+        uint32_t width, height;
+        if (!parseSize(size, width, height)) {
+            spdlog::error("Invalid frame size {}", size);
+            return 1;
+        }
+
+        for (int bitDepth : userargs["bit_depth"].as<std::vector<int>>()) {
+            KernelInput in {
+                .width = width,
+                .height = height,
+                .bitDepth = uint8_t(bitDepth),
+                .bytesPerPixel = uint8_t(bitDepth > 8 ? 2 : 1),
+                .data = makeFrame(width, height, uint8_t(bitDepth), seed),
+            };
+
+            for (const auto& kernel : kernels) {
+                if (kernel.name.find(filter) == std::string::npos || !kernel.supported(in)) {
+                    continue;
+                }
+
+                std::vector<int> threadCounts{1};
+                if (kernel.threaded) {
+                    threadCounts = userargs["threads"].as<std::vector<int>>();
+                }
+
+                for (int threads : threadCounts) {
+                    in.threads = uint8_t(std::clamp(threads, 1, 255));
+                    results.push_back(timeKernel(kernel, in, minIterations, minTimeS));
+
+                    const KernelResult& r = results.back();
+                    std::cerr << fmt::format("{:<16} {}x{} {:>2} bit {:>2} threads: {:>10.1f} us, {:>7.2f} GB/s, {:.3f} ns/pixel",
+                        r.kernel, r.width, r.height, r.bitDepth, r.threads, r.medianNS / 1000.0, r.bytes / r.medianNS, r.medianNS / r.pixels) << std::endl;
+                }
+            }
+        }
+    }
+
+    std::string json = "{\n";
+    json += fmt::format(R"(  "hardware_threads": {},)" "\n", std::thread::hardware_concurrency());
+    json += fmt::format(R"(  "seed": {},)" "\n", seed);
+    json += "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const KernelResult& r = results[i];
+        json += fmt::format(R"(    {{"kernel": "{}", "width": {}, "height": {}, "bit_depth": {}, "threads": {}, "iterations": {}, )"
+                            R"("median_ns": {:.0f}, "min_ns": {:.0f}, "gb_s": {:.3f}, "ns_per_pixel": {:.4f}, "checksum": "{:016x}"}}{})" "\n",
+            r.kernel, r.width, r.height, r.bitDepth, r.threads, r.iterations,
+            r.medianNS, r.minNS, r.bytes / r.medianNS, r.medianNS / r.pixels, r.checksum, (i + 1 < results.size()) ? "," : "");
+    }
+    json += "  ]\n}\n";
+
+    if (userargs.count("json")) {
+        std::ofstream out(userargs["json"].as<std::string>(), std::ios::trunc);
+        out << json;
+        if (!out) {
+            spdlog::error("Could not write {}", userargs["json"].as<std::string>());
+            return 1;
+        }
+    } else {
+        std::cout << json;
+    }
+
+    return 0;
+}
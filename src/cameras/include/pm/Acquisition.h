@@ -35,6 +35,7 @@
 #include <functional>
 #include <memory>
 #include <semaphore>
+#include <string>
 #include <thread>
 
 #include <pvcam/master.h>
@@ -44,6 +45,9 @@
 #include <interfaces/FrameInterface.h>
 #include <interfaces/ColorConfigInterface.h>
 #include <FramePool.h>
+#include <SpscQueue.h>
+#include <Telemetry.h>
+#include <WorkerStage.h>
 #include <TiffFile.h>
 #include <PMemCopy.h>
 
@@ -52,6 +56,71 @@
 
 namespace pm {
 
+    /*
+     * @brief Zero copy frame lease counters.
+     */
+    struct LeaseStats {
+        uint64_t leased{0};
+        uint64_t copied{0};
+        uint64_t overruns{0};
+    };
+
+    /*
+     * @brief Frame pool counters for a single acquisition.
+     */
+    struct PoolStats {
+        uint64_t dropped{0};  // new frames dropped because no pool frame was available
+        uint64_t late{0};     // frames that had to wait for a pool frame to be released
+        uint64_t recycled{0}; // queued frames discarded to make room for newer frames
+    };
+
+    /*
+     * @brief Per stage queue depth and service time counters.
+     */
+    struct PipelineStats {
+        QueueStats callback; // eof callback to frame processing thread
+        StageStats copy;     // lease or deep copy of frame data
+        StageStats process;  // process function (write, roi averaging, ...)
+    };
+
+    /*
+     * @brief Frame loss, ordering and latency counters of a single acquisition.
+     *
+     * Latencies are measured from the eof callback of each frame.
+     */
+    struct AcquisitionTelemetry {
+        uint64_t framesProcessed{0};
+        uint64_t lostFrames{0};                // camera frames never seen by the eof callback
+        std::vector<GapBucket> lostFrameGaps;  // histogram of consecutive lost frames
+        uint64_t pipelineGaps{0};              // frames missing between eof callback and processing
+        uint64_t outOfOrder{0};                // frames dequeued with a frame number not newer than the last one
+        LatencySummary copyLatency;            // until frame data is copied or leased
+        LatencySummary processLatency;         // until the process function returned
+        LatencySummary writeLatency;           // until a retained frame was released (write completed)
+        size_t poolCapacity{0};
+        size_t poolHighWater{0};               // maximum frames in use at the same time
+        PoolStats pool;
+        LeaseStats lease;
+        PipelineStats pipeline;
+        StageStats write;                      // filled by the owner of the async writer, if any
+
+        /*
+         * @brief Formats telemetry as JSON.
+         *
+         * @return JSON document, latencies in microseconds.
+         */
+        std::string ToJson() const;
+
+        /*
+         * @brief Writes telemetry JSON to file.
+         *
+         * @param file Output path.
+         *
+         * @return true if successful, false otherwise.
+         */
+        bool WriteJson(const std::filesystem::path& file) const;
+    };
+
     /*
      * @breif Acquisition controller class.
      *
@@ -69,14 +138,35 @@ namespace pm {
                 bool m_hasNotified{false};
 
                 bool m_running{ false };
-                bool m_diskThreadAbortFlag{ false };
+                std::atomic<bool> m_diskThreadAbortFlag{ false };
                 bool m_acquireThreadAbortFlag{ false };
                 AcquisitionState m_state { AcquisitionState::AcqStopped };
 
-                std::mutex m_frameProcessingQueueLock;
-                std::mutex m_frameProcessingLock;
-                std::condition_variable m_frameProcessingCond;
-                std::queue<F*> m_frameProcessingQueue;
+                std::unique_ptr<SpscQueue<F*>> m_frameProcessingQueue{nullptr};
+
+                // frames ready for the process function, served by curExp->processingWorkers threads
+                struct ProcessItem {
+                    F* frame{nullptr};
+                    FrameCtx ctx{};
+                };
+                std::unique_ptr<WorkerStage<ProcessItem>> m_processingStage{nullptr};
+                ServiceTime m_copyTime;
+
+                // frame whose copy is still running on the parallel task executor
+                struct PendingFrame {
+                    F* frame{nullptr};
+                    ParTask::Token copy{};
+                    std::chrono::steady_clock::time_point start{};
+                };
+
+                // telemetry, reset for each acquisition
+                std::atomic<uint64_t> m_lostFrames{0};
+                std::atomic<uint64_t> m_pipelineGaps{0};
+                std::atomic<uint64_t> m_outOfOrder{0};
+                GapHistogram m_lostFrameGaps;
+                LatencyHistogram m_copyLatency;
+                LatencyHistogram m_processLatency;
+                LatencyHistogram m_writeLatency;
 
                 std::mutex m_frameProcessingReadyLock;
                 std::condition_variable m_frameProcessingReadyCond;
@@ -86,13 +176,27 @@ namespace pm {
                 std::condition_variable m_acquisitionFinishedCond;
 
                 std::atomic<size_t> m_frameIndex{0};
-                uint64_t m_framesMax{0};
+                static constexpr uint32_t cDefaultPoolFrames = 1000;
+                uint64_t m_poolBudgetBytes{0};
+                std::atomic<uint64_t> m_framesDropped{0};
+                std::atomic<uint64_t> m_framesLate{0};
+                std::atomic<uint64_t> m_framesRecycled{0};
                 std::unique_ptr<FramePool<F>> m_unusedFramePool{nullptr};
 
                 uint32_t m_lastFrameInCallback{0};
                 uint32_t m_lastFrameInProcessing{0};
                 F* m_latestFrame{nullptr};
 
+                // zero copy leases into the camera circular buffer, one ref count per buffer slot
+                static constexpr size_t cLeaseGuardSlots = 4;
+                std::unique_ptr<std::atomic<uint32_t>[]> m_slotLeases{nullptr};
+                size_t m_slotCount{0};
+                std::atomic<uint32_t> m_latestCameraFrame{0};
+                std::atomic<bool> m_leaseBackoff{false};
+                std::atomic<uint64_t> m_leasedFrames{0};
+                std::atomic<uint64_t> m_copiedFrames{0};
+                std::atomic<uint64_t> m_leaseOverruns{0};
+
                 //TODO color context support
                 //typename TiffFile<F>::ProcHelper m_tiffHelper{};
                 SpdTable m_spdTable{};
@@ -210,6 +314,61 @@ namespace pm {
                  */
                 void LoadTestData(std::string testImgPath);
 
+                /*
+                 * @brief Get frame processing queue occupancy.
+                 *
+                 * @return Depth, capacity and high water mark of the queue between
+                 * the camera callback and the frame processing thread.
+                 */
+                QueueStats GetQueueStats();
+
+                /*
+                 * @brief Get zero copy lease counters.
+                 *
+                 * @return Number of frames processed in place, deep copied and
+                 * overwritten by the camera while leased.
+                 */
+                LeaseStats GetLeaseStats();
+
+                /*
+                 * @brief Get frame pool counters for the current acquisition.
+                 *
+                 * @return Number of dropped, late and recycled frames.
+                 */
+                PoolStats GetPoolStats();
+
+                /*
+                 * @brief Get queue depth and service time of each pipeline stage.
+                 *
+                 * @return Counters of the callback queue, copy and processing stages.
+                 */
+                PipelineStats GetPipelineStats();
+
+                /*
+                 * @brief Get frame loss, ordering, latency and high water counters
+                 * of the current or last acquisition.
+                 *
+                 * @return Telemetry snapshot.
+                 */
+                AcquisitionTelemetry GetTelemetry();
+
+                /*
+                 * @brief Releases a frame the process function retained.
+                 *
+                 * Must be called exactly once for every frame whose FrameCtx::retained
+                 * was set by the process function, safe to call from any thread.
+                 *
+                 * @param frame The frame to release.
+                 */
+                void ReleaseFrame(F* frame) noexcept;
+
+                /*
+                 * @brief Get memory region backing the frame pool.
+                 *
+                 * @return Pair of base address and size in bytes.
+                 */
+                std::pair<void*, size_t> GetFramePoolRegion();
+
             public:
                 std::atomic<size_t> m_capturedFrames{0};
 
@@ -234,6 +393,29 @@ namespace pm {
                  */
                 void startProcessingThread() noexcept;
 
+                /*
+                 * @brief Queues a loaded frame for the processing stage.
+                 *
+                 * Assigns the next acquisition frame index to the frame.
+                 *
+                 * @param frame The frame to process.
+                 */
+                void dispatchFrame(F* frame) noexcept;
+
+                /*
+                 * @brief Runs the process function for one frame, called by the processing stage workers.
+                 *
+                 * Releases the frame unless the process function retained it.
+                 *
+                 * @param item The frame and its context.
+                 */
+                void processFrame(ProcessItem& item) noexcept;
+
+                /*
+                 * @brief Logs pipeline stage counters.
+                 */
+                void logPipelineStats() noexcept;
+
                 /*
                  * @brief Write frame
                 */
@@ -249,6 +431,73 @@ namespace pm {
                  * @param i Frame index value.
                  */
                 void checkLostFrame(uint32_t frameN, uint32_t& lastFrame, uint8_t i) noexcept;
+
+                /*
+                 * @brief Gets an unused frame for the eof callback.
+                 *
+                 * Applies the configured pool policy when the frame pool is empty.
+                 *
+                 * @param frameNr The camera frame number, used for logging.
+                 *
+                 * @return Pointer to frame or nullptr if the new frame has to be dropped.
+                 */
+                F* acquireFrame(uint32_t frameNr) noexcept;
+
+                /*
+                 * @brief Resets zero copy lease state.
+                 *
+                 * Sizes the lease table to the camera circular buffer, must be called
+                 * before the camera is started.
+                 */
+                void resetLeases() noexcept;
+
+                /*
+                 * @brief Makes frame data available for processing.
+                 *
+                 * Leases the camera buffer slot when zero copy is enabled and the
+                 * processing thread is far enough behind the camera, otherwise
+                 * deep copies the frame data.
+                 *
+                 * @param frame The frame to load.
+                 * @param copy Set to the completion token when the frame is copied,
+                 *             the frame data is valid once the token is done.
+                 *
+                 * @return true if successful, false otherwise.
+                 */
+                bool loadFrameData(F* frame, ParTask::Token& copy) noexcept;
+
+                /*
+                 * @brief Finishes loading a frame and hands it on for the current state.
+                 *
+                 * Waits for the frame copy, then dispatches or releases the frame.
+                 *
+                 * @param pending The frame to complete, cleared on return.
+                 * @param captured Set once a frame has been dispatched for capture.
+                 */
+                void completeFrame(PendingFrame& pending, bool& captured) noexcept;
+
+                /*
+                 * @brief Drops any lease held by frame and returns it to the frame pool.
+                 *
+                 * @param frame The frame to release.
+                 */
+                void releaseFrame(F* frame) noexcept;
+
+                /*
+                 * @brief Checks if the camera overwrote or is about to overwrite a leased slot.
+                 *
+                 * Called from the eof callback after the latest frame has been fetched.
+                 */
+                void checkLeaseOverrun() noexcept;
+
+                /*
+                 * @brief Maps a data pointer to a camera buffer slot.
+                 *
+                 * @param data Pointer to frame data.
+                 *
+                 * @return Slot index or -1 if data is not in the camera buffer.
+                 */
+                int64_t slotIndex(const void* data) const noexcept;
         };
 }
 
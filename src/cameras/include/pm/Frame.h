@@ -52,12 +52,15 @@ namespace pm {
             mutable std::mutex m_mutex{};
             void* m_data{nullptr};
             void* m_dataSrc{nullptr};
+            void* m_buffer{nullptr};
+            void* m_leased{nullptr};
 
-            //TODO parameterize allocator alignment
-            Allocator<32> m_allocator{};
+            // sector aligned so owned buffers can be written with direct io
+            Allocator<4096> m_allocator{};
 
             size_t m_frameBytes{0};
             bool m_deepCopy{false};
+            bool m_ownsBuffer{false};
 
             std::shared_ptr<PMemCopy> m_PMemCopy;
             std::shared_ptr<ParTask> m_pTask;
@@ -76,6 +79,18 @@ namespace pm {
             */
             Frame(size_t frameBytes, bool deepCopy, std::shared_ptr<ParTask> pTask);
 
+           /*
+            * @brief Frame constructor.
+            *
+            *  Constructs new deep copy image frame object using an externally
+            *  owned buffer, the buffer must outlive the frame.
+            *
+            * @param buffer Pointer to frameBytes of memory to copy frame data into.
+            * @param frameBytes The size of the frame.
+            * @param pTask Pointer to parallel task executor.
+            */
+            Frame(void* buffer, size_t frameBytes, std::shared_ptr<ParTask> pTask);
+
            /*
             * @brief Frame destructor.
             */
@@ -105,6 +120,39 @@ namespace pm {
              */
             bool CopyData();
 
+            /*
+             * @brief Start copying internal frame data.
+             *
+             *  Like CopyData but returns once the copy is submitted to the parallel
+             *  task executor, the frame data is valid once the token is done.
+             *
+             * @param token Set to the completion token of the copy.
+             *
+             * @return true if successful, false otherwise.
+             */
+            bool CopyDataAsync(ParTask::Token& token);
+
+            /*
+             * @brief Lease internal frame data source.
+             *
+             *  Uses the frame data source in place instead of copying it, GetData
+             *  returns the source pointer until the next Copy or CopyData call.
+             *  The caller must make sure the source is not overwritten while leased.
+             *
+             * @return true if successful, false otherwise.
+             */
+            bool LeaseData();
+
+            /*
+             * @brief End the lease taken by LeaseData.
+             *
+             *  Points the frame back at its own buffer, a pooled frame keeps the
+             *  source pointer of its previous lease otherwise.
+             *
+             * @return The leased source pointer, nullptr if the frame was not leased.
+             */
+            void* EndLease();
+
             /*
              * @brief Copy data from one frame to this frame.
              *
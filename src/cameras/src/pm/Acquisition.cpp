@@ -33,6 +33,7 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <fstream>
 #include <fmt/core.h>
 #include <spdlog/spdlog.h>
 
@@ -46,6 +47,7 @@
 #include <TiffFile.h>
 #include <RawFile.h>
 #include <ThreadPool.h>
+#include <ThreadPolicy.h>
 
 #ifdef _WIN64
 #include <windows.h>
@@ -60,6 +62,16 @@ unsigned long long getTotalSystemMemory()
     GlobalMemoryStatusEx(&status);
     return status.ullTotalPhys;
 }
+#else
+#include <unistd.h>
+/*
+* @brief Gets total system memory available.
+* @return Total system memory in bytes.
+*/
+unsigned long long getTotalSystemMemory()
+{
+    return static_cast<unsigned long long>(::sysconf(_SC_PHYS_PAGES)) * ::sysconf(_SC_PAGESIZE);
+}
 #endif
 
 
@@ -67,44 +79,55 @@ unsigned long long getTotalSystemMemory()
 template<FrameConcept F, ColorConfigConcept C>
 void PV_DECL pm::Acquisition<F, C>::EofCallback(FRAME_INFO* frameInfo, void* ctx) noexcept {
     Acquisition* cls = static_cast<Acquisition*>(ctx);
+    const uint64_t callbackNS = telemetryNowNS();
+
+    // the camera library owns the callback thread, apply the capture policy on its first frame
+    thread_local bool policyApplied = false;
+    if (!policyApplied) {
+        ApplyThreadPolicy(ThreadRole::Capture);
+        policyApplied = true;
+    }
 
     if (!frameInfo) {
         spdlog::error("Invalid Frame");
         return;
     } 
 
-    F* frame = cls->m_unusedFramePool->Acquire();
+    F* frame = cls->acquireFrame(frameInfo->FrameNr);
+    if (!frame) {
+        return;
+    }
+
     if (!cls->m_camera->GetLatestFrame(frame)) {
       //TODO handle error
       spdlog::error("GetLatestFrame failed");
+      cls->m_unusedFramePool->Release(frame);
       return;
     }
+    frame->GetInfo()->callbackNS = callbackNS;
 
     //Check for skipped frames
     const uint32_t cbFrameNr = frameInfo->FrameNr;
+    cls->m_latestCameraFrame.store(cbFrameNr, std::memory_order_release);
+    if (cls->m_camera->ctx->curExp->zeroCopy) {
+        cls->checkLeaseOverrun();
+    }
     if (cls->m_lastFrameInCallback == 0) {// first frame in capture
         cls->m_lastFrameInCallback = cbFrameNr;
     } else {
         cls->checkLostFrame(cbFrameNr, cls->m_lastFrameInCallback, 0);
     }
 
-    if (!frame) {
-        //TODO handle error
-        spdlog::error("Could not acquire unused frame from frame pool");
-        return;
-    }
-
     auto state = cls->GetState();
-    //TODO if m_frameWriterQueue.size is valid
-    {
-        std::unique_lock<std::mutex> lock(cls->m_frameProcessingQueueLock);
-        if (cbFrameNr % 1000 == 0) {
-            spdlog::info("Current Frame ({}), framePoolSize: {}, writerQueue size: {}", cbFrameNr, cls->m_unusedFramePool->Size(), cls->m_frameProcessingQueue.size());
-        }
-        cls->m_frameProcessingQueue.push(frame);
+    if (cbFrameNr % 1000 == 0) {
+        spdlog::info("Current Frame ({}), framePoolSize: {}, writerQueue size: {}", cbFrameNr, cls->m_unusedFramePool->Size(), cls->m_frameProcessingQueue->Size());
+    }
 
+    if (!cls->m_frameProcessingQueue->Push(frame)) {
+        spdlog::error("Frame processing queue full, dropping frame {}", cbFrameNr);
+        cls->m_unusedFramePool->Release(frame);
+        return;
     }
-    cls->m_frameProcessingCond.notify_one();
 
     if (state == AcquisitionState::AcqCapture || state == AcquisitionState::AcqCaptureLiveScan) {
         ++cls->m_capturedFrames;
@@ -118,12 +141,207 @@ template<FrameConcept F, ColorConfigConcept C>
 void pm::Acquisition<F, C>::checkLostFrame(uint32_t frameN, uint32_t &lastFrame, uint8_t i) noexcept {
     std::unique_lock<std::mutex> lock(m_lock);
     if (frameN > lastFrame + 1) {
-        //TODO keep frame stats for lost frames
-        spdlog::warn("({}) Current Frame ({}), Last Frame ({}), framePoolSize: {}, writerQueue size: {}", i, frameN, lastFrame, m_unusedFramePool->Size(), m_frameProcessingQueue.size());
+        const uint32_t gap = frameN - lastFrame - 1;
+        if (i == 0) {
+            m_lostFrames += gap;
+            m_lostFrameGaps.Record(gap);
+        } else {
+            m_pipelineGaps += gap;
+        }
+        spdlog::warn("({}) Current Frame ({}), Last Frame ({}), framePoolSize: {}, writerQueue size: {}", i, frameN, lastFrame, m_unusedFramePool->Size(), m_frameProcessingQueue->Size());
     }
     lastFrame = frameN;
 }
 
+template<FrameConcept F, ColorConfigConcept C>
+F* pm::Acquisition<F, C>::acquireFrame(uint32_t frameNr) noexcept {
+    F* frame = m_unusedFramePool->Acquire();
+    if (frame) {
+        return frame;
+    }
+
+    switch (m_camera->ctx->curExp->poolPolicy) {
+        case PoolPolicy::Block: {
+            frame = m_unusedFramePool->Acquire(std::chrono::milliseconds(m_camera->ctx->curExp->poolTimeoutMS));
+            if (frame) {
+                ++m_framesLate;
+                return frame;
+            }
+            break;
+        }
+        case PoolPolicy::DropOldest: {
+            // queued frames are not leased yet, so they can be reused as is
+            if (m_frameProcessingQueue->TryStealOldest(frame)) {
+                if (m_framesRecycled++ % 100 == 0) {
+                    spdlog::warn("Frame pool empty, recycling oldest queued frame {} for frame {}", frame->GetInfo()->frameNr, frameNr);
+                }
+                return frame;
+            }
+            break;
+        }
+        case PoolPolicy::DropNewest:
+        default:
+            break;
+    }
+
+    if (m_framesDropped++ % 100 == 0) {
+        spdlog::error("Frame pool empty, dropping frame {}, dropped: {}", frameNr, m_framesDropped.load());
+    }
+    return nullptr;
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+void pm::Acquisition<F, C>::resetLeases() noexcept {
+    const size_t slots = m_camera->ctx->curExp->bufferCount;
+    if (!m_slotLeases || m_slotCount != slots) {
+        m_slotLeases = std::make_unique<std::atomic<uint32_t>[]>(slots);
+        m_slotCount = slots;
+    }
+
+    for (size_t i = 0; i < m_slotCount; i++) {
+        m_slotLeases[i].store(0, std::memory_order_relaxed);
+    }
+    m_latestCameraFrame = 0;
+    m_leaseBackoff = false;
+    m_leasedFrames = 0;
+    m_copiedFrames = 0;
+    m_leaseOverruns = 0;
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+int64_t pm::Acquisition<F, C>::slotIndex(const void* data) const noexcept {
+    const uint8_t* base = m_camera->ctx->buffer.get();
+    const uint8_t* ptr = static_cast<const uint8_t*>(data);
+    const size_t frameBytes = m_camera->ctx->frameBytes;
+
+    if (!ptr || !base || ptr < base || frameBytes == 0) {
+        return -1;
+    }
+
+    const size_t idx = static_cast<size_t>(ptr - base) / frameBytes;
+    return (idx < m_slotCount) ? static_cast<int64_t>(idx) : -1;
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+void pm::Acquisition<F, C>::checkLeaseOverrun() noexcept {
+    const int64_t slot = slotIndex(m_camera->ctx->eofFrame);
+    if (slot < 0) {
+        return;
+    }
+
+    // the camera just wrote this slot, anyone still holding it has corrupted data
+    if (m_slotLeases[slot].load(std::memory_order_acquire) > 0) {
+        ++m_leaseOverruns;
+        spdlog::error("Camera overwrote leased buffer slot {}", slot);
+    }
+
+    // the camera is about to wrap onto a leased slot, fall back to deep copies until the writer catches up
+    for (size_t i = 1; i <= cLeaseGuardSlots; i++) {
+        if (m_slotLeases[(slot + i) % m_slotCount].load(std::memory_order_relaxed) > 0) {
+            if (!m_leaseBackoff.exchange(true)) {
+                spdlog::warn("Writer is lagging camera by ~{} frames, disabling zero copy", m_slotCount);
+            }
+            break;
+        }
+    }
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+bool pm::Acquisition<F, C>::loadFrameData(F* frame, ParTask::Token& copy) noexcept {
+    // direct io writes whole sectors, camera buffer slots that do not end on a sector boundary are copied
+    const bool sectorSlots = !m_camera->ctx->curExp->directIo || m_camera->ctx->frameBytes % cDirectIoAlignment == 0;
+
+    if (m_camera->ctx->curExp->zeroCopy && sectorSlots && m_slotCount > 0) {
+        const uint32_t lag = m_latestCameraFrame.load(std::memory_order_acquire) - frame->GetInfo()->frameNr;
+        const size_t margin = std::max<size_t>(m_slotCount / 8, cLeaseGuardSlots);
+
+        if (m_leaseBackoff && lag < m_slotCount / 2) {
+            spdlog::info("Writer caught up with camera, enabling zero copy");
+            m_leaseBackoff = false;
+        }
+
+        if (!m_leaseBackoff && lag + margin < m_slotCount && frame->LeaseData()) {
+            const int64_t slot = slotIndex(frame->GetData());
+            if (slot >= 0) {
+                m_slotLeases[slot].fetch_add(1, std::memory_order_acq_rel);
+                ++m_leasedFrames;
+                return true;
+            }
+            frame->EndLease();
+        }
+    }
+
+    ++m_copiedFrames;
+    return frame->CopyDataAsync(copy);
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+void pm::Acquisition<F, C>::releaseFrame(F* frame) noexcept {
+    // only frames leased by loadFrameData hold a slot, a pooled frame can still
+    // point into the camera buffer from an earlier lease
+    const int64_t slot = slotIndex(frame->EndLease());
+    if (slot >= 0) {
+        m_slotLeases[slot].fetch_sub(1, std::memory_order_acq_rel);
+    }
+    m_unusedFramePool->Release(frame);
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+void pm::Acquisition<F, C>::ReleaseFrame(F* frame) noexcept {
+    m_writeLatency.RecordSince(frame->GetInfo()->callbackNS);
+    releaseFrame(frame);
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+std::pair<void*, size_t> pm::Acquisition<F, C>::GetFramePoolRegion() {
+    return m_unusedFramePool->Region();
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+void pm::Acquisition<F, C>::dispatchFrame(F* frame) noexcept {
+    ProcessItem item {
+        .frame = frame,
+        .ctx = FrameCtx {
+            .width = (m_camera->ctx->curExp->region.s2 - m_camera->ctx->curExp->region.s1 + 1) / m_camera->ctx->curExp->region.sbin,
+            .height = (m_camera->ctx->curExp->region.p2 - m_camera->ctx->curExp->region.p1 + 1) / m_camera->ctx->curExp->region.pbin,
+            .index = m_frameIndex,
+            .bitDepth = m_camera->ctx->effectiveBitDepth,
+        },
+    };
+
+    if (!m_processingStage->Push(std::move(item))) {
+        releaseFrame(frame);
+    }
+    ++m_frameIndex;
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+void pm::Acquisition<F, C>::processFrame(ProcessItem& item) noexcept {
+    // a retained frame may already be released once the process function returns
+    const uint64_t callbackNS = item.frame->GetInfo()->callbackNS;
+    if (m_processFn) {
+        m_processFn(&item.ctx, item.frame);
+    }
+    m_processLatency.RecordSince(callbackNS);
+
+    if (!item.ctx.retained) {
+        releaseFrame(item.frame);
+    }
+
+    if (m_progress) { m_progress(1); }
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+void pm::Acquisition<F, C>::logPipelineStats() noexcept {
+    const PipelineStats stats = GetPipelineStats();
+    spdlog::info("Callback queue depth: {}/{}, high water: {}", stats.callback.depth, stats.callback.capacity, stats.callback.highWater);
+    spdlog::info("Copy stage frames: {}, mean: {:.1f}us, max: {:.1f}us",
+        stats.copy.processed, stats.copy.ServiceMeanUS(), stats.copy.serviceMaxNS / 1000.0);
+    spdlog::info("Processing stage queue depth: {}/{}, high water: {}, frames: {}, mean: {:.1f}us, max: {:.1f}us",
+        stats.process.depth, stats.process.capacity, stats.process.highWater, stats.process.processed,
+        stats.process.ServiceMeanUS(), stats.process.serviceMaxNS / 1000.0);
+}
+
 template<FrameConcept F, ColorConfigConcept C>
 void pm::Acquisition<F, C>::writeFrame(F* frame) noexcept {
     //TODO support different storage types
@@ -173,13 +391,76 @@ void pm::Acquisition<F, C>::writeFrame(F* frame) noexcept {
     return;
 }
 
+template<FrameConcept F, ColorConfigConcept C>
+void pm::Acquisition<F, C>::completeFrame(PendingFrame& pending, bool& captured) noexcept {
+    F* frame = pending.frame;
+    pending.frame = nullptr;
+
+    m_parTask->Wait(pending.copy);
+    m_copyTime.Record(pending.start);
+    m_copyLatency.RecordSince(frame->GetInfo()->callbackNS);
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_latestFrame = frame;
+    }
+
+    switch (m_state) {
+        case AcquisitionState::AcqStopped: {
+            spdlog::info("Shutting down acquisition");
+            m_diskThreadAbortFlag = true;
+            return;
+        }
+        case AcquisitionState::AcqIdle:
+        case AcquisitionState::AcqLiveScan: { //live view only, release frame
+            releaseFrame(frame);
+            return;
+        }
+        case AcquisitionState::AcqCaptureLiveScan:
+        case AcquisitionState::AcqCapture: {
+            if (m_frameIndex >= m_camera->ctx->curExp->frameCount) {
+                spdlog::info("m_frameIndex > frameCount");
+                releaseFrame(frame);
+
+                if (m_state == AcquisitionState::AcqCaptureLiveScan) {
+                    m_state = AcquisitionState::AcqLiveScan;
+                } else {
+                    m_state = AcquisitionState::AcqIdle;
+                }
+
+                // every frame has been processed (or handed off) before the acquisition counts as finished
+                m_processingStage->Drain();
+                logPipelineStats();
+
+                spdlog::info("Notify acquisition finished");
+                std::unique_lock<std::mutex> lock(m_acquisitionFinishedLock);
+                m_acquisitionFinishedCond.notify_all();
+                m_hasNotified = true;
+            } else if (m_frameIndex < m_camera->ctx->curExp->frameCount) {
+                dispatchFrame(frame);
+                captured = true;
+            }
+        }
+    }
+}
+
 template<FrameConcept F, ColorConfigConcept C>
 void pm::Acquisition<F, C>::frameProcessingThread() noexcept {
+    ApplyThreadPolicy(ThreadRole::Capture);
     m_frameIndex = 0;
     F* frame{nullptr};
     m_running = true;
     bool captured = false;
 
+    resetLeases();
+    m_processingStage.reset();
+    m_processingStage = std::make_unique<WorkerStage<ProcessItem>>(
+        "frame processing",
+        m_camera->ctx->curExp->processingQueueDepth,
+        m_camera->ctx->curExp->processingWorkers,
+        [this](ProcessItem& item) { processFrame(item); },
+        ThreadRole::Processing
+    );
+
     if (!m_camera->StartExp((void*)&pm::Acquisition<F, C>::EofCallback, this)) {
         //TODO handle error
         spdlog::error("frameProcessingThread StartExp failed");
@@ -190,27 +471,17 @@ void pm::Acquisition<F, C>::frameProcessingThread() noexcept {
     m_lastFrameInProcessing = 0;
     m_frameProcessingReadyCond.notify_all();
 
+    PendingFrame pending{};
     do {
-        {
-            std::unique_lock<std::mutex> lock(m_frameProcessingLock);
-            if (m_frameProcessingQueue.empty()) {
-                const bool timedOut = !m_frameProcessingCond.wait_for(
-                            lock,
-                            std::chrono::milliseconds(200),
-                            [this]() { return !m_frameProcessingQueue.empty(); }
-                            );
-
-                if (timedOut) {
-                    //TODO handle timeout
-                    continue;
-                }
+        if (pending.frame) {
+            // only look ahead at frames already queued, an idle camera must not hold back the pending frame
+            if (!m_frameProcessingQueue->TryPop(frame)) {
+                completeFrame(pending, captured);
+                continue;
             }
-        } //release lock
-
-        {
-            std::unique_lock<std::mutex> lock(m_frameProcessingQueueLock);
-            frame = m_frameProcessingQueue.front();
-            m_frameProcessingQueue.pop();
+        } else if (!m_frameProcessingQueue->WaitPop(frame, [this]() { return m_diskThreadAbortFlag.load(); })) {
+            // spin briefly then park until the callback publishes a frame or we are stopped
+            continue;
         }
 
         const uint32_t frameNr = frame->GetInfo()->frameNr;
@@ -220,6 +491,7 @@ void pm::Acquisition<F, C>::frameProcessingThread() noexcept {
         } else if (frameNr <= m_lastFrameInProcessing) { //sync frame number
             //TODO log stats on dropped frame
             spdlog::error("Frame number out of order: {}, last frame number was {}, ignoring", frameNr, m_lastFrameInProcessing);
+            ++m_outOfOrder;
 
             // Drop frame for invalid frame number
             m_lastFrameInProcessing = frameNr;
@@ -228,109 +500,57 @@ void pm::Acquisition<F, C>::frameProcessingThread() noexcept {
         // Check to make sure we didn't skip a frame
         checkLostFrame(frameNr, m_lastFrameInProcessing, 1);
 
-        //copy frame
-        if (!frame->CopyData()) {
+        //lease or start copying frame, the copy overlaps handing the previous frame on
+        PendingFrame next{ .frame = frame, .start = std::chrono::steady_clock::now() };
+        frame = nullptr;
+        if (!loadFrameData(next.frame, next.copy)) {
             spdlog::info("Failed to copy frame data");
             return;
         }
-        {
-            std::unique_lock<std::mutex> lock(m_lock);
-            m_latestFrame = frame;
-        }
 
-        switch (m_state) {
-            case AcquisitionState::AcqStopped: {
-                spdlog::info("Shutting down acquisition");
-                m_diskThreadAbortFlag = true;
-                continue;
-            }
-            case AcquisitionState::AcqIdle:
-            case AcquisitionState::AcqLiveScan: { //live view only, release frame
-                m_unusedFramePool->Release(frame);
-                frame = nullptr;
-                continue;
-            }
-            case AcquisitionState::AcqCaptureLiveScan:
-            case AcquisitionState::AcqCapture: {
-                if (m_frameIndex >= m_camera->ctx->curExp->frameCount) {
-                    spdlog::info("m_frameIndex > frameCount");
-                    m_unusedFramePool->Release(frame);
-                    frame = nullptr;
-
-                    if (m_state == AcquisitionState::AcqCaptureLiveScan) {
-                        m_state = AcquisitionState::AcqLiveScan;
-                    } else {
-                        m_state = AcquisitionState::AcqIdle;
-                    }
-
-                    spdlog::info("Notify acquisition finished");
-                    std::unique_lock<std::mutex> lock(m_acquisitionFinishedLock);
-                    m_acquisitionFinishedCond.notify_all();
-                    m_hasNotified = true;
-                } else if (m_frameIndex < m_camera->ctx->curExp->frameCount) {
-                    if (m_processFn) {
-                        FrameCtx frameCtx {
-                            .width = (m_camera->ctx->curExp->region.s2 - m_camera->ctx->curExp->region.s1 + 1) / m_camera->ctx->curExp->region.sbin,
-                            .height = (m_camera->ctx->curExp->region.p2 - m_camera->ctx->curExp->region.p1 + 1) / m_camera->ctx->curExp->region.pbin,
-                            .index = m_frameIndex,
-                            .bitDepth = m_camera->ctx->effectiveBitDepth,
-                            .path = (m_camera->ctx->curExp->acquisitionDir / "data" / fmt::format("{}{:04}.raw", m_camera->ctx->curExp->filePrefix, m_frameIndex)),
-                        };
-
-                        m_processFn(&frameCtx, frame);
-                    }
-
-                    m_unusedFramePool->Release(frame);
-                    ++m_frameIndex;
-                    frame = nullptr;
-
-                    if (m_progress) { m_progress(1); }
-                    captured = true;
-                }
-            }
+        if (pending.frame) {
+            completeFrame(pending, captured);
         }
-
+        pending = std::move(next);
     } while (!m_diskThreadAbortFlag);
 
     spdlog::info("Acquisition finished. flag: {}, frameIndex: {}, frameCount: {}", m_diskThreadAbortFlag, m_frameIndex, m_camera->ctx->curExp->frameCount);
+    spdlog::info("Frame pool dropped: {}, late: {}, recycled: {}", m_framesDropped, m_framesLate, m_framesRecycled);
     m_camera->StopExp();
 
-    while (!m_frameProcessingQueue.empty()) {
-        {
-            std::unique_lock<std::mutex> lock(m_frameProcessingQueueLock);
-            frame = m_frameProcessingQueue.front();
-            m_frameProcessingQueue.pop();
+    if (pending.frame) {
+        m_parTask->Wait(pending.copy);
+        if (captured && m_frameIndex < m_camera->ctx->curExp->frameCount) {
+            dispatchFrame(pending.frame);
+        } else {
+            releaseFrame(pending.frame);
         }
+    }
 
+    while (m_frameProcessingQueue->TryPop(frame)) {
         if (captured) {
-            //copy frame
-            if (!frame->CopyData()) {
+            //lease or copy frame
+            ParTask::Token copy;
+            if (!loadFrameData(frame, copy)) {
                 spdlog::info("Failed to copy frame data");
                 return;
             }
+            m_parTask->Wait(copy);
 
             if (m_frameIndex < m_camera->ctx->curExp->frameCount) {
-                if (m_processFn) {
-                    FrameCtx frameCtx {
-                        .width = (m_camera->ctx->curExp->region.s2 - m_camera->ctx->curExp->region.s1 + 1) / m_camera->ctx->curExp->region.sbin,
-                        .height = (m_camera->ctx->curExp->region.p2 - m_camera->ctx->curExp->region.p1 + 1) / m_camera->ctx->curExp->region.pbin,
-                        .index = m_frameIndex,
-                        .bitDepth = m_camera->ctx->effectiveBitDepth,
-                        .path = (m_camera->ctx->curExp->acquisitionDir / "data" / fmt::format("{}{:04}.raw", m_camera->ctx->curExp->filePrefix, m_frameIndex)),
-                    };
-
-                    m_processFn(&frameCtx, frame);
-                }
-
-                m_unusedFramePool->Release(frame);
-                ++m_frameIndex;
-
-                if (m_progress) { m_progress(1); }
+                dispatchFrame(frame);
+            } else {
+                releaseFrame(frame);
             }
         } else {
-            m_unusedFramePool->Release(frame);
+            releaseFrame(frame);
         }
     }
+    m_processingStage->Drain();
+
+    if (m_camera->ctx->curExp->zeroCopy) {
+        spdlog::info("Zero copy frames leased: {}, copied: {}, overruns: {}", m_leasedFrames, m_copiedFrames, m_leaseOverruns);
+    }
 
     m_processFn = nullptr;
     m_progress = nullptr;
@@ -340,23 +560,29 @@ void pm::Acquisition<F, C>::frameProcessingThread() noexcept {
 template<FrameConcept F, ColorConfigConcept C>
 pm::Acquisition<F, C>::Acquisition(std::shared_ptr<pm::Camera<F>> camera) : m_camera(camera), m_running(false) {
     m_pCopy = std::make_shared<PMemCopy>();
-    m_parTask = std::make_shared<ParTask>(3);
+    // the processing thread runs copy parts as well while it waits on a frame
+    uint32_t copyThreads = m_camera->ctx->curExp->copyThreads;
+    if (copyThreads == 0) {
+        copyThreads = std::clamp<uint32_t>(std::thread::hardware_concurrency() / 4, 1, 4);
+    }
+    m_parTask = std::make_shared<ParTask>(uint8_t(std::min<uint32_t>(copyThreads, 64)), ThreadRole::Copy);
 
-    //TODO preallocate unused frame pool size based on acquisition size
-    const uint64_t bufferCount = m_camera->ctx->curExp->bufferCount;
-    const uint64_t frameCount = m_camera->ctx->curExp->frameCount;
     const uint32_t frameBytes = m_camera->ctx->frameBytes;
 
-#ifdef _WIN64
-    spdlog::info("Total system memory: {}", getTotalSystemMemory());
-    m_framesMax = uint64_t((0.9 * getTotalSystemMemory())  / uint64_t(frameBytes));
-#else
-    m_framesMax = (0xFFFFFFFF - 1) / frameBytes;
-#endif
+    // frame pool is sized from a memory budget, not from the acquisition length
+    const uint64_t systemMemory = getTotalSystemMemory();
+    m_poolBudgetBytes = m_camera->ctx->curExp->framePoolBytes;
+    if (m_poolBudgetBytes == 0) {
+        m_poolBudgetBytes = uint64_t(cDefaultPoolFrames) * frameBytes;
+    }
+    m_poolBudgetBytes = std::min<uint64_t>(m_poolBudgetBytes, uint64_t(0.5 * systemMemory));
+
+    spdlog::info("Total system memory: {}, initializing frame pool with budget {} for frames of size {}", systemMemory, m_poolBudgetBytes, frameBytes);
+    m_unusedFramePool = std::make_unique<FramePool<F>>(m_poolBudgetBytes, frameBytes, m_parTask);
 
-    //TODO parameterize min value
-    spdlog::info("Initializing frame pool with {} objects of size {}", std::min<uint64_t>(1000, frameCount), frameBytes);
-    m_unusedFramePool = std::make_unique<FramePool<F>>(std::min<uint64_t>(1000, m_framesMax), frameBytes, true, m_parTask);
+    // every pooled frame can be queued at once, so the queue never rejects while the pool has frames
+    m_frameProcessingQueue = std::make_unique<SpscQueue<F*>>(m_unusedFramePool->Capacity());
+    spdlog::info("Frame processing queue capacity: {}", m_frameProcessingQueue->Capacity());
 
     spdlog::info("Get speed table {}", m_camera->ctx->curExp->spdTableIdx);
     uint16_t spdTblIdx = m_camera->ctx->curExp->spdTableIdx;
@@ -382,8 +608,22 @@ void pm::Acquisition<F, C>::StartAcquisition(std::function<void(size_t)> progres
     m_hasNotified = false;
     m_frameIndex = 0;
     m_capturedFrames = 0;
+    m_framesDropped = 0;
+    m_framesLate = 0;
+    m_framesRecycled = 0;
+    m_copyTime.Reset();
+    m_lostFrames = 0;
+    m_pipelineGaps = 0;
+    m_outOfOrder = 0;
+    m_lostFrameGaps.Reset();
+    m_copyLatency.Reset();
+    m_processLatency.Reset();
+    m_writeLatency.Reset();
+    m_unusedFramePool->ResetHighWater();
+    if (m_processingStage) {
+        m_processingStage->ResetStats();
+    }
 
-    m_unusedFramePool->EnsurePoolSize(std::min<uint64_t>(m_camera->ctx->curExp->frameCount, m_framesMax));
     startProcessingThread();
 }
 
@@ -469,14 +709,14 @@ template<FrameConcept F, ColorConfigConcept C>
 void pm::Acquisition<F, C>::StopAll() {
     m_diskThreadAbortFlag = true;
     m_state = AcquisitionState::AcqStopped;
-    m_frameProcessingCond.notify_one();
+    m_frameProcessingQueue->Interrupt();
 }
 
 template<FrameConcept F, ColorConfigConcept C>
 void pm::Acquisition<F, C>::WaitForStop() {
     std::unique_lock<std::mutex> lock(m_stopLock);
     if (m_frameProcessingThread && m_running) {
-        m_frameProcessingCond.notify_one();
+        m_frameProcessingQueue->Interrupt();
         m_frameProcessingThread->join();
 
         m_frameProcessingThread = nullptr;
@@ -527,6 +767,61 @@ AcquisitionState pm::Acquisition<F, C>::GetState() {
     return m_state;
 }
 
+template<FrameConcept F, ColorConfigConcept C>
+QueueStats pm::Acquisition<F, C>::GetQueueStats() {
+    return m_frameProcessingQueue->Stats();
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+pm::PipelineStats pm::Acquisition<F, C>::GetPipelineStats() {
+    PipelineStats stats {
+        .callback = m_frameProcessingQueue->Stats(),
+    };
+    m_copyTime.Fill(stats.copy);
+    if (m_processingStage) {
+        stats.process = m_processingStage->Stats();
+    }
+    return stats;
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+pm::AcquisitionTelemetry pm::Acquisition<F, C>::GetTelemetry() {
+    AcquisitionTelemetry telemetry {
+        .framesProcessed = m_frameIndex,
+        .lostFrames = m_lostFrames,
+        .lostFrameGaps = m_lostFrameGaps.Buckets(),
+        .pipelineGaps = m_pipelineGaps,
+        .outOfOrder = m_outOfOrder,
+        .copyLatency = m_copyLatency.Summary(),
+        .processLatency = m_processLatency.Summary(),
+        .writeLatency = m_writeLatency.Summary(),
+        .poolCapacity = m_unusedFramePool->Capacity(),
+        .poolHighWater = m_unusedFramePool->HighWater(),
+        .pool = GetPoolStats(),
+        .lease = GetLeaseStats(),
+        .pipeline = GetPipelineStats(),
+    };
+    return telemetry;
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+pm::LeaseStats pm::Acquisition<F, C>::GetLeaseStats() {
+    return LeaseStats {
+        .leased = m_leasedFrames,
+        .copied = m_copiedFrames,
+        .overruns = m_leaseOverruns,
+    };
+}
+
+template<FrameConcept F, ColorConfigConcept C>
+pm::PoolStats pm::Acquisition<F, C>::GetPoolStats() {
+    return PoolStats {
+        .dropped = m_framesDropped,
+        .late = m_framesLate,
+        .recycled = m_framesRecycled,
+    };
+}
+
 template<FrameConcept F, ColorConfigConcept C>
 void pm::Acquisition<F,C>::LoadTestData(std::string testImgPath) {
     uint32_t width, height;
@@ -535,5 +830,57 @@ void pm::Acquisition<F,C>::LoadTestData(std::string testImgPath) {
     m_fakeData = TiffFile::LoadTIFF(p.string().c_str(), width, height);
 }
 
+/* TELEMETRY */
+std::string pm::AcquisitionTelemetry::ToJson() const {
+    auto latency = [](const LatencySummary& l) {
+        return fmt::format(R"({{"count": {}, "p50_us": {:.3f}, "p99_us": {:.3f}, "max_us": {:.3f}}})",
+            l.count, l.p50NS / 1000.0, l.p99NS / 1000.0, l.maxNS / 1000.0);
+    };
+    auto stage = [](const StageStats& s) {
+        return fmt::format(R"({{"depth": {}, "capacity": {}, "high_water": {}, "items": {}, "service_mean_us": {:.3f}, "service_max_us": {:.3f}}})",
+            s.depth, s.capacity, s.highWater, s.processed, s.ServiceMeanUS(), s.serviceMaxNS / 1000.0);
+    };
+
+    std::string gaps;
+    for (const auto& b : lostFrameGaps) {
+        gaps += fmt::format(R"({}{{"min": {}, "max": {}, "count": {}}})", gaps.empty() ? "" : ", ", b.min, b.max, b.count);
+    }
+
+    std::string json = "{\n";
+    json += fmt::format(R"(  "frames_processed": {},)" "\n", framesProcessed);
+    json += fmt::format(R"(  "lost_frames": {},)" "\n", lostFrames);
+    json += fmt::format(R"(  "lost_frame_gaps": [{}],)" "\n", gaps);
+    json += fmt::format(R"(  "pipeline_gaps": {},)" "\n", pipelineGaps);
+    json += fmt::format(R"(  "out_of_order": {},)" "\n", outOfOrder);
+    json += "  \"latency\": {\n";
+    json += fmt::format(R"(    "callback_to_copy": {},)" "\n", latency(copyLatency));
+    json += fmt::format(R"(    "callback_to_process": {},)" "\n", latency(processLatency));
+    json += fmt::format(R"(    "callback_to_write": {})" "\n", latency(writeLatency));
+    json += "  },\n";
+    json += fmt::format(R"(  "frame_pool": {{"capacity": {}, "high_water": {}, "dropped": {}, "late": {}, "recycled": {}}},)" "\n",
+        poolCapacity, poolHighWater, pool.dropped, pool.late, pool.recycled);
+    json += fmt::format(R"(  "zero_copy": {{"leased": {}, "copied": {}, "overruns": {}}},)" "\n", lease.leased, lease.copied, lease.overruns);
+    json += "  \"stages\": {\n";
+    json += fmt::format(R"(    "callback_queue": {{"depth": {}, "capacity": {}, "high_water": {}, "pushed": {}, "rejected": {}}},)" "\n",
+        pipeline.callback.depth, pipeline.callback.capacity, pipeline.callback.highWater, pipeline.callback.pushed, pipeline.callback.rejected);
+    json += fmt::format(R"(    "copy": {},)" "\n", stage(pipeline.copy));
+    json += fmt::format(R"(    "process": {},)" "\n", stage(pipeline.process));
+    json += fmt::format(R"(    "write": {})" "\n", stage(write));
+    json += "  }\n";
+    json += "}\n";
+    return json;
+}
+
+bool pm::AcquisitionTelemetry::WriteJson(const std::filesystem::path& file) const {
+    std::ofstream out(file, std::ios::trunc);
+    if (!out) {
+        spdlog::error("Could not write telemetry {}", file.string());
+        return false;
+    }
+    out << ToJson();
+    return static_cast<bool>(out);
+}
+
+
 //Avoid link errors
 template class pm::Acquisition<pm::Frame, pm::ColorConfig<ph_color_context>>;
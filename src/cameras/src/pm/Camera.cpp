@@ -786,7 +786,15 @@ bool pm::Camera<F>::updateExp(const ExpSettings& settings) {
             .bufferCount = settings.bufferCount,
             .colorWbScaleRed = settings.colorWbScaleRed,
             .colorWbScaleGreen = settings.colorWbScaleGreen,
-            .colorWbScaleBlue = settings.colorWbScaleBlue
+            .colorWbScaleBlue = settings.colorWbScaleBlue,
+            .zeroCopy = settings.zeroCopy,
+            .framePoolBytes = settings.framePoolBytes,
+            .poolPolicy = settings.poolPolicy,
+            .poolTimeoutMS = settings.poolTimeoutMS,
+            .directIo = settings.directIo,
+            .processingWorkers = settings.processingWorkers,
+            .processingQueueDepth = settings.processingQueueDepth,
+            .copyThreads = settings.copyThreads
         });
 
     return true;
@@ -845,6 +853,7 @@ bool pm::Camera<F>::getLatestFrameIndex(size_t& index) {
         return false;
     }
     index = idx;
+    ctx->eofFrame = data;
 
     //TODO invalidate frame
     /* m_frames[index]->Invalidate(); // Does some cleanup */
@@ -29,6 +29,7 @@
  *********************************************************************/
 #include <cstdint>
 #include <chrono>
+#include <utility>
 
 #include <spdlog/spdlog.h>
 #include <pvcam/master.h>
@@ -47,15 +48,34 @@
 pm::Frame::Frame(size_t frameBytes, bool deepCopy, std::shared_ptr<ParTask> pTask) :
     m_frameBytes(frameBytes), m_deepCopy(deepCopy), m_pTask(pTask) {
     if (deepCopy && frameBytes > 0) { //allocate data if using deepcopy
-        m_data = m_allocator.Allocate(frameBytes);
+        // whole sectors so direct io writes of the padded frame stay inside the buffer
+        m_buffer = m_allocator.Allocate((frameBytes + m_allocator.alignment - 1) & ~(m_allocator.alignment - 1));
+        m_data = m_buffer;
+        m_ownsBuffer = true;
     }
     m_info = new FrameInfo(); 
     m_PMemCopy = std::make_shared<PMemCopy>();
 }
 
+
+/*
+* @breif
+*
+*
+*
+* @param
+*/
+pm::Frame::Frame(void* buffer, size_t frameBytes, std::shared_ptr<ParTask> pTask) :
+    m_buffer(buffer), m_frameBytes(frameBytes), m_deepCopy(true), m_pTask(pTask) {
+    m_data = m_buffer;
+    m_info = new FrameInfo(); 
+    m_PMemCopy = std::make_shared<PMemCopy>();
+}
+
 pm::Frame::~Frame() {
-    if(m_deepCopy) {
-        m_allocator.Free(m_data);
+    if(m_ownsBuffer) {
+        m_allocator.Free(m_buffer);
+        m_buffer = nullptr;
         m_data = nullptr;
     }
 }
@@ -97,6 +117,7 @@ void* pm::Frame::GetData() {
 bool pm::Frame::CopyData() {
     std::unique_lock<std::mutex> lock(m_mutex);
     if (m_deepCopy) {
+        m_data = m_buffer;
         return copyData();
     } else {
         m_data = m_dataSrc;
@@ -105,6 +126,61 @@ bool pm::Frame::CopyData() {
 }
 
 
+/*
+* @breif
+*
+*
+*
+* @param
+*/
+bool pm::Frame::CopyDataAsync(ParTask::Token& token) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_deepCopy) {
+        m_data = m_buffer;
+        m_PMemCopy->Copy(m_buffer, m_dataSrc, m_frameBytes);
+        token = m_pTask->Submit<PMemCopy>(m_PMemCopy, PMemCopy::Parts(m_frameBytes));
+    } else {
+        m_data = m_dataSrc;
+    }
+    return true;
+}
+
+
+/*
+* @breif
+*
+*
+*
+* @param
+*/
+bool pm::Frame::LeaseData() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_dataSrc) {
+        return false;
+    }
+    m_data = m_dataSrc;
+    m_leased = m_dataSrc;
+    return true;
+}
+
+
+/*
+* @breif
+*
+*
+*
+* @param
+*/
+void* pm::Frame::EndLease() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    void* leased = std::exchange(m_leased, nullptr);
+    if (leased && m_data == leased) {
+        m_data = m_buffer;
+    }
+    return leased;
+}
+
+
 /*
 * @breif
 *
@@ -142,6 +218,9 @@ bool pm::Frame::Copy(const Frame& from, bool deepCopy) {
     std::unique_lock<std::mutex> lock(m_mutex);
 
     setData(from.m_dataSrc);
+    if (m_deepCopy) { //drop any lease on the previous source
+        m_data = m_buffer;
+    }
 
     if (deepCopy) {
         if(m_dataSrc && m_data && !copyData()) {
@@ -188,7 +267,7 @@ void pm::Frame::setInfo(const FrameInfo& info) {
 * @param
 */
 bool pm::Frame::copyData() {
-    m_PMemCopy->Copy(m_data, m_dataSrc, m_frameBytes);
-    m_pTask->Start<PMemCopy>(m_PMemCopy);
+    m_PMemCopy->Copy(m_buffer, m_dataSrc, m_frameBytes);
+    m_pTask->Start<PMemCopy>(m_PMemCopy, PMemCopy::Parts(m_frameBytes));
     return true;
 }
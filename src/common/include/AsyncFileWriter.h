@@ -0,0 +1,699 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  AsyncFileWriter.h
+ * 
+ * @brief Definition of the AsyncFileWriter class.
+ *********************************************************************/
+#ifndef ASYNC_FILE_WRITER_H
+#define ASYNC_FILE_WRITER_H
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <RawFile.h>
+#include <ThreadPool.h>
+#include <WorkerStage.h>
+
+#ifdef __linux__
+#include <IoUring.h>
+#endif
+
+/*
+* Async writer backends.
+*/
+enum class WriterBackend : int32_t {
+    Auto,    // io_uring if the kernel supports it, thread pool otherwise
+    IoUring, // io_uring submission/completion rings (Linux only)
+    Threads  // blocking writes on a pool of writer threads
+};
+
+/*
+* One positional write of a batch, see AsyncFileWriter::WriteBatch.
+*/
+struct WriteSegment {
+#ifndef _WIN32
+    int fd{-1};
+#else
+    HANDLE fd{INVALID_HANDLE_VALUE};
+#endif
+    const uint8_t* data{nullptr};
+    size_t bytes{0};
+    uint64_t offset{0};
+};
+
+
+/*
+* Asynchronous frame writer.
+*
+* Keeps up to queueDepth frame writes in flight and calls the completion
+* handler of each write once the data has been handed to the file system,
+* so the caller can recycle the frame buffer only after it has been written.
+* Write blocks while queueDepth writes are outstanding.
+*
+* On Linux writes are issued through io_uring, frame buffers that fall into
+* a registered region (see RegisterBuffers) use fixed buffer writes. If
+* io_uring is not available writes fall back to a thread pool issuing pwrite.
+*/
+class AsyncFileWriter {
+    private:
+        WriterBackend m_backend{WriterBackend::Threads};
+        uint32_t m_queueDepth;
+        std::atomic<uint32_t> m_inFlight{0};
+        std::atomic<uint64_t> m_failed{0};
+        std::atomic<uint32_t> m_highWater{0};
+        ServiceTime m_serviceTime;
+        std::unique_ptr<ThreadPool> m_pool{nullptr};
+
+#ifdef __linux__
+        static constexpr uint64_t cStopTag = ~uint64_t(0);
+        static constexpr size_t cMaxRegionBytes = size_t(1) << 30; // kernel limit per registered buffer
+        static constexpr size_t cMinBatchSegmentBytes = size_t(128) << 10; // smaller buffered writes are punted to io-wq, pwrite is faster
+
+        struct Request {
+            int fd{-1};
+            const uint8_t* data{nullptr};
+            size_t bytes{0};
+            uint64_t offset{0};
+            std::function<void(bool)> done;
+            std::chrono::steady_clock::time_point start;
+            bool timed{true}; // false for segments of a batch, the batch is timed as a whole
+        };
+
+        struct Region {
+            const uint8_t* base;
+            size_t bytes;
+        };
+
+        IoUring m_ring;
+        std::mutex m_submitLock;
+        std::mutex m_requestLock;
+        std::vector<Request> m_requests;
+        std::vector<uint32_t> m_freeRequests;
+        std::vector<Region> m_regions;
+        bool m_started{false};
+        std::thread m_reaper;
+#endif
+
+    public:
+        /*
+        * AsyncFileWriter constructor.
+        *
+        * @param backend Requested backend, falls back to Threads if unavailable.
+        * @param queueDepth Maximum number of writes in flight.
+        */
+        AsyncFileWriter(WriterBackend backend, uint32_t queueDepth) : m_queueDepth(std::max<uint32_t>(1, queueDepth)) {
+#ifdef __linux__
+            if (backend != WriterBackend::Threads) {
+                const int err = m_ring.Init(m_queueDepth);
+                if (err == 0) {
+                    m_backend = WriterBackend::IoUring;
+                    m_requests.resize(m_queueDepth);
+                    for (uint32_t i = m_queueDepth; i > 0; i--) {
+                        m_freeRequests.push_back(i - 1);
+                    }
+                    m_reaper = std::thread(&AsyncFileWriter::reaperThread, this);
+                } else {
+                    spdlog::warn("io_uring unavailable ({}), using thread pool writer", std::strerror(-err));
+                }
+            }
+            if (m_backend == WriterBackend::Threads) {
+                m_pool = std::make_unique<ThreadPool>(m_queueDepth, ThreadRole::Writer);
+            }
+#else
+            (void)backend;
+            // RawFile overlapped writes are not reentrant, a single writer thread keeps them ordered
+            m_pool = std::make_unique<ThreadPool>(1, ThreadRole::Writer);
+#endif
+            spdlog::info("Async file writer backend: {}, queue depth: {}", BackendName(m_backend), m_queueDepth);
+        }
+
+        /*
+        * AsyncFileWriter destructor, waits for all writes to complete.
+        */
+        ~AsyncFileWriter() {
+            Drain();
+#ifdef __linux__
+            if (m_reaper.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(m_submitLock);
+                    io_uring_sqe* sqe = m_ring.GetSqe();
+                    if (sqe) {
+                        sqe->opcode = IORING_OP_NOP;
+                        sqe->user_data = cStopTag;
+                    }
+                    m_ring.Submit();
+                }
+                m_reaper.join();
+            }
+#endif
+            m_pool.reset();
+        }
+
+        AsyncFileWriter(const AsyncFileWriter&) = delete;
+        AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+        /*
+        * Registers memory regions writes are issued from, e.g. the frame pool arena.
+        * Only has an effect with the io_uring backend and before the first write.
+        *
+        * @param regions List of (base address, size in bytes).
+        *
+        * @return true if the regions were registered, false otherwise.
+        */
+        bool RegisterBuffers(const std::vector<std::pair<void*, size_t>>& regions) {
+#ifdef __linux__
+            std::lock_guard<std::mutex> lock(m_submitLock);
+            if (m_backend != WriterBackend::IoUring || m_started || !m_regions.empty()) {
+                return false;
+            }
+
+            std::vector<iovec> iovs;
+            for (auto& [base, bytes] : regions) {
+                for (size_t off = 0; base && off < bytes; off += cMaxRegionBytes) {
+                    iovs.push_back(iovec {
+                        .iov_base = static_cast<uint8_t*>(base) + off,
+                        .iov_len = std::min(cMaxRegionBytes, bytes - off),
+                    });
+                }
+            }
+
+            if (iovs.empty()) {
+                return false;
+            }
+
+            const int err = m_ring.RegisterBuffers(iovs.data(), static_cast<unsigned>(iovs.size()));
+            if (err != 0) {
+                spdlog::warn("io_uring buffer registration failed ({}), using unregistered writes", std::strerror(-err));
+                return false;
+            }
+
+            for (auto& iov : iovs) {
+                m_regions.push_back(Region { static_cast<const uint8_t*>(iov.iov_base), iov.iov_len });
+            }
+            spdlog::info("Registered {} io_uring buffers", m_regions.size());
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        /*
+        * Writes one frame to file at frame index idx.
+        *
+        * The completion handler is called exactly once, from a writer thread or
+        * from this call if the write could not be queued.
+        *
+        * @tparam PWRITES RawFile template parameter.
+        * @param file Destination file.
+        * @param data Frame data, must stay valid until done is called.
+        * @param idx Frame index in file.
+        * @param done Completion handler, called with true if all bytes were written.
+        */
+        template<uint16_t PWRITES>
+        void Write(RawFile<PWRITES>* file, void* data, uint64_t idx, std::function<void(bool)> done) {
+            acquireSlot();
+            const auto start = std::chrono::steady_clock::now();
+
+#ifdef __linux__
+            if (m_backend == WriterBackend::IoUring) {
+                const WriteSegment segment {
+                    .fd = file->NativeHandle(data),
+                    .data = static_cast<const uint8_t*>(data),
+                    .bytes = file->WriteBytes(data),
+                    .offset = idx * file->FrameStride(),
+                };
+                submit(&segment, 1, done, start, true);
+                return;
+            }
+#endif
+
+            m_pool->AddTask([this, file, data, idx, start, done = std::move(done)]() {
+#ifdef __linux__
+                const bool ok = pwriteAll(file->NativeHandle(data), static_cast<const uint8_t*>(data), file->WriteBytes(data), idx * file->FrameStride());
+#else
+                const bool ok = file->Write(data, idx) >= file->FrameBytes();
+#endif
+                complete(done, ok, start);
+            });
+        }
+
+        /*
+        * Writes a batch of segments and waits until all of them completed.
+        *
+        * With io_uring up to queueDepth segments are queued and submitted with a
+        * single io_uring_enter, e.g. the rows of a tile that are scattered over a
+        * mosaic frame. Segments below cMinBatchSegmentBytes are written with pwrite
+        * on the calling thread while the ring writes are in flight, the kernel
+        * can not complete small buffered writes inline and hands them to io-wq
+        * workers, which costs more than the syscall. Without io_uring the segments
+        * are written on the calling thread, overlapped in groups of
+        * MAXIMUM_WAIT_OBJECTS on Windows. The batch counts as one write in the
+        * stage counters.
+        *
+        * @param segments Segments to write, their data must stay valid until this returns.
+        *
+        * @return true if all bytes of all segments were written, false otherwise.
+        */
+        bool WriteBatch(const std::vector<WriteSegment>& segments) {
+            if (segments.empty()) {
+                return true;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            bool ok = true;
+
+#ifdef __linux__
+            if (m_backend == WriterBackend::IoUring) {
+                thread_local std::vector<WriteSegment> ringSegments;
+                ringSegments.clear();
+                for (const WriteSegment& segment : segments) {
+                    if (segment.bytes >= cMinBatchSegmentBytes) {
+                        ringSegments.push_back(segment);
+                    }
+                }
+
+                //notified under the lock so the waiter can not return while a completion still uses the state
+                struct {
+                    std::mutex lock;
+                    std::condition_variable cond;
+                    size_t remaining;
+                    bool ok{true};
+                } batch;
+                batch.remaining = ringSegments.size();
+
+                const std::function<void(bool)> done = [&batch](bool segmentOk) {
+                    std::lock_guard<std::mutex> lock(batch.lock);
+                    batch.ok = batch.ok && segmentOk;
+                    if (--batch.remaining == 0) {
+                        batch.cond.notify_all();
+                    }
+                };
+
+                for (size_t i = 0; i < ringSegments.size();) {
+                    const uint32_t n = acquireSlots(ringSegments.size() - i);
+                    submit(ringSegments.data() + i, n, done, start, false);
+                    i += n;
+                }
+
+                for (const WriteSegment& segment : segments) {
+                    if (segment.bytes < cMinBatchSegmentBytes) {
+                        ok = pwriteAll(segment.fd, segment.data, segment.bytes, segment.offset) && ok;
+                    }
+                }
+
+                std::unique_lock<std::mutex> lock(batch.lock);
+                batch.cond.wait(lock, [&batch]() { return batch.remaining == 0; });
+                ok = batch.ok && ok;
+            } else {
+                for (const WriteSegment& segment : segments) {
+                    ok = pwriteAll(segment.fd, segment.data, segment.bytes, segment.offset) && ok;
+                }
+            }
+#else
+            //the file is opened for overlapped io, each thread waits on its own events
+            thread_local const std::array<HANDLE, MAXIMUM_WAIT_OBJECTS> events = []() {
+                std::array<HANDLE, MAXIMUM_WAIT_OBJECTS> e;
+                for (auto& h : e) {
+                    h = CreateEventA(NULL, TRUE, FALSE, NULL);
+                }
+                return e;
+            }();
+            std::array<OVERLAPPED, MAXIMUM_WAIT_OBJECTS> ovs;
+
+            for (size_t i = 0; i < segments.size() && ok; i += MAXIMUM_WAIT_OBJECTS) {
+                const size_t n = std::min<size_t>(MAXIMUM_WAIT_OBJECTS, segments.size() - i);
+
+                size_t issued = 0;
+                for (; issued < n; issued++) {
+                    const WriteSegment& segment = segments[i + issued];
+                    ULARGE_INTEGER uli;
+                    uli.QuadPart = segment.offset;
+                    ovs[issued] = OVERLAPPED{};
+                    ovs[issued].Offset = uli.LowPart;
+                    ovs[issued].OffsetHigh = uli.HighPart;
+                    ovs[issued].hEvent = events[issued];
+
+                    if (!WriteFile(segment.fd, segment.data, static_cast<DWORD>(segment.bytes), NULL, &ovs[issued]) && GetLastError() != ERROR_IO_PENDING) {
+                        ok = false;
+                        break;
+                    }
+                }
+
+                //every issued write is waited for, its data and OVERLAPPED must outlive it
+                for (size_t j = 0; j < issued; j++) {
+                    DWORD wrote = 0;
+                    ok = GetOverlappedResult(segments[i + j].fd, &ovs[j], &wrote, TRUE) && wrote == segments[i + j].bytes && ok;
+                }
+            }
+#endif
+
+            m_serviceTime.Record(start);
+            if (!ok && m_failed++ % 100 == 0) {
+                spdlog::error("Async batch write failed, failed writes: {}", m_failed.load());
+            }
+            return ok;
+        }
+
+        /*
+        * Blocks until all queued writes have completed.
+        */
+        void Drain() noexcept {
+            uint32_t n = m_inFlight.load(std::memory_order_acquire);
+            while (n != 0) {
+                m_inFlight.wait(n, std::memory_order_acquire);
+                n = m_inFlight.load(std::memory_order_acquire);
+            }
+        }
+
+        /*
+        * Number of writes currently in flight.
+        *
+        * @return Writes queued but not completed.
+        */
+        uint32_t InFlight() const noexcept {
+            return m_inFlight.load(std::memory_order_relaxed);
+        }
+
+        /*
+        * Write stage counters, depth is the number of writes in flight and
+        * service time is measured from queueing a write to its completion.
+        *
+        * @return Stage counters.
+        */
+        StageStats Stats() const noexcept {
+            StageStats stats {
+                .depth = m_inFlight.load(std::memory_order_relaxed),
+                .capacity = m_queueDepth,
+                .highWater = m_highWater.load(std::memory_order_relaxed),
+            };
+            m_serviceTime.Fill(stats);
+            return stats;
+        }
+
+        /*
+        * Resets high water mark and service time counters.
+        */
+        void ResetStats() noexcept {
+            m_highWater = m_inFlight.load();
+            m_serviceTime.Reset();
+        }
+
+        /*
+        * Number of writes that failed since construction.
+        *
+        * @return Failed writes.
+        */
+        uint64_t Failed() const noexcept {
+            return m_failed.load(std::memory_order_relaxed);
+        }
+
+        /*
+        * Backend in use.
+        *
+        * @return WriterBackend::IoUring or WriterBackend::Threads.
+        */
+        WriterBackend Backend() const noexcept {
+            return m_backend;
+        }
+
+        /*
+        * Name of a backend for logging and config files.
+        *
+        * @param backend The backend.
+        *
+        * @return Backend name.
+        */
+        static const char* BackendName(WriterBackend backend) noexcept {
+            switch (backend) {
+                case WriterBackend::Auto: return "auto";
+                case WriterBackend::IoUring: return "io_uring";
+                case WriterBackend::Threads: return "threads";
+            }
+            return "unknown";
+        }
+
+    private:
+        /*
+        * Reserves one in flight slot, blocks while the queue depth is reached.
+        */
+        void acquireSlot() noexcept {
+            acquireSlots(1);
+        }
+
+        /*
+        * Reserves between one and max in flight slots, blocks while the queue depth is reached.
+        *
+        * @return Number of slots reserved.
+        */
+        uint32_t acquireSlots(size_t max) noexcept {
+            uint32_t n = m_inFlight.load(std::memory_order_relaxed);
+            for (;;) {
+                if (n >= m_queueDepth) {
+                    m_inFlight.wait(n, std::memory_order_relaxed);
+                    n = m_inFlight.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                const uint32_t take = static_cast<uint32_t>(std::min<size_t>(max, m_queueDepth - n));
+                if (m_inFlight.compare_exchange_weak(n, n + take, std::memory_order_acq_rel)) {
+                    uint32_t high = m_highWater.load(std::memory_order_relaxed);
+                    while (n + take > high && !m_highWater.compare_exchange_weak(high, n + take, std::memory_order_relaxed)) {}
+                    return take;
+                }
+            }
+        }
+
+        /*
+        * Calls completion handler and frees the in flight slot.
+        *
+        * @param done Completion handler.
+        * @param ok Write result.
+        * @param start Time the write was queued.
+        * @param timed Record the service time and failures of this write.
+        */
+        void complete(const std::function<void(bool)>& done, bool ok, std::chrono::steady_clock::time_point start, bool timed = true) noexcept {
+            if (timed) {
+                m_serviceTime.Record(start);
+            }
+            if (timed && !ok && m_failed++ % 100 == 0) {
+                spdlog::error("Async frame write failed, failed writes: {}", m_failed.load());
+            }
+            if (done) {
+                done(ok);
+            }
+
+            m_inFlight.fetch_sub(1, std::memory_order_acq_rel);
+            m_inFlight.notify_all();
+        }
+
+#ifdef __linux__
+        /*
+        * Blocking positional write of all bytes.
+        *
+        * @return true if all bytes were written, false otherwise.
+        */
+        static bool pwriteAll(int fd, const uint8_t* data, size_t bytes, uint64_t offset) noexcept {
+            while (bytes > 0) {
+                const ssize_t n = ::pwrite(fd, data, bytes, offset);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return false;
+                }
+                data += n;
+                bytes -= n;
+                offset += n;
+            }
+            return true;
+        }
+
+        /*
+        * Finds the registered buffer containing [data, data + bytes).
+        *
+        * @return Buffer index or -1 if the range is not registered.
+        */
+        int32_t regionIndex(const uint8_t* data, size_t bytes) const noexcept {
+            for (size_t i = 0; i < m_regions.size(); i++) {
+                if (data >= m_regions[i].base && data + bytes <= m_regions[i].base + m_regions[i].bytes) {
+                    return static_cast<int32_t>(i);
+                }
+            }
+            return -1;
+        }
+
+        /*
+        * Queues writes on the io_uring submission queue and submits them together.
+        *
+        * @param segments Segments to write, one in flight slot must be reserved for each.
+        * @param count Number of segments.
+        * @param done Completion handler, called once for every segment.
+        * @param start Time the writes were queued.
+        * @param timed Record the service time of each segment.
+        */
+        void submit(const WriteSegment* segments, uint32_t count, const std::function<void(bool)>& done, std::chrono::steady_clock::time_point start, bool timed) noexcept {
+            // one request per in flight slot, so neither the free list nor the submission queue can run dry
+            thread_local std::vector<uint32_t> ids;
+            ids.clear();
+            {
+                std::lock_guard<std::mutex> lock(m_requestLock);
+                for (uint32_t i = 0; i < count; i++) {
+                    const uint32_t id = m_freeRequests.back();
+                    m_freeRequests.pop_back();
+                    m_requests[id] = Request {
+                        .fd = segments[i].fd,
+                        .data = segments[i].data,
+                        .bytes = segments[i].bytes,
+                        .offset = segments[i].offset,
+                        .done = done,
+                        .start = start,
+                        .timed = timed,
+                    };
+                    ids.push_back(id);
+                }
+            }
+
+            // entries the kernel refused, completed below once the submit lock is released
+            std::vector<uint32_t> failed;
+            {
+                std::lock_guard<std::mutex> lock(m_submitLock);
+                m_started = true;
+                for (uint32_t i = 0; i < count; i++) {
+                    io_uring_sqe* sqe = m_ring.GetSqe();
+                    const int32_t region = regionIndex(segments[i].data, segments[i].bytes);
+                    sqe->opcode = (region >= 0) ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+                    sqe->fd = segments[i].fd;
+                    sqe->addr = reinterpret_cast<uint64_t>(segments[i].data);
+                    sqe->len = static_cast<uint32_t>(segments[i].bytes);
+                    sqe->off = segments[i].offset;
+                    sqe->buf_index = static_cast<uint16_t>(std::max(region, 0));
+                    sqe->user_data = ids[i];
+                }
+
+                // the entry stays queued if the kernel is out of resources, retry once completions are reaped
+                int err = m_ring.Submit();
+                while (err == -EAGAIN || err == -EBUSY) {
+                    std::this_thread::yield();
+                    err = m_ring.Submit();
+                }
+                if (err < 0) {
+                    spdlog::error("io_uring submit failed ({}), writing with pwrite", std::strerror(-err));
+                    m_ring.Unqueue([&](uint64_t tag) {
+                        if (tag < m_requests.size()) {
+                            failed.push_back(static_cast<uint32_t>(tag));
+                        }
+                    });
+                }
+            }
+
+            // the kernel took none of the queued entries, write them here so every request completes
+            for (const uint32_t failedId : failed) {
+                Request req;
+                {
+                    std::lock_guard<std::mutex> lock(m_requestLock);
+                    req.fd = m_requests[failedId].fd;
+                    req.data = m_requests[failedId].data;
+                    req.bytes = m_requests[failedId].bytes;
+                    req.offset = m_requests[failedId].offset;
+                }
+                finish(failedId, pwriteAll(req.fd, req.data, req.bytes, req.offset));
+            }
+        }
+
+        /*
+        * Completes request id and returns it to the free list.
+        */
+        void finish(uint32_t id, bool ok) noexcept {
+            std::function<void(bool)> done;
+            std::chrono::steady_clock::time_point start;
+            bool timed;
+            {
+                std::lock_guard<std::mutex> lock(m_requestLock);
+                done = std::move(m_requests[id].done);
+                start = m_requests[id].start;
+                timed = m_requests[id].timed;
+                m_freeRequests.push_back(id);
+            }
+            complete(done, ok, start, timed);
+        }
+
+        /*
+        * Reaps io_uring completions until the stop entry is seen.
+        */
+        void reaperThread() noexcept {
+            ApplyThreadPolicy(ThreadRole::Writer);
+
+            io_uring_cqe cqe;
+            for (;;) {
+                const int err = m_ring.WaitCqe();
+                if (err < 0 && err != -EAGAIN && err != -EBUSY) {
+                    spdlog::error("io_uring wait failed: {}", std::strerror(-err));
+                }
+
+                while (m_ring.PopCqe(cqe)) {
+                    if (cqe.user_data == cStopTag) {
+                        return;
+                    } else if (cqe.user_data >= m_requests.size()) {
+                        continue;
+                    }
+
+                    const uint32_t id = static_cast<uint32_t>(cqe.user_data);
+                    Request req;
+                    {
+                        std::lock_guard<std::mutex> lock(m_requestLock);
+                        req.fd = m_requests[id].fd;
+                        req.data = m_requests[id].data;
+                        req.bytes = m_requests[id].bytes;
+                        req.offset = m_requests[id].offset;
+                    }
+                    const size_t written = (cqe.res > 0) ? static_cast<size_t>(cqe.res) : 0;
+
+                    // short or failed writes (e.g. kernels without IORING_OP_WRITE) are finished with pwrite
+                    bool ok = (written == req.bytes);
+                    if (!ok) {
+                        if (cqe.res < 0) {
+                            spdlog::warn("io_uring write failed ({}), retrying with pwrite", std::strerror(-cqe.res));
+                        }
+                        ok = pwriteAll(req.fd, req.data + written, req.bytes - written, req.offset + written);
+                    }
+                    finish(id, ok);
+                }
+            }
+        }
+#endif
+};
+
+#endif //ASYNC_FILE_WRITER_H
@@ -29,53 +29,64 @@
  *********************************************************************/
 #ifndef FRAME_POOL_H
 #define FRAME_POOL_H
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
-#include <queue>
-#include <functional>
 #include <utility>
-#include <tuple>
+#include <vector>
 
 #include <spdlog/spdlog.h>
 #include <interfaces/FrameInterface.h>
+#include <MemoryArena.h>
 #include <ParTask.h>
 
 /*
 * Frame Pool
 *
-* @tparam F FrameConcept implementation.
+* Fixed size pool of frames carved from a single pre-faulted memory arena.
+* The number of frames is derived from a memory budget, the pool never grows.
+*
+* @tparam F FrameConcept implementation, must be constructible from
+*           (void* buffer, size_t frameBytes, std::shared_ptr<ParTask>).
 */
 template<FrameConcept F>
 class FramePool {
     private:
-        std::queue<F*> m_pool;
+        std::unique_ptr<MemoryArena> m_arena;
+        std::vector<std::unique_ptr<F>> m_frames;
+        std::vector<F*> m_pool;
         std::mutex m_poolLock;
-        std::shared_ptr<ParTask> m_pTask;
+        std::condition_variable m_poolCond;
+        size_t m_waiters{0};
+        size_t m_inUseHighWater{0};
         size_t m_frameBytes;
-        bool m_deepCopy;
-
-        size_t total_objs{0};
+        size_t m_frameStride;
 
     public:
         /*
          * FramePool constructor.
          *
-         * @param poolSize Size of frame pool.
+         * @param budgetBytes Memory budget for frame data.
          * @param frameBytes Size of each frame.
-         * @param deepCopy Flag to enable deep copy of data.
          * @param pTask Pointer to parallel executor.
          */
-        FramePool(size_t poolSize, size_t frameBytes, bool deepCopy, std::shared_ptr<ParTask> pTask) {
+        FramePool(size_t budgetBytes, size_t frameBytes, std::shared_ptr<ParTask> pTask) {
             m_frameBytes = frameBytes;
-            m_deepCopy = deepCopy;
-            m_pTask = pTask;
+            // page aligned frames so they can be used for unbuffered/direct io
+            m_frameStride = MemoryArena::roundUp(frameBytes, cPageBytes);
 
-            total_objs += poolSize;
+            const size_t count = std::max<size_t>(1, budgetBytes / m_frameStride);
+            m_arena = std::make_unique<MemoryArena>(count * m_frameStride);
 
-            for(size_t i = 0; i < poolSize; i++) {
-                m_pool.push(new F(m_frameBytes, m_deepCopy, m_pTask));
+            m_frames.reserve(count);
+            m_pool.reserve(count);
+            for(size_t i = 0; i < count && m_arena->Data(); i++) {
+                m_frames.push_back(std::make_unique<F>(m_arena->Data() + i * m_frameStride, m_frameBytes, pTask));
+                m_pool.push_back(m_frames.back().get());
             }
-            spdlog::info("Pool size: {}", total_objs);
+            spdlog::info("Pool size: {} frames, stride: {}, budget: {}", m_frames.size(), m_frameStride, budgetBytes);
         }
 
         /*
@@ -86,30 +97,49 @@ class FramePool {
         /*
          * Acquire frame from pool.
          *
-         * @return F Pointer to FrameConcept type.
+         * @return F Pointer to FrameConcept type, nullptr if the pool is empty.
          */
         F* Acquire() noexcept {
             std::lock_guard<std::mutex> lock(m_poolLock);
-            F* obj;
-
-            if (!m_pool.empty()) {
-                obj = m_pool.front();
-                m_pool.pop();
-            } else {
-                spdlog::info("Pool empty, allocating");
-                obj = new F(m_frameBytes, m_deepCopy, m_pTask);
-            }
-            if (!obj) {
+            if (m_pool.empty()) {
                 return nullptr;
             }
 
+            F* obj = m_pool.back();
+            m_pool.pop_back();
+            m_inUseHighWater = std::max(m_inUseHighWater, m_frames.size() - m_pool.size());
+            return obj;
+        }
+
+        /*
+         * Acquire frame from pool, waiting for a frame to be released if the pool is empty.
+         *
+         * @param timeout Maximum time to wait.
+         *
+         * @return F Pointer to FrameConcept type, nullptr on timeout.
+         */
+        F* Acquire(std::chrono::milliseconds timeout) noexcept {
+            std::unique_lock<std::mutex> lock(m_poolLock);
+            if (m_pool.empty()) {
+                ++m_waiters;
+                m_poolCond.wait_for(lock, timeout, [this]() { return !m_pool.empty(); });
+                --m_waiters;
+
+                if (m_pool.empty()) {
+                    return nullptr;
+                }
+            }
+
+            F* obj = m_pool.back();
+            m_pool.pop_back();
+            m_inUseHighWater = std::max(m_inUseHighWater, m_frames.size() - m_pool.size());
             return obj;
         }
 
         /*
          * Size of frame pool.
          *
-         * @return size_t The size of the frame pool.
+         * @return size_t The number of free frames in the pool.
          */
         size_t Size() noexcept {
             std::lock_guard<std::mutex> lock(m_poolLock);
@@ -117,21 +147,48 @@ class FramePool {
         }
 
         /*
-         * Ensures frame pool is at least size.
-         * Will allocate up to size new frames and add to pool.
+         * Maximum number of frames in use at the same time since the last ResetHighWater.
          *
-         * @param size Minimum size of frame pool.
+         * @return size_t Frames in use high water mark.
          */
-        void EnsurePoolSize(uint64_t size) noexcept {
+        size_t HighWater() noexcept {
             std::lock_guard<std::mutex> lock(m_poolLock);
+            return m_inUseHighWater;
+        }
 
-            if (m_pool.size() < size) {
-                spdlog::info("EnsurePoolSize: pool size: {}, requested: {}", m_pool.size(), size);
-            }
-            while (m_pool.size() < size) {
-                m_pool.push(new F(m_frameBytes, m_deepCopy, m_pTask));
-                total_objs++;
-            }
+        /*
+         * Resets the in use high water mark to the frames currently in use.
+         */
+        void ResetHighWater() noexcept {
+            std::lock_guard<std::mutex> lock(m_poolLock);
+            m_inUseHighWater = m_frames.size() - m_pool.size();
+        }
+
+        /*
+         * Capacity of frame pool.
+         *
+         * @return size_t The total number of frames owned by the pool.
+         */
+        size_t Capacity() const noexcept {
+            return m_frames.size();
+        }
+
+        /*
+         * Distance between frames in the pool arena.
+         *
+         * @return size_t Page aligned frame stride in bytes.
+         */
+        size_t FrameStride() const noexcept {
+            return m_frameStride;
+        }
+
+        /*
+         * Memory region backing all frames of the pool, e.g. for io buffer registration.
+         *
+         * @return Pair of arena base address and size in bytes.
+         */
+        std::pair<void*, size_t> Region() const noexcept {
+            return { m_arena->Data(), m_frames.size() * m_frameStride };
         }
 
         /*
@@ -141,7 +198,10 @@ class FramePool {
          */
         void Release(F* obj) noexcept {
             std::lock_guard<std::mutex> lock(m_poolLock);
-            m_pool.push(obj);
+            m_pool.push_back(obj);
+            if (m_waiters > 0) {
+                m_poolCond.notify_one();
+            }
         }
 };
 
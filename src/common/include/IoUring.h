@@ -0,0 +1,270 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  IoUring.h
+ * 
+ * @brief Definition of the IoUring class.
+ *********************************************************************/
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#ifdef __linux__
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/*
+* Minimal io_uring wrapper on top of the raw system calls.
+*
+* Only what the async writer needs: a submission queue fed by one thread
+* at a time, a completion queue drained by one thread at a time, and buffer
+* registration. The kernel interface is used directly so no liburing
+* dependency is needed.
+*/
+class IoUring {
+    private:
+        int m_fd{-1};
+
+        void* m_sqRing{nullptr};
+        void* m_cqRing{nullptr};
+        size_t m_sqRingBytes{0};
+        size_t m_cqRingBytes{0};
+        io_uring_sqe* m_sqes{nullptr};
+        size_t m_sqesBytes{0};
+
+        unsigned* m_sqHead{nullptr};
+        unsigned* m_sqTail{nullptr};
+        unsigned* m_sqArray{nullptr};
+        unsigned m_sqMask{0};
+        unsigned m_sqEntries{0};
+        unsigned m_sqPending{0};
+
+        unsigned* m_cqHead{nullptr};
+        unsigned* m_cqTail{nullptr};
+        unsigned m_cqMask{0};
+        io_uring_cqe* m_cqes{nullptr};
+
+    public:
+        /*
+        * IoUring constructor, call Init before use.
+        */
+        IoUring() = default;
+
+        /*
+        * IoUring destructor.
+        */
+        ~IoUring() {
+            if (m_sqes) { ::munmap(m_sqes, m_sqesBytes); }
+            if (m_cqRing && m_cqRing != m_sqRing) { ::munmap(m_cqRing, m_cqRingBytes); }
+            if (m_sqRing) { ::munmap(m_sqRing, m_sqRingBytes); }
+            if (m_fd >= 0) { ::close(m_fd); }
+        }
+
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+
+        /*
+        * Creates the ring.
+        *
+        * @param entries Submission queue size.
+        *
+        * @return 0 on success, negative errno otherwise (-ENOSYS/-EPERM when io_uring is unavailable).
+        */
+        int Init(unsigned entries) noexcept {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+
+            m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            if (m_fd < 0) {
+                return -errno;
+            }
+
+            m_sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (singleMmap) {
+                m_sqRingBytes = m_cqRingBytes = std::max(m_sqRingBytes, m_cqRingBytes);
+            }
+
+            m_sqRing = ::mmap(nullptr, m_sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+            if (m_sqRing == MAP_FAILED) {
+                m_sqRing = nullptr;
+                return -errno;
+            }
+
+            if (singleMmap) {
+                m_cqRing = m_sqRing;
+            } else {
+                m_cqRing = ::mmap(nullptr, m_cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+                if (m_cqRing == MAP_FAILED) {
+                    m_cqRing = nullptr;
+                    return -errno;
+                }
+            }
+
+            m_sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqes = ::mmap(nullptr, m_sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED) {
+                return -errno;
+            }
+            m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+            uint8_t* sq = static_cast<uint8_t*>(m_sqRing);
+            m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            m_sqEntries = params.sq_entries;
+
+            uint8_t* cq = static_cast<uint8_t*>(m_cqRing);
+            m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            return 0;
+        }
+
+        /*
+        * Registers fixed buffers for IORING_OP_WRITE_FIXED.
+        *
+        * @param iovs Buffers to register, each at most 1GB.
+        * @param count Number of buffers.
+        *
+        * @return 0 on success, negative errno otherwise.
+        */
+        int RegisterBuffers(const iovec* iovs, unsigned count) noexcept {
+            if (::syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS, iovs, count) < 0) {
+                return -errno;
+            }
+            return 0;
+        }
+
+        /*
+        * Gets the next free submission queue entry, submission side only.
+        *
+        * @return Cleared sqe or nullptr if the submission queue is full.
+        */
+        io_uring_sqe* GetSqe() noexcept {
+            const unsigned head = std::atomic_ref<unsigned>(*m_sqHead).load(std::memory_order_acquire);
+            const unsigned tail = *m_sqTail + m_sqPending;
+            if (tail - head >= m_sqEntries) {
+                return nullptr;
+            }
+
+            const unsigned idx = tail & m_sqMask;
+            io_uring_sqe* sqe = &m_sqes[idx];
+            std::memset(sqe, 0, sizeof(*sqe));
+            m_sqArray[idx] = idx;
+            ++m_sqPending;
+            return sqe;
+        }
+
+        /*
+        * Submits all entries queued with GetSqe, submission side only.
+        * Entries the kernel did not consume stay queued and go out with the next call.
+        *
+        * @return Number of submitted entries or negative errno.
+        */
+        int Submit() noexcept {
+            if (m_sqPending > 0) {
+                std::atomic_ref<unsigned>(*m_sqTail).store(*m_sqTail + m_sqPending, std::memory_order_release);
+                m_sqPending = 0;
+            }
+
+            const unsigned toSubmit = *m_sqTail - std::atomic_ref<unsigned>(*m_sqHead).load(std::memory_order_acquire);
+            if (toSubmit == 0) {
+                return 0;
+            }
+
+            int ret;
+            do {
+                ret = static_cast<int>(::syscall(__NR_io_uring_enter, m_fd, toSubmit, 0, 0, nullptr, 0));
+            } while (ret < 0 && errno == EINTR);
+
+            return (ret < 0) ? -errno : ret;
+        }
+
+        /*
+        * Takes back the entries the kernel did not consume, submission side only.
+        * Only valid after Submit failed, the kernel does not read the submission
+        * queue outside io_uring_enter since the ring is not set up with SQPOLL.
+        *
+        * @param fn Called with the user data of each dropped entry.
+        */
+        template<typename F>
+        void Unqueue(F&& fn) noexcept {
+            const unsigned head = std::atomic_ref<unsigned>(*m_sqHead).load(std::memory_order_acquire);
+            for (unsigned i = head; i != *m_sqTail + m_sqPending; i++) {
+                fn(m_sqes[m_sqArray[i & m_sqMask]].user_data);
+            }
+            std::atomic_ref<unsigned>(*m_sqTail).store(head, std::memory_order_release);
+            m_sqPending = 0;
+        }
+
+        /*
+        * Waits until at least one completion is available, completion side only.
+        *
+        * @return 0 on success, negative errno otherwise.
+        */
+        int WaitCqe() noexcept {
+            int ret;
+            do {
+                ret = static_cast<int>(::syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+            } while (ret < 0 && errno == EINTR);
+
+            return (ret < 0) ? -errno : 0;
+        }
+
+        /*
+        * Pops the next completion if available, completion side only.
+        *
+        * @param cqe Completion copied out of the ring.
+        *
+        * @return true if a completion was popped, false if queue is empty.
+        */
+        bool PopCqe(io_uring_cqe& cqe) noexcept {
+            const unsigned head = *m_cqHead;
+            const unsigned tail = std::atomic_ref<unsigned>(*m_cqTail).load(std::memory_order_acquire);
+            if (head == tail) {
+                return false;
+            }
+
+            cqe = m_cqes[head & m_cqMask];
+            std::atomic_ref<unsigned>(*m_cqHead).store(head + 1, std::memory_order_release);
+            return true;
+        }
+};
+
+#endif //__linux__
+#endif //IO_URING_H
@@ -0,0 +1,379 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  LiveStats.h
+ *
+ * Definition of the sampled live view statistics worker.
+ *********************************************************************/
+#ifndef LIVE_STATS_H
+#define LIVE_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <ThreadPolicy.h>
+
+//number of bins in the display histogram
+constexpr size_t cLiveStatsBins = 256;
+
+
+/*
+* How pixels are picked for live statistics.
+*/
+enum class LiveStatsSampling : uint8_t {
+    Strided,
+    Random,
+};
+
+
+/*
+* Returns the config name of a sampling mode.
+*
+* @param sampling The sampling mode.
+*/
+inline const char* LiveStatsSamplingName(LiveStatsSampling sampling) noexcept {
+    return (sampling == LiveStatsSampling::Random) ? "random" : "strided";
+}
+
+
+/*
+* Parses a sampling mode name.
+*
+* @param name The sampling mode name.
+*
+* @return The sampling mode or nullopt if the name is unknown.
+*/
+inline std::optional<LiveStatsSampling> ParseLiveStatsSampling(std::string_view name) noexcept {
+    if (name == "strided") { return LiveStatsSampling::Strided; }
+    if (name == "random") { return LiveStatsSampling::Random; }
+    return std::nullopt;
+}
+
+
+/*
+* Statistics of one sampled frame.
+*
+* The display histogram has cLiveStatsBins bins spanning [min, max] of the samples.
+*/
+struct LiveStatsResult {
+    std::array<uint32_t, cLiveStatsBins> hist{};
+    uint32_t hmax{0};
+    uint32_t min{0}, max{0};
+    uint32_t low{0}, high{0};
+    uint32_t median{0};
+    uint64_t samples{0};
+    uint64_t frame{0};
+};
+
+
+/*
+* Live view statistics computed from a subset of pixels on a background thread.
+*
+* Submit hands the worker the latest frame and returns immediately, a frame
+* submitted while the worker is busy replaces any frame still waiting so the
+* worker only ever processes the newest one. Results are double buffered,
+* Latest copies the last finished result and never waits on a running frame.
+*/
+class LiveStats {
+    private:
+        struct Job {
+            const uint8_t* data{nullptr};
+            uint32_t width{0}, height{0};
+            uint8_t bytesPerPixel{2};
+            uint8_t bitDepth{0};
+            uint64_t frame{0};
+        };
+
+        double m_fraction;
+        double m_lowPercentile, m_highPercentile;
+        LiveStatsSampling m_sampling;
+
+        std::mutex m_lock;
+        std::condition_variable m_cv;
+        std::condition_variable m_idle;
+        Job m_pending{};
+        bool m_hasPending{false};
+        bool m_busy{false};
+        bool m_running{true};
+        uint64_t m_submitted{0};
+
+        std::mutex m_resultLock;
+        std::array<LiveStatsResult, 2> m_results{};
+        uint8_t m_front{0};
+
+        std::vector<uint32_t> m_fine;
+        std::thread m_worker;
+
+    public:
+        /*
+        * LiveStats constructor, starts the worker.
+        *
+        * @param fraction Fraction of pixels sampled per frame, (0, 1].
+        * @param lowPercentile Percentile reported as low, [0, 100].
+        * @param highPercentile Percentile reported as high, [0, 100].
+        * @param sampling How sampled pixels are picked.
+        */
+        LiveStats(double fraction, double lowPercentile, double highPercentile, LiveStatsSampling sampling = LiveStatsSampling::Strided) :
+            m_fraction(std::clamp(fraction, 1e-6, 1.0)),
+            m_lowPercentile(std::clamp(lowPercentile, 0.0, 100.0)),
+            m_highPercentile(std::clamp(highPercentile, 0.0, 100.0)),
+            m_sampling(sampling) {
+            if (m_lowPercentile > m_highPercentile) {
+                std::swap(m_lowPercentile, m_highPercentile);
+            }
+            m_worker = std::thread(&LiveStats::worker, this);
+        }
+
+        /*
+        * LiveStats destructor, drops any waiting frame and joins the worker.
+        */
+        ~LiveStats() {
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_running = false;
+                m_hasPending = false;
+            }
+            m_cv.notify_all();
+            m_worker.join();
+        }
+
+        LiveStats(const LiveStats&) = delete;
+        LiveStats& operator=(const LiveStats&) = delete;
+
+        /*
+        * Queues a frame for the worker, replacing any frame not yet started.
+        *
+        * The frame data must stay valid until a later Submit replaces it or Drain returns.
+        *
+        * @param data Frame data.
+        * @param width Frame width.
+        * @param height Frame height.
+        * @param bytesPerPixel Bytes per pixel, 1 or 2.
+        * @param bitDepth Sensor bit depth, sizes the fine histogram. 0 for 8 * bytesPerPixel.
+        *                 Larger pixel values are counted as the largest value.
+        */
+        void Submit(const uint8_t* data, uint32_t width, uint32_t height, uint8_t bytesPerPixel, uint8_t bitDepth = 0) {
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_pending = Job{ data, width, height, bytesPerPixel, bitDepth, ++m_submitted };
+                m_hasPending = true;
+            }
+            m_cv.notify_one();
+        }
+
+        /*
+        * Drops any frame not yet started and waits for the running one to finish.
+        *
+        * Call before frame data handed to Submit is released.
+        */
+        void Drain() {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_hasPending = false;
+            m_idle.wait(lock, [this] { return !m_busy; });
+        }
+
+        /*
+        * Copies the last finished result if it is newer than result.
+        *
+        * @param result Result to update, its frame field is compared to the finished result.
+        *
+        * @return true if result was updated.
+        */
+        bool Latest(LiveStatsResult& result) {
+            std::unique_lock<std::mutex> lock(m_resultLock);
+            const LiveStatsResult& front = m_results[m_front];
+            if (front.frame == 0 || front.frame == result.frame) {
+                return false;
+            }
+            result = front;
+            return true;
+        }
+
+    private:
+        /*
+        * Worker thread, processes the newest submitted frame until shutdown.
+        */
+        void worker() {
+            ApplyThreadPolicy(ThreadRole::LiveView);
+
+            while (true) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(m_lock);
+                    m_busy = false;
+                    m_idle.notify_all();
+
+                    m_cv.wait(lock, [this] { return m_hasPending || !m_running; });
+                    if (!m_running) {
+                        return;
+                    }
+
+                    job = m_pending;
+                    m_hasPending = false;
+                    m_busy = true;
+                }
+
+                LiveStatsResult& back = m_results[1 - m_front];
+                process(job, back);
+
+                std::unique_lock<std::mutex> lock(m_resultLock);
+                m_front = 1 - m_front;
+            }
+        }
+
+        /*
+        * Samples a frame into m_fine and computes its result.
+        *
+        * @param job The frame.
+        * @param result Result output.
+        */
+        void process(const Job& job, LiveStatsResult& result) {
+            uint8_t bitDepth = job.bitDepth;
+            if (bitDepth == 0 || bitDepth > 8 * job.bytesPerPixel) {
+                bitDepth = 8 * job.bytesPerPixel;
+            }
+
+            const uint32_t top = (uint32_t(1) << bitDepth) - 1;
+            m_fine.assign(size_t(top) + 1, 0);
+
+            const uint64_t total = uint64_t(job.width) * job.height;
+            uint64_t samples = 0;
+
+            if (job.data != nullptr && total > 0) {
+                if (job.bytesPerPixel == 1) {
+                    samples = sample(job.data, total, top, job.width, job.frame);
+                } else {
+                    samples = sample(reinterpret_cast<const uint16_t*>(job.data), total, top, job.width, job.frame);
+                }
+            }
+
+            result.frame = job.frame;
+            result.samples = samples;
+            result.hist.fill(0);
+            result.hmax = 0;
+
+            if (samples == 0) {
+                result.min = result.max = result.low = result.high = result.median = 0;
+                return;
+            }
+
+            uint32_t min = 0, max = top;
+            while (m_fine[min] == 0) { min++; }
+            while (m_fine[max] == 0) { max--; }
+
+            result.min = min;
+            result.max = max;
+            result.low = percentile(m_lowPercentile, samples, min, max);
+            result.high = percentile(m_highPercentile, samples, min, max);
+            result.median = percentile(50.0, samples, min, max);
+
+            //display histogram over [min, max]
+            const double bwidth = cLiveStatsBins / static_cast<double>(max - min + 1);
+            for (uint32_t v = min; v <= max; v++) {
+                result.hist[static_cast<size_t>(bwidth * (v - min))] += m_fine[v];
+            }
+            result.hmax = *std::max_element(result.hist.begin(), result.hist.end());
+        }
+
+        /*
+        * Histograms the sampled pixels of a frame into m_fine.
+        *
+        * Strided sampling takes every step'th pixel from a phase that changes every frame,
+        * the step is kept coprime to the width so samples do not fall in the same columns
+        * on every row. Random sampling takes the same number of pixels from a generator
+        * seeded with the frame number.
+        *
+        * @param data Frame pixels.
+        * @param total Number of pixels.
+        * @param top Largest histogram value, larger pixels are clamped to it.
+        * @param width Frame width.
+        * @param frame Frame number.
+        *
+        * @return Number of pixels sampled.
+        */
+        template<typename P>
+        uint64_t sample(const P* data, uint64_t total, uint32_t top, uint32_t width, uint64_t frame) {
+            uint32_t* fine = m_fine.data();
+            uint64_t count = 0;
+
+            if (m_sampling == LiveStatsSampling::Strided) {
+                uint64_t step = std::max<uint64_t>(1, static_cast<uint64_t>(1.0 / m_fraction + 0.5));
+                while (step > 1 && std::gcd(step, uint64_t(width)) != 1) {
+                    step++;
+                }
+
+                for (uint64_t i = frame % step; i < total; i += step) {
+                    fine[std::min<uint32_t>(data[i], top)]++;
+                    count++;
+                }
+            } else {
+                count = std::max<uint64_t>(1, static_cast<uint64_t>(total * m_fraction));
+
+                //xorshift64*, index is the high half of a 32x32 bit product so total must fit in 32 bits
+                uint64_t state = (frame + 1) * 0x9E3779B97F4A7C15ull;
+                const uint64_t range = std::min<uint64_t>(total, UINT32_MAX);
+                for (uint64_t n = 0; n < count; n++) {
+                    state ^= state >> 12;
+                    state ^= state << 25;
+                    state ^= state >> 27;
+                    const uint64_t r = (state * 0x2545F4914F6CDD1Dull) >> 32;
+                    fine[std::min<uint32_t>(data[(r * range) >> 32], top)]++;
+                }
+            }
+            return count;
+        }
+
+        /*
+        * Value at a percentile of the sampled pixels.
+        *
+        * @param pct Percentile, [0, 100].
+        * @param samples Number of sampled pixels.
+        * @param min Smallest sampled value.
+        * @param max Largest sampled value.
+        */
+        uint32_t percentile(double pct, uint64_t samples, uint32_t min, uint32_t max) const {
+            const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(samples * (pct / 100.0) + 0.5));
+
+            uint64_t cumulative = 0;
+            for (uint32_t v = min; v < max; v++) {
+                cumulative += m_fine[v];
+                if (cumulative >= target) {
+                    return v;
+                }
+            }
+            return max;
+        }
+};
+
+#endif //LIVE_STATS_H
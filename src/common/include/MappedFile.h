@@ -0,0 +1,361 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/*********************************************************************
+ * @file  MappedFile.h
+ * 
+ * Definition of the MappedFile class.
+ *********************************************************************/
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#else
+#include <windows.h>
+#endif
+
+
+/*
+* Read only random access to frames of a raw file.
+*
+* Files up to mapLimit bytes are memory mapped once, and every frame read
+* afterwards is a pointer into that mapping. On Linux the mapping is advised
+* as sequential, so the kernel reads ahead and drops pages behind the reader.
+* Larger files, and files that fail to map, are read with pread (ReadFile on
+* Windows) into buffers that are pooled and reused once a frame is released.
+*/
+class MappedFile {
+    public:
+        /*
+        * Default largest file size that is memory mapped.
+        */
+        static constexpr uint64_t cMapLimit = uint64_t(64) << 30;
+
+        /*
+        * Frame read from a MappedFile, releases its buffer to the file pool when destroyed.
+        */
+        class Frame {
+            friend class MappedFile;
+            private:
+                MappedFile* m_file{nullptr};
+                const uint8_t* m_data{nullptr};
+                size_t m_bytes{0};
+                std::vector<uint8_t> m_buffer;
+
+            public:
+                Frame() = default;
+
+                ~Frame() {
+                    reset();
+                }
+
+                Frame(Frame&& o) noexcept :
+                    m_file(std::exchange(o.m_file, nullptr)), m_data(std::exchange(o.m_data, nullptr)),
+                    m_bytes(std::exchange(o.m_bytes, 0)), m_buffer(std::move(o.m_buffer)) { }
+
+                Frame& operator=(Frame&& o) noexcept {
+                    if (this != &o) {
+                        reset();
+                        m_file = std::exchange(o.m_file, nullptr);
+                        m_data = std::exchange(o.m_data, nullptr);
+                        m_bytes = std::exchange(o.m_bytes, 0);
+                        m_buffer = std::move(o.m_buffer);
+                    }
+                    return *this;
+                }
+
+                Frame(const Frame&) = delete;
+                Frame& operator=(const Frame&) = delete;
+
+                /*
+                * Frame data, nullptr if the frame could not be read.
+                */
+                const uint8_t* Data() const noexcept { return m_data; }
+
+                /*
+                * Size of the frame in bytes.
+                */
+                size_t Size() const noexcept { return m_bytes; }
+
+                /*
+                * Touches every page of a mapped frame so it is read from disk now
+                * instead of on first use.
+                */
+                void Prefetch() const noexcept {
+                    if (m_data == nullptr || !m_buffer.empty()) {
+                        return;
+                    }
+
+                    volatile uint8_t sink = 0;
+                    for (size_t i = 0; i < m_bytes; i += 4096) {
+                        sink = sink + m_data[i];
+                    }
+                }
+
+            private:
+                void reset() {
+                    if (m_file && !m_buffer.empty()) {
+                        m_file->release(std::move(m_buffer));
+                    }
+                    m_buffer = {};
+                    m_file = nullptr;
+                    m_data = nullptr;
+                    m_bytes = 0;
+                }
+        };
+
+    private:
+        std::filesystem::path m_path;
+        uint64_t m_size{0};
+        const uint8_t* m_map{nullptr};
+#ifndef _WIN32
+        int m_fd{-1};
+#else
+        HANDLE m_fd{INVALID_HANDLE_VALUE};
+        HANDLE m_mapping{0};
+#endif
+
+        std::mutex m_poolLock;
+        std::vector<std::vector<uint8_t>> m_pool;
+
+    public:
+        /*
+        * MappedFile constructor, opens and maps the file.
+        *
+        * @param path Path of the file.
+        * @param mapLimit Largest file size that is mapped, larger files are read with pread.
+        */
+        MappedFile(const std::filesystem::path& path, uint64_t mapLimit = cMapLimit) : m_path(path) {
+#ifndef _WIN32
+            m_fd = open(path.string().c_str(), O_RDONLY);
+            if (m_fd < 0) {
+                spdlog::error("Could not open file {}, Error {}", path.string(), errno);
+                return;
+            }
+
+            struct stat st;
+            if (fstat(m_fd, &st) == 0) {
+                m_size = static_cast<uint64_t>(st.st_size);
+            }
+
+            if (m_size > 0 && m_size <= mapLimit) {
+                void* map = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+                if (map == MAP_FAILED) {
+                    spdlog::warn("Could not mmap file {} ({}), using pread", path.string(), errno);
+                } else {
+                    madvise(map, m_size, MADV_SEQUENTIAL);
+                    m_map = static_cast<const uint8_t*>(map);
+                }
+            }
+
+            if (m_map == nullptr) {
+                posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+#else
+            m_fd = CreateFileA(path.string().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+            if (m_fd == INVALID_HANDLE_VALUE) {
+                spdlog::error("Could not open file {}, Error {}", path.string(), GetLastError());
+                return;
+            }
+
+            LARGE_INTEGER size;
+            if (GetFileSizeEx(m_fd, &size)) {
+                m_size = static_cast<uint64_t>(size.QuadPart);
+            }
+
+            if (m_size > 0 && m_size <= mapLimit) {
+                m_mapping = CreateFileMapping(m_fd, 0, PAGE_READONLY, 0, 0, 0);
+                if (m_mapping != 0) {
+                    m_map = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+                }
+                if (m_map == nullptr) {
+                    spdlog::warn("Could not map file {} ({}), using ReadFile", path.string(), GetLastError());
+                }
+            }
+#endif
+        }
+
+        /*
+        * MappedFile destructor, unmaps and closes the file.
+        *
+        * Frames read from this file must be released before it is destroyed.
+        */
+        ~MappedFile() {
+#ifndef _WIN32
+            if (m_map) { munmap(const_cast<uint8_t*>(m_map), m_size); }
+            if (m_fd >= 0) { close(m_fd); }
+#else
+            if (m_map) { UnmapViewOfFile(m_map); }
+            if (m_mapping) { CloseHandle(m_mapping); }
+            if (m_fd != INVALID_HANDLE_VALUE) { CloseHandle(m_fd); }
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /*
+        * Checks if the file is open.
+        */
+        bool IsOpen() const noexcept {
+#ifndef _WIN32
+            return m_fd >= 0;
+#else
+            return m_fd != INVALID_HANDLE_VALUE;
+#endif
+        }
+
+        /*
+        * Checks if the file is memory mapped.
+        */
+        bool Mapped() const noexcept { return m_map != nullptr; }
+
+        /*
+        * Size of the file in bytes.
+        */
+        uint64_t Size() const noexcept { return m_size; }
+
+        /*
+        * Reads bytes at offset.
+        *
+        * @param offset Offset in the file.
+        * @param bytes Number of bytes.
+        *
+        * @return The frame, its data is nullptr if the range is outside the file or could not be read.
+        */
+        Frame Read(uint64_t offset, size_t bytes) {
+            Frame f;
+            if (!IsOpen() || offset > m_size || bytes > m_size - offset) {
+                spdlog::error("Could not read {} bytes at {} from file {} of {} bytes", bytes, offset, m_path.string(), m_size);
+                return f;
+            }
+
+            f.m_bytes = bytes;
+            if (m_map) {
+                f.m_data = m_map + offset;
+                return f;
+            }
+
+            f.m_file = this;
+            f.m_buffer = acquire(bytes);
+            if (!readAt(f.m_buffer.data(), offset, bytes)) {
+                return f;
+            }
+            f.m_data = f.m_buffer.data();
+            return f;
+        }
+
+        /*
+        * Hints that bytes at offset will be read soon so the read from disk can start now.
+        *
+        * @param offset Offset in the file.
+        * @param bytes Number of bytes.
+        */
+        void WillNeed(uint64_t offset, size_t bytes) const noexcept {
+#ifndef _WIN32
+            if (!IsOpen() || offset >= m_size) {
+                return;
+            }
+            bytes = static_cast<size_t>(std::min<uint64_t>(bytes, m_size - offset));
+
+            if (m_map) {
+                // madvise needs a page aligned start
+                const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+                const uint64_t start = offset - (offset % page);
+                madvise(const_cast<uint8_t*>(m_map) + start, bytes + (offset - start), MADV_WILLNEED);
+            } else {
+                posix_fadvise(m_fd, offset, bytes, POSIX_FADV_WILLNEED);
+            }
+#else
+            (void)offset;
+            (void)bytes;
+#endif
+        }
+
+    private:
+        std::vector<uint8_t> acquire(size_t bytes) {
+            std::vector<uint8_t> buf;
+            {
+                std::unique_lock<std::mutex> lock(m_poolLock);
+                if (!m_pool.empty()) {
+                    buf = std::move(m_pool.back());
+                    m_pool.pop_back();
+                }
+            }
+            buf.resize(bytes);
+            return buf;
+        }
+
+        void release(std::vector<uint8_t>&& buf) {
+            std::unique_lock<std::mutex> lock(m_poolLock);
+            m_pool.push_back(std::move(buf));
+        }
+
+        bool readAt(uint8_t* dst, uint64_t offset, size_t bytes) {
+            size_t done = 0;
+            while (done < bytes) {
+#ifndef _WIN32
+                const ssize_t n = pread(m_fd, dst + done, bytes - done, static_cast<off_t>(offset + done));
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    spdlog::error("Could not read file {} at {}, Error {}", m_path.string(), offset + done, n < 0 ? errno : 0);
+                    return false;
+                }
+#else
+                OVERLAPPED ov{};
+                ULARGE_INTEGER uli;
+                uli.QuadPart = offset + done;
+                ov.Offset = uli.LowPart;
+                ov.OffsetHigh = uli.HighPart;
+
+                DWORD n = 0;
+                const DWORD count = static_cast<DWORD>(std::min<size_t>(bytes - done, 1u << 30));
+                if (!ReadFile(m_fd, dst + done, count, &n, &ov) || n == 0) {
+                    spdlog::error("Could not read file {} at {}, Error {}", m_path.string(), offset + done, GetLastError());
+                    return false;
+                }
+#endif
+                done += static_cast<size_t>(n);
+            }
+            return true;
+        }
+};
+
+#endif //MAPPED_FILE_H
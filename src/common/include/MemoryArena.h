@@ -0,0 +1,176 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  MemoryArena.h
+ * 
+ * @brief Definition of the MemoryArena class.
+ *********************************************************************/
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+#include <cstdint>
+#include <cstddef>
+
+#include <spdlog/spdlog.h>
+#include <Allocator.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+/*
+* Size of a huge page, 2MB on both x86_64 linux and windows.
+*/
+constexpr size_t cHugePageBytes = 2 * 1024 * 1024;
+
+/*
+* One contiguous, pre-faulted memory region.
+*
+* Tries to back the region with 2MB huge pages (MAP_HUGETLB on linux,
+* MEM_LARGE_PAGES on windows), falling back to normal pages with transparent
+* huge pages requested through madvise. Every page is touched up front so no
+* page faults happen once acquisition is running.
+*/
+class MemoryArena {
+    private:
+        uint8_t* m_data{nullptr};
+        size_t m_size{0};
+        bool m_hugePages{false};
+
+    public:
+        /*
+        * MemoryArena constructor.
+        *
+        * @param bytes Minimum size of the arena in bytes.
+        */
+        MemoryArena(size_t bytes) {
+            if (bytes == 0) {
+                return;
+            }
+
+#ifdef _WIN32
+            const size_t largePage = ::GetLargePageMinimum();
+            if (largePage > 0) {
+                m_size = roundUp(bytes, largePage);
+                m_data = static_cast<uint8_t*>(::VirtualAlloc(nullptr, m_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+                m_hugePages = (m_data != nullptr);
+            }
+
+            if (!m_data) { //large pages need SeLockMemoryPrivilege, fall back to normal pages
+                m_size = roundUp(bytes, cPageBytes);
+                m_data = static_cast<uint8_t*>(::VirtualAlloc(nullptr, m_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+            }
+#else
+            m_size = roundUp(bytes, cHugePageBytes);
+            void* ptr = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+            m_hugePages = (ptr != MAP_FAILED);
+
+            if (!m_hugePages) { //no reserved huge pages, ask for transparent huge pages instead
+                ptr = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (ptr != MAP_FAILED) {
+                    (void)::madvise(ptr, m_size, MADV_HUGEPAGE);
+                }
+            }
+            m_data = (ptr != MAP_FAILED) ? static_cast<uint8_t*>(ptr) : nullptr;
+#endif
+
+            if (!m_data) {
+                spdlog::error("Failed to allocate memory arena of {} bytes", bytes);
+                m_size = 0;
+                return;
+            }
+
+            prefault();
+            spdlog::info("Allocated memory arena of {} bytes, huge pages: {}", m_size, m_hugePages);
+        }
+
+        /*
+        * MemoryArena destructor.
+        */
+        ~MemoryArena() {
+            if (!m_data) {
+                return;
+            }
+#ifdef _WIN32
+            ::VirtualFree(m_data, 0, MEM_RELEASE);
+#else
+            ::munmap(m_data, m_size);
+#endif
+        }
+
+        MemoryArena(const MemoryArena&) = delete;
+        MemoryArena& operator=(const MemoryArena&) = delete;
+
+        /*
+        * Pointer to start of arena.
+        *
+        * @return Pointer to arena memory, nullptr if allocation failed.
+        */
+        uint8_t* Data() const noexcept {
+            return m_data;
+        }
+
+        /*
+        * Size of arena.
+        *
+        * @return Size of arena in bytes.
+        */
+        size_t Size() const noexcept {
+            return m_size;
+        }
+
+        /*
+        * Check if arena is backed by huge pages.
+        *
+        * @return true if using explicit huge pages, false otherwise.
+        */
+        bool HugePages() const noexcept {
+            return m_hugePages;
+        }
+
+        /*
+        * Round size up to a multiple of alignment.
+        *
+        * @param size Size to round up.
+        * @param alignment Power of two alignment.
+        *
+        * @return Rounded size.
+        */
+        static constexpr size_t roundUp(size_t size, size_t alignment) noexcept {
+            return (size + (alignment - 1)) & ~(alignment - 1);
+        }
+
+    private:
+        /*
+        * Touch every page so the memory is committed before it is used.
+        */
+        void prefault() noexcept {
+            volatile uint8_t* p = m_data;
+            for (size_t offset = 0; offset < m_size; offset += cPageBytes) {
+                p[offset] = 0;
+            }
+        }
+};
+
+#endif //MEMORY_ARENA_H
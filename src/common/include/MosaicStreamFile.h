@@ -0,0 +1,321 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/*********************************************************************
+ * @file  MosaicStreamFile.h
+ * 
+ * @brief Definition of the MosaicStreamFile class.
+ *********************************************************************/
+#ifndef MOSAIC_STREAM_FILE_H
+#define MOSAIC_STREAM_FILE_H
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <interfaces/FrameInterface.h>
+#include <AsyncFileWriter.h>
+#include <RawFile.h>
+#include <RawStreamFile.h>
+#include <TaskTileMosaic.h>
+
+
+/*
+* Streaming raw container for a whole tiled acquisition.
+*
+* The file holds rows * cols mosaic frames and is preallocated once. Each
+* stage position is one tile: BeginTile selects where its frames go, and
+* every frame written afterwards has its rows scattered to their final
+* offsets in the mosaic frame with the same index. Flips, and the optional
+* binned mosaic, are applied while writing, so no separate tiling pass is
+* needed. Tiles that are never written stay zero.
+*
+* Rows of different tiles are not contiguous in the file, so each tile row
+* is one positional write. The row writes of a frame, and of its binned
+* tile, are handed to the AsyncFileWriter as one batch, which submits them
+* together through io_uring. Writes go through the page cache, direct io is
+* not used because tile rows are not sector aligned.
+*/
+class MosaicStreamFile {
+    private:
+        std::filesystem::path m_path;
+        std::unique_ptr<RawFile<1>> m_raw;
+        std::unique_ptr<RawFile<1>> m_binnedRaw;
+        std::shared_mutex m_lock;
+        bool m_open{false};
+
+        uint32_t m_width, m_height;
+        uint32_t m_rows, m_cols;
+        uint8_t m_bitDepth, m_bytesPerPixel;
+        uint64_t m_frameCount;
+        bool m_vflip, m_hflip;
+        uint8_t m_binFactor{1};
+
+        //current tile
+        uint32_t m_tile{0};
+        bool m_tileOpen{false};
+        std::filesystem::path m_indexPath;
+        std::vector<RawStreamIndexEntry> m_index;
+        std::atomic<uint64_t> m_framesWritten{0};
+
+    public:
+        /*
+        * MosaicStreamFile constructor.
+        *
+        * @param path Path of the mosaic raw file.
+        * @param bitDepth Bit depth of the stored pixels (8 or 16).
+        * @param width Tile width in pixels.
+        * @param height Tile height in pixels.
+        * @param rows Number of tile rows.
+        * @param cols Number of tile columns.
+        * @param frameCount Number of frames to preallocate.
+        * @param vflip Flip each tile vertically.
+        * @param hflip Flip each tile horizontally.
+        * @param binnedPath Optional path of a mosaic binned by binFactor, each tile is binned on its own.
+        * @param binFactor Bin factor of the binned mosaic.
+        */
+        MosaicStreamFile(
+            std::filesystem::path path,
+            uint8_t bitDepth,
+            uint32_t width,
+            uint32_t height,
+            uint32_t rows,
+            uint32_t cols,
+            uint64_t frameCount,
+            bool vflip,
+            bool hflip,
+            std::filesystem::path binnedPath = {},
+            uint8_t binFactor = 1) :
+            m_path(path), m_width(width), m_height(height), m_rows(rows), m_cols(cols),
+            m_bitDepth(bitDepth), m_bytesPerPixel(bitDepth > 8 ? 2 : 1), m_frameCount(frameCount), m_vflip(vflip), m_hflip(hflip)
+        {
+            m_raw = std::make_unique<RawFile<1>>(m_path, m_bitDepth, m_cols * m_width, m_rows * m_height);
+            m_raw->Preallocate(m_frameCount);
+
+            if (!binnedPath.empty()) {
+                m_binFactor = std::max<uint8_t>(binFactor, 1);
+                m_binnedRaw = std::make_unique<RawFile<1>>(binnedPath, m_bitDepth, m_cols * (m_width / m_binFactor), m_rows * (m_height / m_binFactor));
+                m_binnedRaw->Preallocate(m_frameCount);
+            }
+            m_open = true;
+
+            spdlog::info("Opened mosaic stream {} for {} frames of {}x{} tiles of {}x{}, binned: {}",
+                m_path.string(), m_frameCount, m_rows, m_cols, m_width, m_height, binnedPath.empty() ? "no" : binnedPath.string());
+        }
+
+        /*
+        * MosaicStreamFile destructor, closes the file if still open.
+        */
+        ~MosaicStreamFile() {
+            Close();
+        }
+
+        MosaicStreamFile(const MosaicStreamFile&) = delete;
+        MosaicStreamFile& operator=(const MosaicStreamFile&) = delete;
+
+        /*
+        * Selects the tile the following frames are written to.
+        *
+        * @param tile Tile index in the mosaic (col + row * cols).
+        * @param indexPath Path of the frame index written for this tile by EndTile.
+        *
+        * @return true if successful, false if tile is outside the mosaic.
+        */
+        bool BeginTile(uint32_t tile, std::filesystem::path indexPath) {
+            std::unique_lock<std::shared_mutex> lock(m_lock);
+            if (!m_open || tile >= m_rows * m_cols) {
+                spdlog::error("Mosaic stream {} rejected tile {}", m_path.string(), tile);
+                return false;
+            }
+
+            m_tile = tile;
+            m_tileOpen = true;
+            m_indexPath = indexPath;
+            m_index.assign(m_frameCount, RawStreamIndexEntry{});
+            m_framesWritten = 0;
+            return true;
+        }
+
+        /*
+        * Ends the current tile and writes its frame index, all writes of the tile must have returned.
+        */
+        void EndTile() {
+            std::unique_lock<std::shared_mutex> lock(m_lock);
+            if (!m_tileOpen) {
+                return;
+            }
+            m_tileOpen = false;
+            writeIndex();
+
+            spdlog::info("Mosaic stream {} tile {} done, frames written: {}", m_path.string(), m_tile, m_framesWritten.load());
+        }
+
+        /*
+        * Write frame of the current tile at its acquisition index, safe to call from multiple threads.
+        *
+        * @tparam F FrameConcept type.
+        * @param ctx Frame context, ctx->index selects the mosaic frame.
+        * @param frame The frame to write.
+        * @param writer Writer the rows of the frame are submitted through, returns once they are written.
+        *
+        * @return true if successful, false otherwise.
+        */
+        template<FrameConcept F>
+        bool Write(const FrameCtx* ctx, F* frame, AsyncFileWriter* writer) {
+            std::shared_lock<std::shared_mutex> lock(m_lock);
+            if (!m_open || !m_tileOpen || ctx->index >= m_frameCount) {
+                spdlog::error("Mosaic stream {} rejected frame index {}", m_path.string(), ctx->index);
+                return false;
+            }
+
+            const uint8_t* data = static_cast<const uint8_t*>(frame->GetData());
+            const size_t rowBytes = size_t(m_width) * m_bytesPerPixel;
+
+            //horizontal flips and binning go through a per thread copy of the tile
+            thread_local TaskTileMosaic task;
+            thread_local std::vector<uint8_t> tile, binned;
+            const bool staged = m_hflip || m_binnedRaw;
+            if (staged) {
+                tile.resize(rowBytes * m_height);
+                binned.resize(m_binnedRaw ? (m_width / m_binFactor) * (m_height / m_binFactor) * m_bytesPerPixel : 0);
+
+                task.Setup({ data }, m_width, m_height, 1, 1, m_bytesPerPixel, m_vflip, m_hflip, tile.data(), m_binnedRaw ? binned.data() : nullptr, m_binFactor);
+                task.Run(1, 0);
+            }
+
+            //vertical flips of unstaged tiles are applied by the row order
+            thread_local std::vector<WriteSegment> segments;
+            segments.clear();
+            scatter(segments, *m_raw, ctx->index, m_width, m_height, [&](uint32_t y) {
+                return staged ? tile.data() + y * rowBytes : data + (m_vflip ? m_height - y - 1 : y) * rowBytes;
+            });
+
+            if (m_binnedRaw) {
+                //a bin factor of 1 stores a copy of the tile
+                const uint8_t* src = (m_binFactor > 1) ? binned.data() : tile.data();
+                const uint32_t bw = m_width / m_binFactor, bh = m_height / m_binFactor;
+                scatter(segments, *m_binnedRaw, ctx->index, bw, bh, [&](uint32_t y) {
+                    return src + size_t(y) * bw * m_bytesPerPixel;
+                });
+            }
+
+            if (!writer->WriteBatch(segments)) {
+                spdlog::error("Mosaic stream {} short write for frame index {}", m_path.string(), ctx->index);
+                return false;
+            }
+
+            const FrameInfo* info = frame->GetInfo();
+            m_index[ctx->index] = RawStreamIndexEntry {
+                .frameNr = info->frameNr,
+                .timestampBOF = info->timestampBOF,
+                .timestampEOF = info->timestampEOF,
+            };
+            ++m_framesWritten;
+            return true;
+        }
+
+        /*
+        * Close mosaic files, ends the current tile first.
+        */
+        void Close() {
+            EndTile();
+
+            std::unique_lock<std::shared_mutex> lock(m_lock);
+            if (!m_open) {
+                return;
+            }
+            m_open = false;
+
+            m_raw->Close();
+            if (m_binnedRaw) {
+                m_binnedRaw->Close();
+            }
+            spdlog::info("Closed mosaic stream {}", m_path.string());
+        }
+
+        /*
+        * Number of frames written for the current tile.
+        *
+        * @return Frames written so far.
+        */
+        uint64_t FramesWritten() const {
+            return m_framesWritten;
+        }
+
+    private:
+        /*
+        * Adds the row writes of a tile of tileWidth x tileHeight pixels in mosaic frame idx of file to segments.
+        *
+        * @param row Returns the data of tile row y.
+        */
+        template<typename R>
+        void scatter(std::vector<WriteSegment>& segments, RawFile<1>& file, uint64_t idx, uint32_t tileWidth, uint32_t tileHeight, R&& row) {
+            const size_t rowBytes = size_t(tileWidth) * m_bytesPerPixel;
+            const size_t mosaicRowBytes = rowBytes * m_cols;
+            const uint64_t tileRow = m_tile / m_cols, tileCol = m_tile % m_cols;
+            const uint64_t base = idx * file.FrameStride() + (tileRow * tileHeight * mosaicRowBytes) + tileCol * rowBytes;
+            const uint8_t* first = row(0);
+
+            //a single column mosaic stores whole tiles contiguously
+            if (m_cols == 1 && tileHeight > 1 && row(1) == first + rowBytes) {
+                segments.push_back(WriteSegment { .fd = file.NativeHandle(first), .data = first, .bytes = rowBytes * tileHeight, .offset = base });
+                return;
+            }
+
+            for (uint32_t y = 0; y < tileHeight; y++) {
+                const uint8_t* data = row(y);
+                segments.push_back(WriteSegment { .fd = file.NativeHandle(data), .data = data, .bytes = rowBytes, .offset = base + y * mosaicRowBytes });
+            }
+        }
+
+        /*
+        * Writes the frame index of the current tile.
+        */
+        void writeIndex() {
+            std::ofstream out(m_indexPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                spdlog::error("Could not write frame index {}", m_indexPath.string());
+                return;
+            }
+
+            //frameStride is the distance between mosaic frames holding the tile
+            const RawStreamIndexHeader header {
+                .width = m_width,
+                .height = m_height,
+                .bitDepth = m_bitDepth,
+                .frameBytes = uint64_t(m_width) * m_height * m_bytesPerPixel,
+                .frameStride = m_raw->FrameStride(),
+                .frameCount = m_frameCount,
+            };
+
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(m_index.data()), m_index.size() * sizeof(RawStreamIndexEntry));
+        }
+};
+
+#endif //MOSAIC_STREAM_FILE_H
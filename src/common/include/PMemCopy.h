@@ -30,6 +30,7 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <memory> // std::unique_ptr
@@ -45,6 +46,9 @@
 */
 class PMemCopy {
     private:
+        // copies are claimed by executor threads in chunks of about this size
+        static constexpr size_t cChunkBytes = 256 * 1024;
+
         std::mutex m_copyMutex{};
 
         void* m_dest{nullptr};
@@ -64,6 +68,16 @@ class PMemCopy {
         ~PMemCopy() {
         }
 
+        /*
+         * Number of parts to split a copy into, enough that executor
+         * threads balance the copy between them.
+         *
+         * @param count The number of bytes to copy.
+         */
+        static uint8_t Parts(size_t count) noexcept {
+            return uint8_t(std::clamp<size_t>(count / cChunkBytes, 1, 255));
+        }
+
         /*
          * Setup parallel copy task.
          *
@@ -30,54 +30,93 @@
 #ifndef PAR_TASK_H
 #define PAR_TASK_H
 
-#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <deque>
 #include <memory> // std::unique_ptr
 #include <mutex>
-#include <chrono>
-#include <shared_mutex>
 #include <thread>
 #include <vector>
 #include <functional>
 
 #include <spdlog/spdlog.h>
+#include <SpscQueue.h> // cpuRelax
+#include <ThreadPolicy.h>
 #include <interfaces/ParTaskInterface.h>
 
 /*
 * Parallel task executor class.
+*
+* Persistent fork/join executor. A submitted task is split into parts that
+* executor threads, and the thread waiting on it, claim one at a time, so a
+* slow or preempted core only delays the part it holds. Idle executors spin
+* briefly and then park on an epoch counter that every submit advances, a
+* submit can never be missed by a thread that is about to park.
 */
 class ParTask {
     private:
-        std::mutex m_taskLock;
-        std::mutex m_queueMutex;
+        /*
+        * Number of spin iterations before an idle thread parks.
+        */
+        static constexpr uint32_t cSpinIterations = 2048;
 
-        std::mutex m_waitMutex;
-        std::mutex m_lock;
-        std::condition_variable m_mutexCond;
-        std::condition_variable m_waitCond;
+        /*
+        * Submitted task and its part counters.
+        */
+        struct Job {
+            std::function<void(uint8_t, uint8_t)> run;
+            uint8_t parts{0};
+            std::atomic<uint32_t> next{0};
+            std::atomic<uint32_t> remaining{0};
+        };
 
-        std::vector<std::thread> m_threads;
+    public:
+        /*
+        * Completion token for a submitted task. A default constructed
+        * token is already complete.
+        */
+        class Token {
+            friend class ParTask;
 
-        uint8_t m_threadCount{0};
-        std::atomic<uint8_t> m_running{0};
+            private:
+                std::shared_ptr<Job> m_job;
+
+            public:
+                /*
+                * Check if every part of the task has finished.
+                */
+                bool Done() const noexcept {
+                    return !m_job || m_job->remaining.load(std::memory_order_acquire) == 0;
+                }
+        };
+
+    private:
+        std::mutex m_jobLock;
+        std::deque<std::shared_ptr<Job>> m_jobs;
+
+        alignas(cCacheLineBytes) std::atomic<uint64_t> m_epoch{0};
+        std::atomic<bool> m_stopFlag{false};
 
-        bool m_stopFlag{false};
-        std::function<void(uint8_t, uint8_t)> m_task;
+        std::vector<std::thread> m_threads;
+        uint8_t m_threadCount{0};
+        ThreadRole m_role{ThreadRole::None};
 
     public:
         /*
         * Parallel task executor class constructor.
         *
-        * @param threads Number of threads to run the executor.
+        * @param threads Number of threads to run the executor, the thread
+        *                waiting on a task also runs its parts.
+        * @param role Thread policy role of the executor threads.
         */
-        ParTask(uint8_t threads) : m_threadCount(threads) {
+        ParTask(uint8_t threads, ThreadRole role = ThreadRole::None) : m_threadCount(threads), m_role(role) {
             m_threads.reserve(m_threadCount);
-            m_running = 0;
 
             spdlog::info("Starting {} threads", m_threadCount);
 
             for (uint8_t n = 0; n < m_threadCount; ++n) {
-                auto thread = std::thread(&ParTask::executor, this, n);
-                m_threads.push_back(std::move(thread));
+                m_threads.emplace_back(&ParTask::executor, this);
             }
         }
 
@@ -86,7 +125,8 @@ class ParTask {
          */
         ~ParTask() {
             m_stopFlag = true;
-            m_mutexCond.notify_all();
+            m_epoch.fetch_add(1, std::memory_order_release);
+            m_epoch.notify_all();
 
             for (auto& t : m_threads) {
                 t.join();
@@ -94,63 +134,149 @@ class ParTask {
         }
 
         /*
-         * Start task.
+        * Number of executor threads.
+        */
+        uint8_t Threads() const noexcept { return m_threadCount; }
+
+        /*
+         * Submit task without waiting for it.
+         *
+         * Splits the task into parts, part n runs as task->Run(parts, n).
+         * The task must stay unchanged until the returned token is done.
          *
          * @tparam T Task concept type.
          * @param task Pointer to the task object.
+         * @param parts Number of parts, 0 for task->Parts() if the task
+         *              defines it, otherwise one part per executor thread.
+         * @return Token to wait on.
          */
         template<TaskConcept T>
-        void Start(std::shared_ptr<T> task) noexcept {
-            std::unique_lock<std::mutex> lock(m_taskLock);
+        Token Submit(std::shared_ptr<T> task, uint8_t parts = 0) noexcept {
+            if constexpr (requires { { task->Parts() } -> std::convertible_to<uint8_t>; }) {
+                if (parts == 0) {
+                    parts = task->Parts();
+                }
+            }
+            if (parts == 0) {
+                parts = std::max<uint8_t>(m_threadCount, 1);
+            }
+
+            Token token;
+            token.m_job = std::make_shared<Job>();
+            token.m_job->run = [task](uint8_t count, uint8_t part) { task->Run(count, part); };
+            token.m_job->parts = parts;
+            token.m_job->remaining.store(parts, std::memory_order_relaxed);
+
             {
-                std::unique_lock<std::mutex> qlock(m_queueMutex);
-                m_task = std::bind(&T::Run, task, std::placeholders::_1, std::placeholders::_2);
-                m_running = m_threadCount;
+                std::unique_lock<std::mutex> lock(m_jobLock);
+                m_jobs.push_back(token.m_job);
             }
-            start();
+            m_epoch.fetch_add(1, std::memory_order_release);
+            m_epoch.notify_all();
+
+            return token;
+        }
+
+        /*
+         * Wait for a submitted task, running its unclaimed parts on the
+         * calling thread.
+         *
+         * @param token Token returned by Submit.
+         */
+        void Wait(Token& token) noexcept {
+            if (!token.m_job) {
+                return;
+            }
+            Job& job = *token.m_job;
+            runParts(job);
+
+            for (uint32_t spin = 0; spin < cSpinIterations; ++spin) {
+                if (job.remaining.load(std::memory_order_acquire) == 0) {
+                    token.m_job.reset();
+                    return;
+                }
+                cpuRelax();
+            }
+
+            uint32_t remaining = job.remaining.load(std::memory_order_acquire);
+            while (remaining != 0) {
+                job.remaining.wait(remaining, std::memory_order_acquire);
+                remaining = job.remaining.load(std::memory_order_acquire);
+            }
+            token.m_job.reset();
+        }
+
+        /*
+         * Start task and wait for it to finish.
+         *
+         * @tparam T Task concept type.
+         * @param task Pointer to the task object.
+         * @param parts Number of parts, 0 for the Submit default.
+         */
+        template<TaskConcept T>
+        void Start(std::shared_ptr<T> task, uint8_t parts = 0) noexcept {
+            Token token = Submit(task, parts);
+            Wait(token);
         }
 
     private:
         /*
-         * Starts task on all threads.
+         * Claim and run parts of a job until none are left.
+         *
+         * @param job The job to run.
+         */
+        static void runParts(Job& job) noexcept {
+            for (;;) {
+                const uint32_t part = job.next.fetch_add(1, std::memory_order_relaxed);
+                if (part >= job.parts) {
+                    return;
+                }
+
+                job.run(job.parts, uint8_t(part));
+
+                if (job.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    job.remaining.notify_all();
+                }
+            }
+        }
+
+        /*
+         * Oldest job with unclaimed parts, drops fully claimed jobs.
          */
-        void start() noexcept {
-            // {
-            //     std::unique_lock<std::mutex> lock(m_queueMutex);
-            //     m_mutexCond.notify_all();
-            // }
-            m_mutexCond.notify_all();
-
-            std::unique_lock<std::mutex> lock(m_waitMutex);
-            m_waitCond.wait(lock, [this]() { return (m_running == 0); });
+        std::shared_ptr<Job> nextJob() noexcept {
+            std::unique_lock<std::mutex> lock(m_jobLock);
+            while (!m_jobs.empty()) {
+                if (m_jobs.front()->next.load(std::memory_order_relaxed) < m_jobs.front()->parts) {
+                    return m_jobs.front();
+                }
+                m_jobs.pop_front();
+            }
+            return nullptr;
         }
 
         /*
          * Executor thread function.
-         *
-         * @param taskNum The thread id.
          */
-        void executor(uint8_t taskNum) noexcept {
-            //size_t rem = 0;
-
-            std::unique_lock<std::mutex> exeLock(m_queueMutex);
-            m_mutexCond.wait(exeLock);
-
-            while (!m_stopFlag) {
-                //run task
-                exeLock.unlock(); 
-                m_task(m_threadCount, taskNum);
-                exeLock.lock();
-
-                {
-                    std::unique_lock<std::mutex> lock(m_waitMutex);
-                    m_running--;
-                    m_waitCond.notify_one();
+        void executor() noexcept {
+            ApplyThreadPolicy(m_role);
+
+            while (!m_stopFlag.load(std::memory_order_acquire)) {
+                // read the epoch before looking for work, a later submit always changes it
+                const uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+
+                if (auto job = nextJob()) {
+                    runParts(*job);
+                    continue;
                 }
 
-                m_mutexCond.wait(exeLock);
+                uint32_t spin = 0;
+                while (m_epoch.load(std::memory_order_acquire) == epoch && spin < cSpinIterations) {
+                    cpuRelax();
+                    ++spin;
+                }
+                m_epoch.wait(epoch, std::memory_order_acquire);
             }
         }
 };
 
-#endif //THREAD_POOL_H
+#endif //PAR_TASK_H
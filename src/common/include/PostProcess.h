@@ -1,6 +1,8 @@
 #ifndef POST_PROCESS_H
 #define POST_PROCESS_H
+#include <condition_variable>
 #include <filesystem>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <numeric>
@@ -10,9 +12,12 @@
 #include <TiffFile.h>
 #include <ThreadPool.h>
 #include <RawFile.h>
+#include <MappedFile.h>
 #include <TaskFrameStats.h>
 #include <TaskFrameLut16.h>
 #include <TaskApplyLut16.h>
+#include <TaskTileMosaic.h>
+#include <WorkerStage.h>
 
 #ifdef _WIN64
 #include <windows.h>
@@ -39,57 +44,33 @@ namespace PostProcess {
         t.Close();
     }
 
-    void CopyRawTask(std::string inf, uint8_t* buf, uint32_t width, uint32_t height, size_t cols, uint8_t bytesPerPixel, bool vflip, bool hflip) {
-        size_t size = width*height;
-        uint8_t* data = nullptr;
-
-        //MMAP file
-#ifdef _WIN64
-        HANDLE file = CreateFileA(inf.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
-        if(file == INVALID_HANDLE_VALUE) {
-            spdlog::error("Could not open file {}, Error {}", inf, GetLastError());
-            return;
-        };
-
-        HANDLE mapping  = CreateFileMapping(file, 0, PAGE_READONLY, 0, 0, 0);
-
-        if(mapping == 0) {
-            spdlog::error("Could not mmap file {}, Error {}", inf, GetLastError());
-            CloseHandle(file);
-
+    /** @brief Copies rows of the frame at offset in an open raw stream file into output buffer */
+    void CopyRawTask(MappedFile& file, uint64_t offset, uint8_t* buf, uint32_t width, uint32_t height, size_t cols, uint8_t bytesPerPixel, bool vflip, bool hflip) {
+        MappedFile::Frame frame = file.Read(offset, static_cast<size_t>(width) * height * bytesPerPixel);
+        const uint8_t* data = frame.Data();
+        if (data == nullptr) {
             return;
         }
 
-        data = (uint8_t*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
-
-        if (data == 0) {
-            spdlog::error("Could not map file view for file {}, Error {}", inf, GetLastError());
-            CloseHandle(mapping);
-            CloseHandle(file);
-
-            return;
-        }
-#endif
-
         for (uint32_t i = 0; i < height; i++) {
             size_t idx = bytesPerPixel*width*cols*i;
+            const uint8_t* src = data + ((vflip ? (height - i - 1) : i) * bytesPerPixel * width);
 
-            if (vflip) {
-                std::memcpy(buf+idx, data+((height - i - 1) * bytesPerPixel * width), bytesPerPixel*width);
+            //reverse whole pixels, not bytes
+            if (hflip && bytesPerPixel == 2) {
+                TaskTileMosaic::ReverseCopy(reinterpret_cast<uint16_t*>(buf+idx), reinterpret_cast<const uint16_t*>(src), width);
+            } else if (hflip) {
+                TaskTileMosaic::ReverseCopy(buf+idx, src, width);
             } else {
-                std::memcpy(buf+idx, data+(i*bytesPerPixel*width), bytesPerPixel*width);
-            }
-
-            if (hflip) {
-                std::reverse(buf+idx, buf+idx+(bytesPerPixel * width));
+                std::memcpy(buf+idx, src, bytesPerPixel*width);
             }
         }
+    }
 
-#ifdef _WIN64
-        UnmapViewOfFile(data);
-        CloseHandle(mapping);
-        CloseHandle(file);
-#endif
+    /** @brief Copies rows of the frame at offset in a raw stream file into output buffer */
+    void CopyRawTask(std::string inf, uint64_t offset, uint8_t* buf, uint32_t width, uint32_t height, size_t cols, uint8_t bytesPerPixel, bool vflip, bool hflip) {
+        MappedFile file(inf);
+        CopyRawTask(file, offset, buf, width, height, cols, bytesPerPixel, vflip, hflip);
     }
     
     /** @brief Downsample images with user-defined bin factor */
@@ -104,7 +85,9 @@ namespace PostProcess {
     {   
         size_t binnedWidth = width / binFactor;
         size_t binnedHeight = height / binFactor;
-        T *binnedFrameData = new T[binnedWidth * binnedHeight];
+        //reused across frames
+        thread_local std::vector<T> binnedFrameData;
+        binnedFrameData.resize(binnedWidth * binnedHeight);
 
         for (size_t i = 0; i < binnedHeight; i++) {
             for (size_t j = 0; j < binnedWidth; j++) {
@@ -128,10 +111,17 @@ namespace PostProcess {
             }
         }
 
-        r->Write(binnedFrameData, fr); 
+        r->Write(binnedFrameData.data(), fr);
     }
 
-    /** @brief Autotile images from indir to single tiff stack in outdir */
+    /**
+     * @brief Autotile images from indir to single tiff stack in outdir
+     *
+     * Runs as a three stage pipeline: a reader maps and prefetches the tiles of up to
+     * readAhead frames ahead, the calling thread stitches one frame at a time on the
+     * thread pool into a ring of mosaicBuffers buffers, and a writer writes finished
+     * frames behind it. Disk reads, stitching and writes of different frames overlap.
+     */
     void AutoTile(
         std::filesystem::path indir,
         std::string prefix,
@@ -143,61 +133,156 @@ namespace PostProcess {
         uint32_t width,
         uint32_t height,
         uint8_t bitDepth,
+        bool directIo,
         bool vflip,
         bool hflip,
         bool autoConBright,
         std::function<void(size_t n)> progressCB,
         std::shared_ptr<RawFile<6>> r,
         std::shared_ptr<RawFile<6>> r2,
-        uint8_t binFactor)
+        uint8_t binFactor,
+        uint32_t readAhead = 2,
+        uint32_t mosaicBuffers = 3)
     {
-        ThreadPool p(static_cast<concurrency_t>(rows*cols));
+        ThreadPool& p = ThreadPool::Shared();
         uint8_t bytesPerPixel = bitDepth / 8;
 
-        auto blockStart = [](uint8_t cols, uint8_t rowIdx, uint8_t colIdx, size_t width, size_t height, uint8_t bytesPerPixel) {
-            return static_cast<size_t>(((rowIdx * height) * (width * cols) + (colIdx * width)) * bytesPerPixel);
-        };
+        //each position is a single raw stream file, frames are padded to the sector size when recorded with direct io
+        const size_t tileBytes = static_cast<size_t>(width) * height * bytesPerPixel;
+        const uint64_t tileFrameStride = rawFrameStride(tileBytes, directIo);
 
         spdlog::info(
             "Tiling images from {} with rows: {}, cols: {}, frames: {}, width: {}, height: {}, bytesPerPixel: {}, vflip: {}, hflip: {}, thread count: {}",
             indir.string(), rows, cols, frames, width, height, bytesPerPixel, vflip, hflip, p.ThreadCount()
         );
 
-        uint8_t *frameData = new uint8_t[rows * cols * width * height * bytesPerPixel];
+        //1-based index for file names, disabled tiles have no file and stay zero
+        //files are opened and mapped once and read for every frame
+        std::vector<std::unique_ptr<MappedFile>> tileFiles(rows * cols);
+        for (uint32_t curr = 0; curr < rows * cols; curr++) {
+            if (tileEnabled[curr]) {
+                tileFiles[curr] = std::make_unique<MappedFile>(indir / fmt::format("{}_{}.raw", prefix, tileMap[curr]+1));
+                spdlog::info("Tile {} input mapped: {}", curr, tileFiles[curr]->Mapped());
+            }
+        }
 
-        for (uint32_t fr = 0; fr < frames; fr++) {
-            //reset each frame
-            memset((void*)frameData, 0, sizeof(uint8_t) * rows * cols * width * height * bytesPerPixel);
-
-            //read each image, 1-based index for file names
-            for(uint32_t row = 0; row < rows; row++) {
-                for(uint32_t col = 0; col < cols; col++) {
-                    auto curr = col+row*cols;
-                    if (!tileEnabled[curr]) {
-                        continue;
-                    }
+        //tiles of readAhead frames are read at once, slot fr % readAhead holds frame fr
+        struct TileFrame {
+            std::vector<MappedFile::Frame> views;
+            std::vector<const uint8_t*> tiles;
+            bool ready{false};
+        };
+
+        //mosaic and binned output of one frame
+        struct MosaicBuffer {
+            std::vector<uint8_t> frameData;
+            std::vector<uint8_t> binnedData;
+        };
 
-                    auto tileIdx = tileMap[curr];
-                    size_t blockStartIdx = blockStart(cols, row, col, width, height, bytesPerPixel);
-                    std::string f = fmt::format("{}_{}_{:#04}.raw", prefix, tileIdx+1, fr);
-                    p.AddTask(CopyRawTask, (indir / f).string(), frameData+blockStartIdx, width, height, cols, bytesPerPixel, vflip, hflip);
+        readAhead = std::max<uint32_t>(readAhead, 1);
+        mosaicBuffers = std::max<uint32_t>(mosaicBuffers, 1);
+
+        std::mutex lock;
+        std::condition_variable cv;
+        std::vector<TileFrame> tileFrames(readAhead);
+        std::vector<MosaicBuffer> buffers(mosaicBuffers);
+        std::vector<size_t> freeBuffers;
+
+        for (size_t b = 0; b < buffers.size(); b++) {
+            buffers[b].frameData.resize(rows * cols * tileBytes);
+            if (r2 != nullptr && binFactor > 1) {
+                buffers[b].binnedData.resize(((cols * width) / binFactor) * ((rows * height) / binFactor) * bytesPerPixel);
+            }
+            freeBuffers.push_back(b);
+        }
+
+        spdlog::info("Tiling pipeline read ahead: {} frames, mosaic buffers: {}", readAhead, mosaicBuffers);
+
+        //stages are declared after the buffers they use so they are joined first
+        WorkerStage<uint32_t> reader("tile read", readAhead, 1, [&](uint32_t& fr) {
+            TileFrame& tf = tileFrames[fr % readAhead];
+            tf.views.resize(rows * cols);
+            tf.tiles.assign(rows * cols, nullptr);
+
+            //start the disk reads of all tiles before waiting on any of them
+            for (auto& f : tileFiles) {
+                if (f) {
+                    f->WillNeed(fr * tileFrameStride, tileBytes);
                 }
             }
-            p.WaitForAll();
-            r->Write(frameData, fr);
-            
-            if (r2 != nullptr) {
-                spdlog::info("Downsampling frame {}", fr);
-                // pass in complete pixels, rows/columns do not matter at this point
-                if (bytesPerPixel == 1) {
-                    Downsample<uint8_t>(fr, frameData, r2, cols * width, rows * height, binFactor);
-                } else {
-                    Downsample<uint16_t>(fr, (uint16_t*)frameData, r2, cols * width, rows * height, binFactor);
+
+            for (uint32_t curr = 0; curr < rows * cols; curr++) {
+                if (tileFiles[curr]) {
+                    tf.views[curr] = tileFiles[curr]->Read(fr * tileFrameStride, tileBytes);
+                    tf.tiles[curr] = tf.views[curr].Data();
+                    tf.views[curr].Prefetch();
                 }
             }
 
+            std::unique_lock<std::mutex> l(lock);
+            tf.ready = true;
+            cv.notify_all();
+        }, ThreadRole::Pool);
+
+        WorkerStage<std::pair<uint32_t, size_t>> writer("tile write", mosaicBuffers, 1, [&](std::pair<uint32_t, size_t>& item) {
+            auto [fr, b] = item;
+            r->Write(buffers[b].frameData.data(), fr);
+            if (r2 != nullptr) {
+                r2->Write(buffers[b].binnedData.empty() ? buffers[b].frameData.data() : buffers[b].binnedData.data(), fr);
+            }
             progressCB(1);
+
+            std::unique_lock<std::mutex> l(lock);
+            freeBuffers.push_back(b);
+            cv.notify_all();
+        }, ThreadRole::Pool);
+
+        for (uint32_t fr = 0; fr < std::min(frames, readAhead); fr++) {
+            reader.Push(fr);
         }
+
+        TaskTileMosaic mosaic;
+        const uint8_t parts = static_cast<uint8_t>(std::min<size_t>(p.ThreadCount() + 1, 255));
+
+        for (uint32_t fr = 0; fr < frames; fr++) {
+            TileFrame& tf = tileFrames[fr % readAhead];
+            size_t b = 0;
+            {
+                std::unique_lock<std::mutex> l(lock);
+                cv.wait(l, [&]() { return tf.ready && !freeBuffers.empty(); });
+                b = freeBuffers.back();
+                freeBuffers.pop_back();
+            }
+            MosaicBuffer& buf = buffers[b];
+
+            //stitch, flip and bin in one pass over the tiles
+            mosaic.Setup(tf.tiles, width, height, rows, cols, bytesPerPixel, vflip, hflip, buf.frameData.data(), buf.binnedData.empty() ? nullptr : buf.binnedData.data(), binFactor);
+
+            ThreadPool::TaskGroup group(p);
+            for (uint8_t part = 0; part < parts; part++) {
+                group.Run([&mosaic, parts, part]() { mosaic.Run(parts, part); });
+            }
+            group.Wait();
+
+            //release the tiles and reuse the slot for the next frame to read
+            {
+                std::unique_lock<std::mutex> l(lock);
+                tf.ready = false;
+            }
+            tf.views.clear();
+            if (fr + readAhead < frames) {
+                reader.Push(fr + readAhead);
+            }
+
+            writer.Push({fr, b});
+        }
+
+        writer.Drain();
+
+        const StageStats rs = reader.Stats();
+        const StageStats ws = writer.Stats();
+        spdlog::info("Tiling finished, read mean: {:.1f} us, max: {:.1f} us, write mean: {:.1f} us, max: {:.1f} us",
+            rs.ServiceMeanUS(), rs.serviceMaxNS / 1000.0, ws.ServiceMeanUS(), ws.serviceMaxNS / 1000.0);
     }
 
 };
@@ -1,5 +1,7 @@
 #ifndef __RAW_FILE__H
 #define __RAW_FILE__H
+#include <filesystem>
+#include <mutex>
 #include <string>
 
 #include <spdlog/spdlog.h>
@@ -17,38 +19,89 @@
 
 //#define PWRITES 6
 
+// sector alignment for direct io, covers 512 byte and 4K sector drives
+constexpr uint64_t cDirectIoAlignment = 4096;
+
+/*
+ * Distance between frames in a raw file.
+ *
+ * @param frameBytes Size of a frame in bytes.
+ * @param directIo If frames are padded to the direct io sector alignment.
+ *
+ * @return Frame stride in bytes.
+ */
+inline uint64_t rawFrameStride(uint64_t frameBytes, bool directIo) {
+    return directIo ? (frameBytes + cDirectIoAlignment - 1) & ~(cDirectIoAlignment - 1) : frameBytes;
+}
+
 template<uint16_t PWRITES>
 class RawFile {
     private:
 #ifndef _WIN32
         int m_fd {-1};
+        int m_bufferedFd {-1}; // unaligned writes when m_fd bypasses the page cache
 #else
         HANDLE m_fd;
+        HANDLE m_bufferedFd{INVALID_HANDLE_VALUE};
         HANDLE m_hEvents[PWRITES];
         OVERLAPPED m_ovs[PWRITES];
+        std::mutex m_writeLock; // m_ovs and m_hEvents are shared by every Write call
 #endif
         std::filesystem::path m_file;
         uint16_t m_width;
         uint16_t m_height;
         uint8_t m_bitDepth;
         uint16_t* m_buf;
+        bool m_directIo{false};
+        uint64_t m_frameStride;
 
     public:
-        RawFile(std::filesystem::path file, uint8_t bitDepth, uint16_t width, uint16_t height) {
+        /*
+         * RawFile constructor.
+         *
+         * With directIo the file bypasses the page cache (O_DIRECT/FILE_FLAG_NO_BUFFERING),
+         * frames are padded to cDirectIoAlignment and should be written from buffers
+         * aligned to cDirectIoAlignment, unaligned buffers fall back to buffered writes.
+         *
+         * @param file Path of the file.
+         * @param bitDepth Bit depth of the stored pixels.
+         * @param width Frame width in pixels.
+         * @param height Frame height in pixels.
+         * @param directIo Use direct io.
+         */
+        RawFile(std::filesystem::path file, uint8_t bitDepth, uint16_t width, uint16_t height, bool directIo = false) {
             m_width = width;
             m_height = height;
             m_bitDepth = bitDepth;
             m_file = file;
+            m_directIo = directIo;
+            // stride only depends on the requested mode so readers can compute it from the config
+            m_frameStride = rawFrameStride(FrameBytes(), directIo);
 
 #ifndef _WIN32
-            m_fd = open(file.string().c_str(), O_WRONLY | O_CREAT, 0640);
+            if (m_directIo) {
+                m_fd = open(file.string().c_str(), O_WRONLY | O_CREAT | O_DIRECT, 0640);
+                if (m_fd < 0) {
+                    spdlog::warn("Direct io not supported for {} ({}), using buffered writes", file.string(), errno);
+                    m_directIo = false;
+                } else {
+                    m_bufferedFd = open(file.string().c_str(), O_WRONLY, 0640);
+                }
+            }
+
+            if (m_fd < 0) {
+                m_fd = open(file.string().c_str(), O_WRONLY | O_CREAT, 0640);
+            }
             if (m_fd < 0) {
                 spdlog::info("Async open error: {}", errno);
             }
 #else
-            m_fd = CreateFileA(file.string().c_str(), GENERIC_WRITE | GENERIC_READ, FILE_SHARE_WRITE, NULL, CREATE_NEW, FILE_FLAG_OVERLAPPED, NULL);
+            const DWORD flags = FILE_FLAG_OVERLAPPED | (m_directIo ? FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH : 0);
+            m_fd = CreateFileA(file.string().c_str(), GENERIC_WRITE | GENERIC_READ, FILE_SHARE_WRITE, NULL, CREATE_NEW, flags, NULL);
             if (m_fd == INVALID_HANDLE_VALUE) {
                 spdlog::error("RawFile error opening file ({}): {}", file.string(), GetLastError());
+            } else if (m_directIo) {
+                m_bufferedFd = CreateFileA(file.string().c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
             }
 
             for (auto i = 0; i < PWRITES; i++) {
@@ -62,35 +115,134 @@ class RawFile {
         void Close() {
 #ifndef _WIN32
             close(m_fd);
+            if (m_bufferedFd >= 0) {
+                close(m_bufferedFd);
+            }
 #else
             CloseHandle(m_fd);
+            if (m_bufferedFd != INVALID_HANDLE_VALUE) {
+                CloseHandle(m_bufferedFd);
+            }
             for (auto i = 0; i < PWRITES; i++) {
                 CloseHandle(m_hEvents[i]);
             }
 #endif
         };
 
+        /*
+         * Allocates the final file length up front so frames can be written at any
+         * index without the file system extending or fragmenting the file.
+         *
+         * @param frames Number of frames the file must hold.
+         *
+         * @return true if successful, false otherwise.
+         */
+        bool Preallocate(uint64_t frames) {
+            const uint64_t bytes = m_frameStride * frames;
+#ifndef _WIN32
+            if (fallocate(m_fd, 0, 0, bytes) != 0) {
+                // file systems without fallocate support still get the final size
+                if ((errno != EOPNOTSUPP && errno != ENOSYS) || ftruncate(m_fd, bytes) != 0) {
+                    spdlog::error("RawFile preallocate {} bytes failed for {}: {}", bytes, m_file.string(), errno);
+                    return false;
+                }
+            }
+#else
+            FILE_ALLOCATION_INFO alloc;
+            alloc.AllocationSize.QuadPart = bytes;
+            if (!SetFileInformationByHandle(m_fd, FileAllocationInfo, &alloc, sizeof(alloc))) {
+                spdlog::warn("RawFile could not reserve {} bytes for {}: {}", bytes, m_file.string(), GetLastError());
+            }
+
+            LARGE_INTEGER size;
+            size.QuadPart = bytes;
+            if (!SetFilePointerEx(m_fd, size, NULL, FILE_BEGIN) || !SetEndOfFile(m_fd)) {
+                spdlog::error("RawFile preallocate {} bytes failed for {}: {}", bytes, m_file.string(), GetLastError());
+                return false;
+            }
+#endif
+            return true;
+        }
+
+        /*
+         * Size of a single frame in the file.
+         *
+         * @return Frame size in bytes.
+         */
+        uint64_t FrameBytes() const {
+            return static_cast<uint64_t>(m_bitDepth / 8) * m_width * m_height;
+        }
+
+        /*
+         * Distance between frames in the file, FrameBytes padded to the sector size with direct io.
+         *
+         * @return Frame stride in bytes.
+         */
+        uint64_t FrameStride() const {
+            return m_frameStride;
+        }
+
+        /*
+         * If the file bypasses the page cache.
+         *
+         * @return true if direct io is active, false otherwise.
+         */
+        bool DirectIo() const {
+            return m_directIo;
+        }
+
+        /*
+         * Number of bytes to write for a frame stored in data.
+         *
+         * @param data Frame buffer.
+         *
+         * @return FrameStride for aligned buffers with direct io, FrameBytes otherwise.
+         */
+        uint64_t WriteBytes(const void* data) const {
+            return aligned(data) ? m_frameStride : FrameBytes();
+        }
+
+        /*
+         * Native file handle to write a frame stored in data, used to issue writes outside of this class.
+         *
+         * @param data Frame buffer.
+         *
+         * @return File descriptor (Linux) or file HANDLE (Windows).
+         */
+#ifndef _WIN32
+        int NativeHandle(const void* data) const {
+#else
+        HANDLE NativeHandle(const void* data) const {
+#endif
+            return (m_directIo && !aligned(data)) ? m_bufferedFd : m_fd;
+        }
+
         size_t Write(void* data, uint64_t idx) {
 #ifndef _WIN32
-            return pwrite(m_fd, data, m_width * m_height * (m_bitDepth / 8), ((m_bitDepth / 8) * m_width * m_height * idx));
+            return pwrite(NativeHandle(data), data, WriteBytes(data), m_frameStride * idx);
 #else
+            std::lock_guard<std::mutex> lock(m_writeLock);
+            const HANDLE fd = NativeHandle(data);
+            const DWORD bytes = static_cast<DWORD>(WriteBytes(data));
+            const bool sectorChunks = m_directIo && fd == m_fd;
 
-            DWORD chunk = ((m_bitDepth / 8) * m_width * m_height) / PWRITES;
-            DWORD chunkRem = ((m_bitDepth / 8) * m_width * m_height) % PWRITES;
-            uint64_t fileOffset = idx * static_cast<uint64_t>(m_bitDepth / 8) * m_width * m_height;
+            // unbuffered writes must cover whole sectors
+            DWORD chunk = sectorChunks ? (bytes / PWRITES) & ~DWORD(cDirectIoAlignment - 1) : bytes / PWRITES;
+            DWORD chunkRem = bytes - chunk * PWRITES;
+            uint64_t fileOffset = idx * m_frameStride;
 
             DWORD wrote = 0;
             BOOL ovRes;
 
             auto _write = [&](uint64_t _idx, DWORD _chunk, DWORD count) {
                 ULARGE_INTEGER uli;
-                uli.QuadPart = fileOffset + static_cast<uint64_t>(_idx*count);
+                uli.QuadPart = fileOffset + static_cast<uint64_t>(_idx*_chunk);
 
                 m_ovs[_idx].Offset = uli.LowPart;
                 m_ovs[_idx].OffsetHigh = uli.HighPart;
                 m_ovs[_idx].hEvent = m_hEvents[_idx];
 
-                if (0 == WriteFile(m_fd, static_cast<uint8_t*>(data)+(_idx*_chunk), count, NULL, &m_ovs[_idx])) {
+                if (0 == WriteFile(fd, static_cast<uint8_t*>(data)+(_idx*_chunk), count, NULL, &m_ovs[_idx])) {
                     DWORD lastError = GetLastError();
                     switch (lastError) {
                         case ERROR_IO_PENDING:
@@ -112,7 +264,7 @@ class RawFile {
                     }
                 }
 
-                ovRes = GetOverlappedResult(m_fd, &m_ovs[_idx], &wrote, FALSE);
+                ovRes = GetOverlappedResult(fd, &m_ovs[_idx], &wrote, FALSE);
                 if (ovRes == 0) {
                     DWORD lastError = GetLastError();
                     switch (lastError) {
@@ -143,5 +295,17 @@ class RawFile {
 #endif
         }
 
+    private:
+        /*
+         * Checks if data can be written with direct io.
+         *
+         * @param data Frame buffer.
+         *
+         * @return true if direct io is active and data is sector aligned.
+         */
+        bool aligned(const void* data) const {
+            return m_directIo && (reinterpret_cast<uintptr_t>(data) & (cDirectIoAlignment - 1)) == 0;
+        }
+
 };
 #endif //__RAW_FILE__H
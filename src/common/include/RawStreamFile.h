@@ -0,0 +1,284 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  RawStreamFile.h
+ * 
+ * @brief Definition of the RawStreamFile class.
+ *********************************************************************/
+#ifndef RAW_STREAM_FILE_H
+#define RAW_STREAM_FILE_H
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <interfaces/FrameInterface.h>
+#include <AsyncFileWriter.h>
+#include <RawFile.h>
+
+#pragma pack(push, 1)
+/*
+* Header of the frame index file written next to each raw stream file.
+*/
+struct RawStreamIndexHeader {
+    char magic[4]{'N', 'R', 'S', 'I'};
+    uint32_t version{1};
+    uint32_t width{0};
+    uint32_t height{0};
+    uint32_t bitDepth{0};
+    uint64_t frameBytes{0};  // bytes of pixel data per frame
+    uint64_t frameStride{0}; // distance between frames in the raw file
+    uint64_t frameCount{0};  // number of entries following the header
+};
+
+/*
+* Frame index entry, entry i describes the frame stored at offset i * frameStride.
+* A frameNr of 0 marks a frame that was never written.
+*/
+struct RawStreamIndexEntry {
+    uint32_t frameNr{0};
+    uint64_t timestampBOF{0};
+    uint64_t timestampEOF{0};
+};
+#pragma pack(pop)
+
+
+/*
+* Streaming raw container for a single stage position.
+*
+* The file is created and preallocated once for the whole acquisition and
+* kept open, each frame is written at its index offset, either directly or
+* through an AsyncFileWriter. On Close a compact
+* frame index (<file>.idx) is written with the frame number and timestamps
+* of every stored frame.
+*/
+class RawStreamFile {
+    private:
+        std::filesystem::path m_path;
+        std::unique_ptr<RawFile<4>> m_raw;
+        std::shared_mutex m_lock;
+        bool m_open{false};
+
+        uint32_t m_width;
+        uint32_t m_height;
+        uint8_t m_bitDepth;
+        uint64_t m_frameCount;
+        std::vector<RawStreamIndexEntry> m_index;
+        std::atomic<uint64_t> m_framesWritten{0};
+        std::mutex m_pendingLock;
+        std::condition_variable m_pendingCond;
+        uint32_t m_pending{0};
+
+    public:
+        /*
+        * RawStreamFile constructor.
+        *
+        * @param path Path of the raw file, the index is written to path with an .idx extension.
+        * @param bitDepth Bit depth of the stored pixels (8 or 16).
+        * @param width Frame width in pixels.
+        * @param height Frame height in pixels.
+        * @param frameCount Number of frames to preallocate.
+        * @param directIo Bypass the page cache, frames are padded to the sector size.
+        */
+        RawStreamFile(std::filesystem::path path, uint8_t bitDepth, uint32_t width, uint32_t height, uint64_t frameCount, bool directIo = false) :
+            m_path(path), m_width(width), m_height(height), m_bitDepth(bitDepth), m_frameCount(frameCount) {
+            m_raw = std::make_unique<RawFile<4>>(m_path, m_bitDepth, m_width, m_height, directIo);
+            m_raw->Preallocate(m_frameCount);
+            m_index.resize(m_frameCount);
+            m_open = true;
+
+            spdlog::info("Opened raw stream {} for {} frames of {} bytes, stride: {}, direct io: {}", m_path.string(), m_frameCount, m_raw->FrameBytes(), m_raw->FrameStride(), m_raw->DirectIo());
+        }
+
+        /*
+        * RawStreamFile destructor, closes the file if still open.
+        */
+        ~RawStreamFile() {
+            Close();
+        }
+
+        RawStreamFile(const RawStreamFile&) = delete;
+        RawStreamFile& operator=(const RawStreamFile&) = delete;
+
+        /*
+        * Write frame at its acquisition index, safe to call from multiple threads.
+        * Writes run concurrently on Linux, on Windows RawFile serialises them since
+        * its overlapped write state is shared.
+        *
+        * @tparam F FrameConcept type.
+        * @param ctx Frame context, ctx->index selects the offset in the file.
+        * @param frame The frame to write.
+        *
+        * @return true if successful, false otherwise.
+        */
+        template<FrameConcept F>
+        bool Write(const FrameCtx* ctx, F* frame) {
+            std::shared_lock<std::shared_mutex> lock(m_lock);
+            if (!m_open || ctx->index >= m_frameCount) {
+                spdlog::error("Raw stream {} rejected frame index {}", m_path.string(), ctx->index);
+                return false;
+            }
+
+            if (m_raw->Write(frame->GetData(), ctx->index) < m_raw->FrameBytes()) {
+                spdlog::error("Raw stream {} short write for frame index {}", m_path.string(), ctx->index);
+                return false;
+            }
+
+            const FrameInfo* info = frame->GetInfo();
+            m_index[ctx->index] = RawStreamIndexEntry {
+                .frameNr = info->frameNr,
+                .timestampBOF = info->timestampBOF,
+                .timestampEOF = info->timestampEOF,
+            };
+            ++m_framesWritten;
+            return true;
+        }
+
+        /*
+        * Queue frame write at its acquisition index, safe to call from multiple threads.
+        *
+        * The frame is owned by the write until release is called, release is
+        * called exactly once if this function returns true.
+        *
+        * @tparam F FrameConcept type.
+        * @param ctx Frame context, ctx->index selects the offset in the file.
+        * @param frame The frame to write, its data must not change until released.
+        * @param writer Async writer used to issue the write.
+        * @param release Called with the frame once the write completed, must outlive the stream.
+        *
+        * @return true if the write was queued, false if rejected (frame still owned by caller).
+        */
+        template<FrameConcept F>
+        bool WriteAsync(const FrameCtx* ctx, F* frame, AsyncFileWriter* writer, const std::function<void(F*)>& release) {
+            std::shared_lock<std::shared_mutex> lock(m_lock);
+            if (!m_open || ctx->index >= m_frameCount) {
+                spdlog::error("Raw stream {} rejected frame index {}", m_path.string(), ctx->index);
+                return false;
+            }
+
+            // index entry is recorded up front and cleared if the write fails
+            const uint64_t idx = ctx->index;
+            const FrameInfo* info = frame->GetInfo();
+            m_index[idx] = RawStreamIndexEntry {
+                .frameNr = info->frameNr,
+                .timestampBOF = info->timestampBOF,
+                .timestampEOF = info->timestampEOF,
+            };
+
+            {
+                std::lock_guard<std::mutex> pendingLock(m_pendingLock);
+                ++m_pending;
+            }
+            writer->Write(m_raw.get(), frame->GetData(), idx, [this, idx, frame, &release](bool ok) {
+                if (ok) {
+                    ++m_framesWritten;
+                } else {
+                    m_index[idx] = RawStreamIndexEntry{};
+                    spdlog::error("Raw stream {} write failed for frame index {}", m_path.string(), idx);
+                }
+                release(frame);
+
+                std::lock_guard<std::mutex> pendingLock(m_pendingLock);
+                if (--m_pending == 0) {
+                    m_pendingCond.notify_all();
+                }
+            });
+            return true;
+        }
+
+        /*
+        * Close raw file and write frame index, waits for queued writes first.
+        */
+        void Close() {
+            std::unique_lock<std::shared_mutex> lock(m_lock);
+            if (!m_open) {
+                return;
+            }
+            m_open = false;
+
+            {
+                std::unique_lock<std::mutex> pendingLock(m_pendingLock);
+                m_pendingCond.wait(pendingLock, [this]() { return m_pending == 0; });
+            }
+            m_raw->Close();
+            writeIndex();
+
+            spdlog::info("Closed raw stream {}, frames written: {}", m_path.string(), m_framesWritten.load());
+        }
+
+        /*
+        * Number of frames written.
+        *
+        * @return Frames written so far.
+        */
+        uint64_t FramesWritten() const {
+            return m_framesWritten;
+        }
+
+        /*
+        * Distance between frames in the raw file.
+        *
+        * @return Frame stride in bytes.
+        */
+        uint64_t FrameStride() const {
+            return m_raw->FrameStride();
+        }
+
+    private:
+        /*
+        * Writes the frame index next to the raw file.
+        */
+        void writeIndex() {
+            std::filesystem::path idxPath = m_path;
+            idxPath.replace_extension(".idx");
+
+            std::ofstream out(idxPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                spdlog::error("Could not write frame index {}", idxPath.string());
+                return;
+            }
+
+            const RawStreamIndexHeader header {
+                .width = m_width,
+                .height = m_height,
+                .bitDepth = m_bitDepth,
+                .frameBytes = m_raw->FrameBytes(),
+                .frameStride = m_raw->FrameStride(),
+                .frameCount = m_frameCount,
+            };
+
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(m_index.data()), m_index.size() * sizeof(RawStreamIndexEntry));
+        }
+};
+
+#endif //RAW_STREAM_FILE_H
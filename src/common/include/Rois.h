@@ -53,6 +53,7 @@ namespace Rois {
     };
 
     std::vector<std::tuple<uint32_t, uint32_t>> roiOffsets(RoiCfg* roi, size_t frameWidth, size_t frameHeight);
+    std::vector<std::tuple<uint32_t, uint32_t>> roiWells(RoiCfg* roi, size_t tile, size_t plateCols, bool vflip, bool hflip);
     std::string wellName(uint32_t row, uint32_t col);
     uint32_t roiToOffset(uint32_t x, uint32_t y, uint32_t width);
     std::string getFFmpegCropFilter(RoiCfg* roi, size_t frameWidth, size_t frameHeight);
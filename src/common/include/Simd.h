@@ -0,0 +1,66 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  Simd.h
+ * 
+ * @brief Instruction set selection for the vectorised pixel kernels.
+ *
+ * Kernels pick their AVX2, SSE4.1, SSE2 or scalar variant at compile time from
+ * the target flags, release Windows builds use /arch:AVX2.
+ *********************************************************************/
+#ifndef SIMD_H
+#define SIMD_H
+
+#if defined(__AVX2__)
+#define NAUTILAI_SIMD_AVX2 1
+#define NAUTILAI_SIMD_SSE41 1
+#elif defined(__SSE4_1__) || defined(__AVX__)
+#define NAUTILAI_SIMD_SSE41 1
+#endif
+
+// baseline of every x86-64 target, kernels without an SSE2 variant treat it as scalar
+#if defined(__SSE2__) || defined(_M_X64) || defined(NAUTILAI_SIMD_SSE41)
+#define NAUTILAI_SIMD_SSE2 1
+#endif
+
+#if defined(NAUTILAI_SIMD_SSE2)
+#include <immintrin.h>
+#endif
+
+/*
+* Name of the instruction set the kernels were built for.
+*/
+constexpr const char* cSimdLevel =
+#if defined(NAUTILAI_SIMD_AVX2)
+    "avx2";
+#elif defined(NAUTILAI_SIMD_SSE41)
+    "sse4.1";
+#elif defined(NAUTILAI_SIMD_SSE2)
+    "sse2";
+#else
+    "scalar";
+#endif
+
+#endif //SIMD_H
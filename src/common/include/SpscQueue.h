@@ -0,0 +1,316 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  SpscQueue.h
+ * 
+ * Definition of the SpscQueue class.
+ *********************************************************************/
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+* Size of a cache line, used to keep producer and consumer state apart.
+*/
+constexpr size_t cCacheLineBytes = 64;
+
+/*
+* Hint to the cpu that we are in a spin-wait loop.
+*/
+inline void cpuRelax() noexcept {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/*
+* Queue occupancy counters.
+*/
+struct QueueStats {
+    size_t depth{0};
+    size_t capacity{0};
+    size_t highWater{0};
+    uint64_t pushed{0};
+    uint64_t rejected{0};
+};
+
+/*
+* Bounded lock-free single producer/single consumer queue.
+*
+* The producer (camera callback) never blocks or takes a lock, Push fails
+* when the queue is full. The producer may also take back the oldest item
+* with TryStealOldest, head updates are a CAS so this is safe against a
+* concurrent TryPop. The consumer spins briefly when the queue is empty
+* and then parks on an atomic wait (futex on linux, WaitOnAddress on windows)
+* until the producer publishes an item or Interrupt is called.
+*
+* Head and tail live on separate cache lines and each side keeps a cached
+* copy of the other side's index so the shared line is only read when the
+* cached value says the queue looks full/empty.
+*
+* @tparam T Trivially copyable item type.
+*/
+template<typename T>
+class SpscQueue {
+    private:
+        // consumer owned
+        alignas(cCacheLineBytes) std::atomic<size_t> m_head{0};
+        size_t m_tailCache{0};
+
+        // producer owned
+        alignas(cCacheLineBytes) std::atomic<size_t> m_tail{0};
+        size_t m_headCache{0};
+        size_t m_highWater{0};
+        uint64_t m_rejected{0};
+
+        // wake up state
+        alignas(cCacheLineBytes) std::atomic<uint32_t> m_signal{0};
+        std::atomic<bool> m_parked{false};
+
+        alignas(cCacheLineBytes) size_t m_capacity;
+        size_t m_mask;
+        std::unique_ptr<std::atomic<T>[]> m_items;
+
+        static constexpr size_t cSpinCount = 4096;
+
+    public:
+        /*
+         * SpscQueue constructor.
+         *
+         * @param capacity Minimum number of items, rounded up to a power of two.
+         */
+        SpscQueue(size_t capacity) {
+            m_capacity = std::bit_ceil(std::max<size_t>(capacity, 2));
+            m_mask = m_capacity - 1;
+            m_items = std::make_unique<std::atomic<T>[]>(m_capacity);
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        /*
+         * Push an item, producer side only.
+         *
+         * @param item Item to push.
+         *
+         * @return true if pushed, false if queue is full.
+         */
+        bool Push(const T& item) noexcept {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+            if (tail - m_headCache >= m_capacity) {
+                m_headCache = m_head.load(std::memory_order_acquire);
+                if (tail - m_headCache >= m_capacity) {
+                    ++m_rejected;
+                    return false;
+                }
+            }
+
+            m_items[tail & m_mask].store(item, std::memory_order_relaxed);
+            m_tail.store(tail + 1, std::memory_order_release);
+
+            // head cache is only refreshed when the queue looks full, so read the real head here
+            const size_t depth = tail + 1 - m_head.load(std::memory_order_relaxed);
+            if (depth > m_highWater) {
+                m_highWater = depth;
+            }
+
+            // pairs with the fence in WaitPop, either the consumer sees the
+            // new tail or we see that it is parked
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_parked.load(std::memory_order_relaxed)) {
+                wake();
+            }
+            return true;
+        }
+
+        /*
+         * Pop an item without blocking, consumer side only.
+         *
+         * @param item Reference to store popped item.
+         *
+         * @return true if an item was popped, false if queue is empty.
+         */
+        bool TryPop(T& item) noexcept {
+            size_t head = m_head.load(std::memory_order_relaxed);
+
+            do {
+                // head can pass the cached tail when the producer steals items
+                if (head >= m_tailCache) {
+                    m_tailCache = m_tail.load(std::memory_order_acquire);
+                    if (head >= m_tailCache) {
+                        return false;
+                    }
+                }
+                item = m_items[head & m_mask].load(std::memory_order_relaxed);
+            } while (!m_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+            return true;
+        }
+
+        /*
+         * Take back the oldest item, producer side only.
+         *
+         * @param item Reference to store the oldest item.
+         *
+         * @return true if an item was taken, false if queue is empty.
+         */
+        bool TryStealOldest(T& item) noexcept {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t head = m_head.load(std::memory_order_acquire);
+
+            do {
+                if (head == tail) {
+                    return false;
+                }
+                item = m_items[head & m_mask].load(std::memory_order_relaxed);
+            } while (!m_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire));
+
+            return true;
+        }
+
+        /*
+         * Pop an item, spinning and then parking while the queue is empty,
+         * consumer side only.
+         *
+         * @param item Reference to store popped item.
+         * @param stop Predicate checked before parking, return true to give up waiting.
+         *
+         * @return true if an item was popped, false if stopped or interrupted.
+         */
+        template<typename P>
+        bool WaitPop(T& item, P&& stop) noexcept {
+            for (size_t i = 0; i < cSpinCount; ++i) {
+                if (TryPop(item)) {
+                    return true;
+                }
+                cpuRelax();
+            }
+
+            const uint32_t signal = m_signal.load(std::memory_order_acquire);
+            m_parked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (TryPop(item)) {
+                m_parked.store(false, std::memory_order_relaxed);
+                return true;
+            }
+
+            if (!stop()) {
+                m_signal.wait(signal, std::memory_order_acquire);
+            }
+            m_parked.store(false, std::memory_order_relaxed);
+
+            return TryPop(item);
+        }
+
+        /*
+         * Wakes a parked consumer, used to make it re-check its stop condition.
+         */
+        void Interrupt() noexcept {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            wake();
+        }
+
+        /*
+         * Number of items in the queue.
+         *
+         * @return size_t Current queue depth.
+         */
+        size_t Size() const noexcept {
+            const size_t tail = m_tail.load(std::memory_order_acquire);
+            const size_t head = m_head.load(std::memory_order_acquire);
+            return (tail > head) ? tail - head : 0;
+        }
+
+        /*
+         * Check if queue is empty.
+         *
+         * @return true if empty, false otherwise.
+         */
+        bool Empty() const noexcept {
+            return Size() == 0;
+        }
+
+        /*
+         * Queue capacity.
+         *
+         * @return size_t Maximum number of items the queue can hold.
+         */
+        size_t Capacity() const noexcept {
+            return m_capacity;
+        }
+
+        /*
+         * Queue occupancy counters, the producer side counters are only
+         * approximate when read from another thread while running.
+         *
+         * @return QueueStats Current occupancy counters.
+         */
+        QueueStats Stats() const noexcept {
+            return QueueStats {
+                .depth = Size(),
+                .capacity = m_capacity,
+                .highWater = m_highWater,
+                .pushed = m_tail.load(std::memory_order_acquire),
+                .rejected = m_rejected,
+            };
+        }
+
+        /*
+         * Resets high water mark and rejected count, producer side only or while stopped.
+         */
+        void ResetStats() noexcept {
+            m_highWater = Size();
+            m_rejected = 0;
+        }
+
+    private:
+        /*
+         * Bumps signal and wakes parked consumer.
+         */
+        void wake() noexcept {
+            m_signal.fetch_add(1, std::memory_order_release);
+            m_signal.notify_one();
+        }
+};
+
+#endif //SPSC_QUEUE_H
@@ -0,0 +1,237 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  TaskApplyLinear16.h
+ * 
+ * Definition of ApplyLinear16 task class.
+ *********************************************************************/
+#ifndef TASK_APPLYLINEAR16_H
+#define TASK_APPLYLINEAR16_H
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+
+#include <Simd.h>
+
+
+/*
+* Parallel linear contrast scaling task.
+*
+* Maps each pixel to clamp(x - min, 0, max - min) * scale, rounded, in a single
+* pass with no lookup table, scale maps max to the largest 8 or 16 bit output
+* value. Use TaskFrameLut16/TaskApplyLut16 for non-linear curves.
+*/
+class TaskApplyLinear16 {
+    private:
+        // pixels per vector step, parts are split on multiples of it
+        static constexpr size_t cStep = 32;
+
+        std::mutex m_lock;
+        const uint16_t* m_data{nullptr};
+        uint8_t* m_out8{nullptr};
+        uint16_t* m_out16{nullptr};
+        size_t m_size{0};
+        uint16_t m_min{0}, m_range{1};
+        float m_scale{1.0f};
+
+    public:
+        /*
+         * Parallel linear scaling class constructor.
+         */
+        TaskApplyLinear16() { };
+
+        /*
+         * Parallel linear scaling class destructor.
+         */
+        ~TaskApplyLinear16() = default;
+
+        /*
+         * Setup parallel linear scaling task with 16 bit output.
+         *
+         * @param data Source image data.
+         * @param out Output image data location.
+         * @param size Number of pixels.
+         * @param min Pixel value mapped to 0.
+         * @param max Pixel value mapped to 65535.
+         */
+        void Setup(const uint16_t* data, uint16_t* out, size_t size, uint32_t min, uint32_t max) {
+            std::unique_lock<std::mutex> lock(m_lock);
+            setup(data, size, min, max, 65535.0f);
+            m_out16 = out;
+            m_out8 = nullptr;
+        }
+
+        /*
+         * Setup parallel linear scaling task with 8 bit output.
+         *
+         * @param data Source image data.
+         * @param out Output image data location.
+         * @param size Number of pixels.
+         * @param min Pixel value mapped to 0.
+         * @param max Pixel value mapped to 255.
+         */
+        void Setup(const uint16_t* data, uint8_t* out, size_t size, uint32_t min, uint32_t max) {
+            std::unique_lock<std::mutex> lock(m_lock);
+            setup(data, size, min, max, 255.0f);
+            m_out8 = out;
+            m_out16 = nullptr;
+        }
+
+        /*
+         * Run task.
+         *
+         * @param threadCount The number of threads running in parallel.
+         * @param taskNum The id of this task.
+         */
+        void Run(uint8_t threadCount, uint8_t taskNum) {
+            const size_t steps = m_size / cStep;
+            const size_t chunk = steps / threadCount;
+            const size_t start = taskNum * chunk * cStep;
+            const size_t end = (taskNum == threadCount - 1) ? m_size : start + chunk * cStep;
+
+            if (m_out8) {
+                scale8(start, end);
+            } else if (m_out16) {
+                scale16(start, end);
+            }
+        }
+
+    private:
+        void setup(const uint16_t* data, size_t size, uint32_t min, uint32_t max, float outMax) {
+            min = std::min<uint32_t>(min, 65535);
+            max = std::clamp<uint32_t>(max, min, 65535);
+
+            m_data = data;
+            m_size = size;
+            m_min = static_cast<uint16_t>(min);
+            // min == max maps min to 0 and everything above it to outMax
+            m_range = static_cast<uint16_t>(std::max<uint32_t>(max - min, 1));
+            m_scale = outMax / m_range;
+        }
+
+        /*
+         * Scales pixels [start, end) without vector instructions.
+         *
+         * Parameters are copied to locals, the output may alias the members
+         * which would otherwise be reloaded for every pixel.
+         */
+        template<typename O>
+        void scaleScalar(O* out, size_t start, size_t end) const noexcept {
+            const uint16_t* data = m_data;
+            const uint32_t min = m_min, range = m_range;
+            const float scale = m_scale;
+
+            for (size_t i = start; i < end; i++) {
+                const uint32_t v = data[i];
+                const uint32_t d = std::min<uint32_t>((v > min) ? v - min : 0, range);
+                out[i] = static_cast<O>(static_cast<float>(d) * scale + 0.5f);
+            }
+        }
+
+#if defined(NAUTILAI_SIMD_AVX2)
+        /*
+         * Scales 16 pixels to 16 bit values in pixel order.
+         */
+        inline __m256i scale16x16(const uint16_t* px) const noexcept {
+            const __m256i v = _mm256_min_epu16(
+                _mm256_subs_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(px)), _mm256_set1_epi16(short(m_min))),
+                _mm256_set1_epi16(short(m_range)));
+
+            const __m256 vscale = _mm256_set1_ps(m_scale);
+            const __m256 vhalf = _mm256_set1_ps(0.5f);
+            const __m256i zero = _mm256_setzero_si256();
+
+            // unpack and pack stay within 128 bit lanes so the pixel order is kept
+            const __m256i lo = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_unpacklo_epi16(v, zero)), vscale), vhalf));
+            const __m256i hi = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_unpackhi_epi16(v, zero)), vscale), vhalf));
+            return _mm256_packus_epi32(lo, hi);
+        }
+#elif defined(NAUTILAI_SIMD_SSE2)
+        /*
+         * Scales 8 pixels to 16 bit values in pixel order.
+         */
+        inline __m128i scale16x8(const uint16_t* px) const noexcept {
+            __m128i v = _mm_subs_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(px)), _mm_set1_epi16(short(m_min)));
+#if defined(NAUTILAI_SIMD_SSE41)
+            v = _mm_min_epu16(v, _mm_set1_epi16(short(m_range)));
+#else
+            v = _mm_sub_epi16(v, _mm_subs_epu16(v, _mm_set1_epi16(short(m_range))));
+#endif
+
+            const __m128 vscale = _mm_set1_ps(m_scale);
+            const __m128 vhalf = _mm_set1_ps(0.5f);
+            const __m128i zero = _mm_setzero_si128();
+
+            const __m128i lo = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), vscale), vhalf));
+            const __m128i hi = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), vscale), vhalf));
+#if defined(NAUTILAI_SIMD_SSE41)
+            return _mm_packus_epi32(lo, hi);
+#else
+            // no unsigned 32 bit pack before SSE4.1, bias into the signed range and back
+            const __m128i bias = _mm_set1_epi32(32768);
+            const __m128i packed = _mm_packs_epi32(_mm_sub_epi32(lo, bias), _mm_sub_epi32(hi, bias));
+            return _mm_xor_si128(packed, _mm_set1_epi16(short(0x8000)));
+#endif
+        }
+#endif
+
+        /*
+         * Scales pixels [start, end) to 16 bit output.
+         */
+        void scale16(size_t start, size_t end) {
+            size_t i = start;
+#if defined(NAUTILAI_SIMD_AVX2)
+            for (; i + 16 <= end; i += 16) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(m_out16 + i), scale16x16(m_data + i));
+            }
+#elif defined(NAUTILAI_SIMD_SSE2)
+            for (; i + 8 <= end; i += 8) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(m_out16 + i), scale16x8(m_data + i));
+            }
+#endif
+            scaleScalar(m_out16, i, end);
+        }
+
+        /*
+         * Scales pixels [start, end) to 8 bit output.
+         */
+        void scale8(size_t start, size_t end) {
+            size_t i = start;
+#if defined(NAUTILAI_SIMD_AVX2)
+            for (; i + 32 <= end; i += 32) {
+                // packus interleaves the 128 bit lanes of both inputs, the permute restores pixel order
+                const __m256i v = _mm256_packus_epi16(scale16x16(m_data + i), scale16x16(m_data + i + 16));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(m_out8 + i), _mm256_permute4x64_epi64(v, 0xD8));
+            }
+#elif defined(NAUTILAI_SIMD_SSE2)
+            for (; i + 16 <= end; i += 16) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(m_out8 + i), _mm_packus_epi16(scale16x8(m_data + i), scale16x8(m_data + i + 8)));
+            }
+#endif
+            scaleScalar(m_out8, i, end);
+        }
+};
+#endif //TASK_APPLYLINEAR16_H
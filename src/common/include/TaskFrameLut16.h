@@ -31,6 +31,7 @@
 #ifndef TASK_FRAMELUT16_H
 #define TASK_FRAMELUT16_H
 
+#include <cmath>
 #include <mutex>
 #include <vector>
 #include <ranges>
@@ -38,14 +39,18 @@
 
 /*
 * Parallel LUT construction for frame image data.
+*
+* Builds a gamma curve between min and max, TaskApplyLinear16 scales
+* without a table and is faster for the linear (gamma 1) case.
 */
 class TaskFrameLut16 {
     private:
         std::mutex m_lock;
 
         uint16_t m_min, m_max;
-        uint16_t m_lut16[((1<<16) - 1)] = {0};
+        uint16_t m_lut16[1<<16] = {0};
         double m_scale;
+        double m_gamma{1.0};
 
     public:
         /*
@@ -63,11 +68,13 @@ class TaskFrameLut16 {
          *
          * @param min The min pixel value.
          * @param max The max pixel value.
+         * @param gamma Curve exponent applied to the normalised pixel value.
          */
-        void Setup(uint32_t min, uint32_t max) {
+        void Setup(uint32_t min, uint32_t max, double gamma = 1.0) {
             std::unique_lock<std::mutex> lock(m_lock);
             m_min = min; m_max = max;
-            m_scale = (max == min) ? 65535.0 : 65535.0 / static_cast<double>(max-min);
+            m_scale = (max == min) ? 1.0 : 1.0 / static_cast<double>(max-min);
+            m_gamma = gamma;
         };
 
         /*
@@ -88,22 +95,25 @@ class TaskFrameLut16 {
          */
         void Run(uint8_t threadCount, uint8_t taskNum) {
             size_t rem = 0;
-            size_t chunkSize = ((1<<16) - 1) / threadCount;
+            size_t chunkSize = (1<<16) / threadCount;
 
             if (taskNum == threadCount - 1) {
-                rem = ((1<<16) - 1) % threadCount;
+                rem = (1<<16) % threadCount;
             }
 
             size_t start = taskNum * chunkSize;
             size_t end = start + chunkSize+rem;
 
-            for (size_t i = start; i <= end; i++) {
+            for (size_t i = start; i < end; i++) {
                 if (i < m_min) {
                     m_lut16[i] = 0;
                 } else if (i > m_max) {
                     m_lut16[i] = 65535;
                 } else {
-                    double value = static_cast<double>(m_scale * (i - m_min));
+                    double t = m_scale * (i - m_min);
+                    if (m_gamma != 1.0) { t = std::pow(t, m_gamma); }
+
+                    double value = std::min(65535.0 * t, 65535.0);
                     m_lut16[i] = static_cast<uint16_t>(value);
                 }
             }
@@ -30,46 +30,93 @@
 #ifndef TASK_FRAMESTATS_H
 #define TASK_FRAMESTATS_H
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <mutex>
 #include <vector>
-#include <ranges>
-#include <stdlib.h>
+
+#include <Simd.h>
+#include <SpscQueue.h> // cpuRelax
 
 
 /*
 * Parallel frame histogram/stats processing.
+*
+* Runs as 2 * numTasks parts (see Parts). The first numTasks parts each scan
+* a band of rows into their own interleaved sub-histograms, the remaining
+* parts each sum one slice of bins across all sub-histograms into the output
+* histogram once every scan part has finished, so no part ever takes a lock.
 */
 class TaskFrameStats {
     private:
+        // pixels per block, min/max of a block decides if its values need clamping
+        static constexpr size_t cBlockPixels = 4096;
+
+        // vector min/max per block, scalar builds take min/max from the histogram instead
+#if defined(NAUTILAI_SIMD_SSE41)
+        static constexpr bool cVectorMinMax = true;
+#else
+        static constexpr bool cVectorMinMax = false;
+#endif
+
         std::mutex m_lock;
 
         uint8_t m_bytes_per_pixel;
         uint32_t m_width, m_height;
+        uint32_t m_bins{0};
+        uint32_t m_subHists{1};
         uint32_t m_min, m_max;
         uint32_t m_hmax;
         uint32_t* m_hist{nullptr};
         const uint8_t* m_data;
 
-        std::vector<uint32_t*> m_taskHists{};
+        uint8_t m_numTasks{1};
+        std::vector<std::vector<uint32_t>> m_taskHists{};
+        std::vector<uint32_t> m_taskMin{};
+        std::vector<uint32_t> m_taskMax{};
+        std::vector<uint32_t> m_sliceMax{};
+
+        std::atomic<uint32_t> m_scanned{0};
+        std::atomic<uint32_t> m_merged{0};
 
     public:
         /*
          * Parallel frame processing class constructor.
+         *
+         * @param numTasks Number of row bands the frame is scanned in.
          */
         TaskFrameStats(uint8_t numTasks) {
             m_width = m_height = 0;
             m_data = nullptr;
+            m_numTasks = std::clamp<uint8_t>(numTasks, 1, 127);
 
-            for (size_t i = 0; i < numTasks; i++) {
-                m_taskHists.push_back(new uint32_t[(1<<16)-1]);
-            }
+            m_taskHists.resize(m_numTasks);
+            m_taskMin.resize(m_numTasks);
+            m_taskMax.resize(m_numTasks);
+            m_sliceMax.resize(m_numTasks);
         };
 
         /*
          * Parallel frame processing class destructor.
          */
-        ~TaskFrameStats() {
-            for (auto& h : m_taskHists) { delete h; }
+        ~TaskFrameStats() = default;
+
+        /*
+         * Number of parts ParTask runs this task as, scan parts then merge parts.
+         */
+        uint8_t Parts() const noexcept {
+            return 2 * m_numTasks;
+        }
+
+        /*
+         * Number of histogram bins for the current setup.
+         */
+        uint32_t Bins() const noexcept {
+            return m_bins;
         }
 
         /*
@@ -87,21 +134,37 @@ class TaskFrameStats {
          * Setup parallel lut processing task.
          *
          * @param data Source image data.
-         * @param hist Histogram output.
+         * @param hist Histogram output, at least 1 << bitDepth entries.
          * @param width Image width.
          * @param height Image height.
+         * @param bytes_per_pixel Bytes per pixel, 1 or 2.
+         * @param bitDepth Sensor bit depth, sets the number of bins. 0 for 8 * bytes_per_pixel,
+         *                 larger pixel values are counted in the last bin.
          */
-        void Setup(const uint8_t* data, uint32_t* hist, uint32_t width, uint32_t height, uint8_t bytes_per_pixel) {
+        void Setup(const uint8_t* data, uint32_t* hist, uint32_t width, uint32_t height, uint8_t bytes_per_pixel, uint8_t bitDepth = 0) {
             std::unique_lock<std::mutex> lock(m_lock);
-            m_min = (1 << 16) - 1; m_max = 0; m_hmax = 0;
+            if (bitDepth == 0 || bitDepth > 8 * bytes_per_pixel) {
+                bitDepth = 8 * bytes_per_pixel;
+            }
+
+            m_bins = uint32_t(1) << bitDepth;
+            // interleaved sub-histograms keep runs of equal pixels from serialising on one counter,
+            // at 16 bits they would no longer fit in cache
+            m_subHists = (m_bins <= 4096) ? 4 : 1;
 
+            m_min = m_bins - 1; m_max = 0; m_hmax = 0;
             m_hist = hist;
-            memset((void*)m_hist, 0, sizeof(uint32_t)*((1<<16)-1));
 
             m_width = width;
             m_height = height;
             m_bytes_per_pixel = bytes_per_pixel;
             m_data = data;
+
+            for (auto& h : m_taskHists) {
+                h.resize(size_t(m_subHists) * m_bins);
+            }
+            m_scanned = 0;
+            m_merged = 0;
         };
 
         /*
@@ -111,48 +174,250 @@ class TaskFrameStats {
          * @param taskNum The id of this task.
          */
         void Run(uint8_t threadCount, uint8_t taskNum) {
-            //uint32_t hist[((1<<16) - 1)] = {0};
-            uint32_t* hist = m_taskHists[taskNum];
-            memset((void*)hist, 0, sizeof(uint32_t)*((1<<16)-1));
+            assert(threadCount == Parts());
+            (void)threadCount;
+
+            if (taskNum < m_numTasks) {
+                scan(taskNum);
+            } else {
+                merge(taskNum - m_numTasks);
+            }
+        }
+
+    private:
+        /*
+         * Histogram and min/max of one band of rows.
+         *
+         * @param band Band index.
+         */
+        void scan(uint8_t band) {
+            std::vector<uint32_t>& hist = m_taskHists[band];
+            std::fill(hist.begin(), hist.end(), 0);
 
-            uint16_t min = (1 << 16) - 1;
-            uint16_t max = 0;
-            size_t rem = 0;
+            const size_t rows = m_height / m_numTasks;
+            const size_t rem = (band == m_numTasks - 1) ? m_height % m_numTasks : 0;
+            const size_t offset = band * rows * m_width;
+            const size_t count = (rows + rem) * m_width;
 
-            if (taskNum == threadCount - 1) {
-                rem = m_height % threadCount;
+            uint32_t min = m_bins - 1, max = 0;
+            if (m_bytes_per_pixel == 1) {
+                scanPixels(m_data + offset, count, hist.data(), min, max);
+            } else {
+                scanPixels(reinterpret_cast<const uint16_t*>(m_data) + offset, count, hist.data(), min, max);
             }
+            m_taskMin[band] = min;
+            m_taskMax[band] = max;
 
-            const size_t rows = (m_height / threadCount);
-            const size_t rowOffset = taskNum * rows;
-            const size_t offset = rowOffset * m_width;
-            const size_t limit = (rows + rem) * m_width;
+            if (m_scanned.fetch_add(1, std::memory_order_acq_rel) + 1 == m_numTasks) {
+                m_scanned.notify_all();
+            }
+        }
 
-            for (size_t i = 0; i < limit; i++) {
-                uint16_t e = 0;
+        /*
+         * Sums one slice of bins over every band once all bands are scanned.
+         *
+         * Merge parts are claimed after every scan part, so the scan parts are all
+         * running or finished and the wait always ends.
+         *
+         * @param slice Slice index.
+         */
+        void merge(uint8_t slice) {
+            uint32_t scanned = m_scanned.load(std::memory_order_acquire);
+            for (uint32_t spin = 0; scanned < m_numTasks && spin < 2048; spin++) {
+                cpuRelax();
+                scanned = m_scanned.load(std::memory_order_acquire);
+            }
+            while (scanned < m_numTasks) {
+                m_scanned.wait(scanned, std::memory_order_acquire);
+                scanned = m_scanned.load(std::memory_order_acquire);
+            }
+
+            const size_t begin = size_t(m_bins) * slice / m_numTasks;
+            const size_t end = size_t(m_bins) * (slice + 1) / m_numTasks;
 
-                if (m_bytes_per_pixel == 1) {
-                    e = m_data[offset + i];
+            uint32_t hmax = 0;
+            for (size_t b = begin; b < end; b++) {
+                uint32_t sum = 0;
+                for (const auto& h : m_taskHists) {
+                    for (uint32_t s = 0; s < m_subHists; s++) {
+                        sum += h[size_t(s) * m_bins + b];
+                    }
+                }
+                m_hist[b] = sum;
+                hmax = std::max(hmax, sum);
+            }
+            m_sliceMax[slice] = hmax;
+
+            // the last slice to finish publishes the frame results
+            if (m_merged.fetch_add(1, std::memory_order_acq_rel) + 1 == m_numTasks) {
+                if constexpr (cVectorMinMax) {
+                    m_min = *std::min_element(m_taskMin.begin(), m_taskMin.end());
+                    m_max = *std::max_element(m_taskMax.begin(), m_taskMax.end());
                 } else {
-                    e = ((uint16_t*)m_data)[offset + i];
+                    const uint32_t* first = std::find_if(m_hist, m_hist + m_bins, [](uint32_t c) { return c != 0; });
+                    const uint32_t* last = std::find_if(std::make_reverse_iterator(m_hist + m_bins), std::make_reverse_iterator(m_hist), [](uint32_t c) { return c != 0; }).base();
+                    m_min = (first == m_hist + m_bins) ? 0 : uint32_t(first - m_hist);
+                    m_max = (last == m_hist) ? 0 : uint32_t(last - m_hist - 1);
                 }
+                m_hmax = *std::max_element(m_sliceMax.begin(), m_sliceMax.end());
+            }
+        }
 
-                if (e > max) { max = e; }
-                if (e < min) { min = e; }
+        /*
+         * Histogram and min/max of count pixels, one block at a time so the
+         * histogram pass reads the block from cache after the min/max pass.
+         */
+        template<typename P>
+        void scanPixels(const P* px, size_t count, uint32_t* hist, uint32_t& min, uint32_t& max) const {
+            const uint32_t top = m_bins - 1;
 
-                hist[e] += 1;
+            if constexpr (!cVectorMinMax) {
+                // a scalar min/max pass costs more than clamping every pixel, min/max come from the merged histogram
+                histogram<true>(px, count, hist, top);
+                return;
             }
 
-            {
-                std::unique_lock<std::mutex> lock(m_lock);
-                if (min < m_min) { m_min = min; }
-                if (max > m_max) { m_max = max; }
+            for (size_t i = 0; i < count; i += cBlockPixels) {
+                const size_t n = std::min(cBlockPixels, count - i);
+                uint32_t bmin, bmax;
+                minMax(px + i, n, bmin, bmax);
 
-                for (size_t i=0; i < ((1<<16) - 1); i++) {
-                    m_hist[i] += hist[i];
-                    if (m_hist[i] > m_hmax) { m_hmax = m_hist[i]; }
+                min = std::min(min, std::min(bmin, top));
+                max = std::max(max, std::min(bmax, top));
+
+                if (bmax > top) {
+                    histogram<true>(px + i, n, hist, top);
+                } else {
+                    histogram<false>(px + i, n, hist, top);
                 }
             }
         }
+
+        /*
+         * Counts pixels into m_subHists interleaved sub-histograms.
+         *
+         * @tparam CLAMP Clamp pixel values to top.
+         */
+        template<bool CLAMP, typename P>
+        void histogram(const P* px, size_t n, uint32_t* hist, uint32_t top) const {
+            auto bin = [top](P v) -> uint32_t {
+                if constexpr (CLAMP) {
+                    return std::min<uint32_t>(v, top);
+                } else {
+                    (void)top;
+                    return v;
+                }
+            };
+
+            size_t i = 0;
+            if (m_subHists == 4) {
+                uint32_t* h0 = hist;
+                uint32_t* h1 = hist + m_bins;
+                uint32_t* h2 = hist + 2 * m_bins;
+                uint32_t* h3 = hist + 3 * m_bins;
+                for (; i + 4 <= n; i += 4) {
+                    h0[bin(px[i])]++;
+                    h1[bin(px[i + 1])]++;
+                    h2[bin(px[i + 2])]++;
+                    h3[bin(px[i + 3])]++;
+                }
+            }
+            for (; i < n; i++) {
+                hist[bin(px[i])]++;
+            }
+        }
+
+        /*
+         * Vector min/max of 8 bit pixels.
+         */
+        static void minMax(const uint8_t* px, size_t n, uint32_t& min, uint32_t& max) {
+            uint8_t lo = 0xff, hi = 0;
+            size_t i = 0;
+#if defined(NAUTILAI_SIMD_AVX2)
+            __m256i vmin = _mm256_set1_epi8(char(0xff));
+            __m256i vmax = _mm256_setzero_si256();
+            for (; i + 32 <= n; i += 32) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(px + i));
+                vmin = _mm256_min_epu8(vmin, v);
+                vmax = _mm256_max_epu8(vmax, v);
+            }
+            __m128i smin = _mm_min_epu8(_mm256_castsi256_si128(vmin), _mm256_extracti128_si256(vmin, 1));
+            __m128i smax = _mm_max_epu8(_mm256_castsi256_si128(vmax), _mm256_extracti128_si256(vmax, 1));
+            reduce8(smin, smax, lo, hi);
+#elif defined(NAUTILAI_SIMD_SSE41)
+            __m128i smin = _mm_set1_epi8(char(0xff));
+            __m128i smax = _mm_setzero_si128();
+            for (; i + 16 <= n; i += 16) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + i));
+                smin = _mm_min_epu8(smin, v);
+                smax = _mm_max_epu8(smax, v);
+            }
+            reduce8(smin, smax, lo, hi);
+#endif
+            for (; i < n; i++) {
+                lo = std::min(lo, px[i]);
+                hi = std::max(hi, px[i]);
+            }
+            min = lo; max = hi;
+        }
+
+        /*
+         * Vector min/max of 16 bit pixels.
+         */
+        static void minMax(const uint16_t* px, size_t n, uint32_t& min, uint32_t& max) {
+            uint16_t lo = 0xffff, hi = 0;
+            size_t i = 0;
+#if defined(NAUTILAI_SIMD_AVX2)
+            __m256i vmin = _mm256_set1_epi16(short(0xffff));
+            __m256i vmax = _mm256_setzero_si256();
+            for (; i + 16 <= n; i += 16) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(px + i));
+                vmin = _mm256_min_epu16(vmin, v);
+                vmax = _mm256_max_epu16(vmax, v);
+            }
+            __m128i smin = _mm_min_epu16(_mm256_castsi256_si128(vmin), _mm256_extracti128_si256(vmin, 1));
+            __m128i smax = _mm_max_epu16(_mm256_castsi256_si128(vmax), _mm256_extracti128_si256(vmax, 1));
+            reduce16(smin, smax, lo, hi);
+#elif defined(NAUTILAI_SIMD_SSE41)
+            __m128i smin = _mm_set1_epi16(short(0xffff));
+            __m128i smax = _mm_setzero_si128();
+            for (; i + 8 <= n; i += 8) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + i));
+                smin = _mm_min_epu16(smin, v);
+                smax = _mm_max_epu16(smax, v);
+            }
+            reduce16(smin, smax, lo, hi);
+#endif
+            for (; i < n; i++) {
+                lo = std::min(lo, px[i]);
+                hi = std::max(hi, px[i]);
+            }
+            min = lo; max = hi;
+        }
+
+#if defined(NAUTILAI_SIMD_SSE41)
+        /*
+         * Horizontal min/max of 16 unsigned 8 bit lanes.
+         */
+        static void reduce8(__m128i smin, __m128i smax, uint8_t& lo, uint8_t& hi) {
+            // widen to 16 bit lanes so minpos can find the minimum, max is the min of the complement
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i ones = _mm_set1_epi8(char(0xff));
+            const __m128i min16 = _mm_min_epu16(_mm_unpacklo_epi8(smin, zero), _mm_unpackhi_epi8(smin, zero));
+            const __m128i inv = _mm_xor_si128(smax, ones);
+            const __m128i max16 = _mm_min_epu16(_mm_unpacklo_epi8(inv, zero), _mm_unpackhi_epi8(inv, zero));
+            lo = uint8_t(_mm_cvtsi128_si32(_mm_minpos_epu16(min16)));
+            hi = uint8_t(0xff - _mm_cvtsi128_si32(_mm_minpos_epu16(max16)));
+        }
+
+        /*
+         * Horizontal min/max of 8 unsigned 16 bit lanes.
+         */
+        static void reduce16(__m128i smin, __m128i smax, uint16_t& lo, uint16_t& hi) {
+            const __m128i inv = _mm_xor_si128(smax, _mm_set1_epi16(short(0xffff)));
+            lo = uint16_t(_mm_cvtsi128_si32(_mm_minpos_epu16(smin)));
+            hi = uint16_t(0xffff - (_mm_cvtsi128_si32(_mm_minpos_epu16(inv)) & 0xffff));
+        }
+#endif
 };
 #endif //TASK_FRAMESTATS_H
@@ -0,0 +1,348 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/*********************************************************************
+ * @file  TaskTileMosaic.h
+ * 
+ * Definition of TileMosaic task class.
+ *********************************************************************/
+#ifndef TASK_TILEMOSAIC_H
+#define TASK_TILEMOSAIC_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <Simd.h>
+
+
+/*
+* Parallel tile stitching task.
+*
+* Places rows*cols tile frames into one mosaic frame, applying the vertical
+* and horizontal flips at pixel granularity, and optionally bins the mosaic
+* into a second frame in the same pass. Parts are bands of mosaic rows, each
+* band of binFactor rows is binned while it is still in cache, so a tile pixel
+* is read once and written once to each output. Only disabled tiles are zeroed.
+*/
+class TaskTileMosaic {
+    private:
+        std::mutex m_lock;
+        std::vector<const uint8_t*> m_tiles;
+        uint32_t m_tileWidth{0}, m_tileHeight{0};
+        uint32_t m_rows{0}, m_cols{0};
+        uint8_t m_bytesPerPixel{2};
+        bool m_vflip{false}, m_hflip{false};
+        uint8_t* m_mosaic{nullptr};
+        uint8_t* m_binned{nullptr};
+        uint8_t m_binFactor{1};
+
+    public:
+        /*
+         * Parallel tile stitching class constructor.
+         */
+        TaskTileMosaic() { };
+
+        /*
+         * Parallel tile stitching class destructor.
+         */
+        ~TaskTileMosaic() = default;
+
+        /*
+         * Setup parallel tile stitching task.
+         *
+         * @param tiles Frame data of each tile in mosaic order (col + row * cols), nullptr for disabled tiles.
+         * @param tileWidth Tile width in pixels.
+         * @param tileHeight Tile height in pixels.
+         * @param rows Number of tile rows.
+         * @param cols Number of tile columns.
+         * @param bytesPerPixel Bytes per pixel, 1 or 2.
+         * @param vflip Flip each tile vertically.
+         * @param hflip Flip each tile horizontally.
+         * @param mosaic Output mosaic of (cols * tileWidth) x (rows * tileHeight) pixels.
+         * @param binned Optional output, mosaic binned by binFactor, remainder rows and columns are dropped.
+         * @param binFactor Bin factor of the binned output.
+         */
+        void Setup(
+            const std::vector<const uint8_t*>& tiles,
+            uint32_t tileWidth,
+            uint32_t tileHeight,
+            uint32_t rows,
+            uint32_t cols,
+            uint8_t bytesPerPixel,
+            bool vflip,
+            bool hflip,
+            uint8_t* mosaic,
+            uint8_t* binned = nullptr,
+            uint8_t binFactor = 1)
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_tiles = tiles;
+            m_tiles.resize(size_t(rows) * cols, nullptr);
+            m_tileWidth = tileWidth;
+            m_tileHeight = tileHeight;
+            m_rows = rows;
+            m_cols = cols;
+            m_bytesPerPixel = (bytesPerPixel == 1) ? 1 : 2;
+            m_vflip = vflip;
+            m_hflip = hflip;
+            m_mosaic = mosaic;
+            m_binFactor = std::max<uint8_t>(binFactor, 1);
+            m_binned = (binned && m_binFactor > 1) ? binned : nullptr;
+        }
+
+        /*
+         * Run task.
+         *
+         * @param threadCount The number of threads running in parallel.
+         * @param taskNum The id of this task.
+         */
+        void Run(uint8_t threadCount, uint8_t taskNum) {
+            if (m_bytesPerPixel == 1) {
+                run<uint8_t>(threadCount, taskNum);
+            } else {
+                run<uint16_t>(threadCount, taskNum);
+            }
+        }
+
+        /*
+         * Copies n pixels from src to dst in reverse order.
+         */
+        static void ReverseCopy(uint16_t* dst, const uint16_t* src, size_t n) noexcept {
+            size_t i = 0;
+#if defined(NAUTILAI_SIMD_AVX2)
+            const __m256i mask = _mm256_setr_epi8(
+                14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1,
+                14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+            for (; i + 16 <= n; i += 16) {
+                // reverse within each 128 bit lane then swap the lanes
+                const __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + n - i - 16)), mask);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(v, 0x4E));
+            }
+#elif defined(NAUTILAI_SIMD_SSE2)
+            for (; i + 8 <= n; i += 8) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n - i - 8));
+                v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0x1B), 0x1B);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi32(v, 0x4E));
+            }
+#endif
+            for (; i < n; i++) {
+                dst[i] = src[n - i - 1];
+            }
+        }
+
+        /*
+         * Copies n pixels from src to dst in reverse order.
+         */
+        static void ReverseCopy(uint8_t* dst, const uint8_t* src, size_t n) noexcept {
+            size_t i = 0;
+#if defined(NAUTILAI_SIMD_AVX2)
+            const __m256i mask = _mm256_setr_epi8(
+                15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            for (; i + 32 <= n; i += 32) {
+                const __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + n - i - 32)), mask);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(v, 0x4E));
+            }
+#elif defined(NAUTILAI_SIMD_SSE41)
+            const __m128i mask = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            for (; i + 16 <= n; i += 16) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n - i - 16));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(v, mask));
+            }
+#elif defined(NAUTILAI_SIMD_SSE2)
+            for (; i + 16 <= n; i += 16) {
+                // swap the bytes of each 16 bit word, then reverse the words
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n - i - 16));
+                v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+                v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0x1B), 0x1B);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi32(v, 0x4E));
+            }
+#endif
+            for (; i < n; i++) {
+                dst[i] = src[n - i - 1];
+            }
+        }
+
+    private:
+        /*
+         * Adds a row of n pixels to per column sums.
+         */
+        static void accumulate(uint32_t* sums, const uint16_t* row, size_t n) noexcept {
+            size_t i = 0;
+#if defined(NAUTILAI_SIMD_AVX2)
+            for (; i + 16 <= n; i += 16) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+                __m256i* s = reinterpret_cast<__m256i*>(sums + i);
+                _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v))));
+                _mm256_storeu_si256(s + 1, _mm256_add_epi32(_mm256_loadu_si256(s + 1), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1))));
+            }
+#elif defined(NAUTILAI_SIMD_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 8 <= n; i += 8) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+                __m128i* s = reinterpret_cast<__m128i*>(sums + i);
+                _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_unpacklo_epi16(v, zero)));
+                _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), _mm_unpackhi_epi16(v, zero)));
+            }
+#endif
+            for (; i < n; i++) {
+                sums[i] += row[i];
+            }
+        }
+
+        /*
+         * Adds a row of n pixels to per column sums.
+         */
+        static void accumulate(uint32_t* sums, const uint8_t* row, size_t n) noexcept {
+            size_t i = 0;
+#if defined(NAUTILAI_SIMD_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 16 <= n; i += 16) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+                const __m128i w[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+                __m128i* s = reinterpret_cast<__m128i*>(sums + i);
+                for (int h = 0; h < 2; h++, s += 2) {
+                    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_unpacklo_epi16(w[h], zero)));
+                    _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), _mm_unpackhi_epi16(w[h], zero)));
+                }
+            }
+#endif
+            for (; i < n; i++) {
+                sums[i] += row[i];
+            }
+        }
+
+        /*
+         * Bins n pairs of 2 row column sums, out[j] = (s[2j] + s[2j+1]) / 4.
+         */
+        template<typename T>
+        static void bin2(T* out, const uint32_t* s, size_t n) noexcept {
+            size_t j = 0;
+#if defined(NAUTILAI_SIMD_SSE2)
+            if constexpr (sizeof(T) == 2) {
+                for (; j + 8 <= n; j += 8, s += 16) {
+                    __m128i q[2];
+                    for (int h = 0; h < 2; h++) {
+                        // split even and odd columns and add them
+                        const __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 8*h)));
+                        const __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 8*h + 4)));
+                        q[h] = _mm_srli_epi32(_mm_add_epi32(
+                            _mm_castps_si128(_mm_shuffle_ps(a, b, 0x88)),
+                            _mm_castps_si128(_mm_shuffle_ps(a, b, 0xDD))), 2);
+                    }
+#if defined(NAUTILAI_SIMD_SSE41)
+                    const __m128i packed = _mm_packus_epi32(q[0], q[1]);
+#else
+                    // no unsigned 32 bit pack before SSE4.1, bias into the signed range and back
+                    const __m128i bias = _mm_set1_epi32(32768);
+                    const __m128i packed = _mm_xor_si128(
+                        _mm_packs_epi32(_mm_sub_epi32(q[0], bias), _mm_sub_epi32(q[1], bias)), _mm_set1_epi16(short(0x8000)));
+#endif
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), packed);
+                }
+            }
+#endif
+            for (; j < n; j++, s += 2) {
+                out[j] = static_cast<T>((s[0] + s[1]) >> 2);
+            }
+        }
+
+        /*
+         * Writes mosaic row y from the tiles.
+         */
+        template<typename T>
+        void writeRow(uint32_t y) const noexcept {
+            const uint32_t tileRow = y / m_tileHeight;
+            const uint32_t ty = y % m_tileHeight;
+            const size_t srcRow = m_vflip ? (m_tileHeight - ty - 1) : ty;
+            T* dst = reinterpret_cast<T*>(m_mosaic) + size_t(y) * m_cols * m_tileWidth;
+
+            for (uint32_t col = 0; col < m_cols; col++, dst += m_tileWidth) {
+                const T* tile = reinterpret_cast<const T*>(m_tiles[col + tileRow * m_cols]);
+                if (tile == nullptr) {
+                    std::memset(dst, 0, sizeof(T) * m_tileWidth);
+                } else if (m_hflip) {
+                    ReverseCopy(dst, tile + srcRow * m_tileWidth, m_tileWidth);
+                } else {
+                    std::memcpy(dst, tile + srcRow * m_tileWidth, sizeof(T) * m_tileWidth);
+                }
+            }
+        }
+
+        template<typename T>
+        void run(uint8_t threadCount, uint8_t taskNum) {
+            const size_t width = size_t(m_cols) * m_tileWidth;
+            const uint32_t height = m_rows * m_tileHeight;
+            const uint32_t band = m_binned ? m_binFactor : 1;
+            const uint32_t bands = height / band;
+
+            const uint32_t first = uint32_t(uint64_t(bands) * taskNum / threadCount);
+            const uint32_t last = uint32_t(uint64_t(bands) * (taskNum + 1) / threadCount);
+
+            if (m_binned == nullptr) {
+                for (uint32_t y = first; y < last; y++) {
+                    writeRow<T>(y);
+                }
+                return;
+            }
+
+            const size_t binnedWidth = width / band;
+            // sum / area rounded down, the half keeps exact multiples off the rounding edge
+            const double invArea = 1.0 / (double(band) * band);
+            thread_local std::vector<uint32_t> sums;
+            sums.resize(width);
+
+            for (uint32_t b = first; b < last; b++) {
+                std::fill(sums.begin(), sums.end(), 0);
+                for (uint32_t y = b * band; y < (b + 1) * band; y++) {
+                    writeRow<T>(y);
+                    accumulate(sums.data(), reinterpret_cast<const T*>(m_mosaic) + y * width, width);
+                }
+
+                T* out = reinterpret_cast<T*>(m_binned) + size_t(b) * binnedWidth;
+                const uint32_t* s = sums.data();
+                if (band == 2) {
+                    bin2(out, s, binnedWidth);
+                } else {
+                    for (size_t j = 0; j < binnedWidth; j++, s += band) {
+                        uint32_t sum = 0;
+                        for (uint32_t k = 0; k < band; k++) {
+                            sum += s[k];
+                        }
+                        out[j] = static_cast<T>((double(sum) + 0.5) * invArea);
+                    }
+                }
+            }
+
+            // rows below the last whole band are only in the mosaic
+            if (taskNum == threadCount - 1) {
+                for (uint32_t y = bands * band; y < height; y++) {
+                    writeRow<T>(y);
+                }
+            }
+        }
+};
+#endif //TASK_TILEMOSAIC_H
@@ -0,0 +1,232 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  Telemetry.h
+ * 
+ * Definition of the acquisition telemetry counters.
+ *********************************************************************/
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+* Host timestamp used to measure pipeline latencies.
+*
+* @return Monotonic time in nanoseconds.
+*/
+inline uint64_t telemetryNowNS() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+* Latency percentiles.
+*/
+struct LatencySummary {
+    uint64_t count{0};
+    uint64_t p50NS{0};
+    uint64_t p99NS{0};
+    uint64_t maxNS{0};
+};
+
+/*
+* Lock free log-linear latency histogram.
+*
+* Values are binned by power of two with 8 linear sub-bins each, so
+* percentiles are accurate to ~12.5% over the full uint64_t range.
+*/
+class LatencyHistogram {
+    private:
+        static constexpr uint32_t cSubBits = 3;
+        static constexpr uint32_t cSubBins = 1 << cSubBits;
+        static constexpr uint32_t cBins = (64 - cSubBits + 1) * cSubBins;
+
+        std::atomic<uint64_t> m_bins[cBins]{};
+        std::atomic<uint64_t> m_count{0};
+        std::atomic<uint64_t> m_max{0};
+
+    public:
+        /*
+        * Records one latency value, safe to call from multiple threads.
+        *
+        * @param ns Latency in nanoseconds.
+        */
+        void Record(uint64_t ns) noexcept {
+            m_bins[binIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+
+            uint64_t max = m_max.load(std::memory_order_relaxed);
+            while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+        }
+
+        /*
+        * Records the time elapsed since startNS.
+        *
+        * @param startNS Start time from telemetryNowNS, ignored if 0.
+        */
+        void RecordSince(uint64_t startNS) noexcept {
+            if (startNS != 0) {
+                const uint64_t now = telemetryNowNS();
+                Record(now > startNS ? now - startNS : 0);
+            }
+        }
+
+        /*
+        * Resets the histogram, not synchronized with concurrent Record calls.
+        */
+        void Reset() noexcept {
+            for (auto& b : m_bins) {
+                b.store(0, std::memory_order_relaxed);
+            }
+            m_count = 0;
+            m_max = 0;
+        }
+
+        /*
+        * Gets a latency percentile.
+        *
+        * @param p Percentile in [0, 1].
+        *
+        * @return Upper bound of the bin holding the percentile, clamped to the max value.
+        */
+        uint64_t Percentile(double p) const noexcept {
+            const uint64_t count = m_count.load(std::memory_order_relaxed);
+            if (count == 0) {
+                return 0;
+            }
+
+            const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * count)));
+            uint64_t seen = 0;
+            for (uint32_t i = 0; i < cBins; i++) {
+                seen += m_bins[i].load(std::memory_order_relaxed);
+                if (seen >= target) {
+                    return std::min(binUpper(i), m_max.load(std::memory_order_relaxed));
+                }
+            }
+            return m_max.load(std::memory_order_relaxed);
+        }
+
+        /*
+        * Gets count, p50, p99 and max.
+        *
+        * @return Latency summary.
+        */
+        LatencySummary Summary() const noexcept {
+            return LatencySummary {
+                .count = m_count.load(std::memory_order_relaxed),
+                .p50NS = Percentile(0.50),
+                .p99NS = Percentile(0.99),
+                .maxNS = m_max.load(std::memory_order_relaxed),
+            };
+        }
+
+    private:
+        static uint32_t binIndex(uint64_t v) noexcept {
+            if (v < cSubBins) {
+                return static_cast<uint32_t>(v);
+            }
+            const uint32_t msb = std::bit_width(v) - 1;
+            const uint32_t sub = static_cast<uint32_t>(v >> (msb - cSubBits)) & (cSubBins - 1);
+            return (msb - cSubBits + 1) * cSubBins + sub;
+        }
+
+        static uint64_t binUpper(uint32_t idx) noexcept {
+            if (idx < cSubBins) {
+                return idx;
+            }
+            const uint32_t msb = idx / cSubBins + cSubBits - 1;
+            const uint64_t sub = idx % cSubBins;
+            const uint64_t width = uint64_t(1) << (msb - cSubBits);
+            return (uint64_t(1) << msb) + (sub + 1) * width - 1;
+        }
+};
+
+
+/*
+* Number of gaps of a size range.
+*/
+struct GapBucket {
+    uint64_t min{0};
+    uint64_t max{0};
+    uint64_t count{0};
+};
+
+/*
+* Lock free histogram of frame number gaps, power of two buckets [1], [2, 3], [4, 7], ...
+*/
+class GapHistogram {
+    private:
+        static constexpr uint32_t cBuckets = 32;
+        std::atomic<uint64_t> m_buckets[cBuckets]{};
+
+    public:
+        /*
+        * Records one gap.
+        *
+        * @param gap Number of consecutive missing frames, ignored if 0.
+        */
+        void Record(uint64_t gap) noexcept {
+            if (gap > 0) {
+                const uint32_t idx = std::min<uint32_t>(std::bit_width(gap) - 1, cBuckets - 1);
+                m_buckets[idx].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        /*
+        * Resets the histogram.
+        */
+        void Reset() noexcept {
+            for (auto& b : m_buckets) {
+                b.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        /*
+        * Non empty buckets.
+        *
+        * @return Buckets with at least one gap.
+        */
+        std::vector<GapBucket> Buckets() const {
+            std::vector<GapBucket> buckets;
+            for (uint32_t i = 0; i < cBuckets; i++) {
+                const uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+                if (count > 0) {
+                    buckets.push_back(GapBucket {
+                        .min = uint64_t(1) << i,
+                        .max = (i == cBuckets - 1) ? ~uint64_t(0) : (uint64_t(2) << i) - 1,
+                        .count = count,
+                    });
+                }
+            }
+            return buckets;
+        }
+};
+
+#endif //TELEMETRY_H
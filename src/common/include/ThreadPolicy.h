@@ -0,0 +1,277 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  ThreadPolicy.h
+ * 
+ * Definition of the per role thread affinity and priority settings.
+ *********************************************************************/
+#ifndef THREAD_POLICY_H
+#define THREAD_POLICY_H
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <fmt/ranges.h>
+
+#ifdef _WIN64
+#ifndef NOMINMAX
+#define NOMINMAX // keep std::min/std::max usable in headers including this one
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+/*
+* Thread roles that can be given their own cores and priority.
+*/
+enum class ThreadRole : uint8_t {
+    None,
+    Capture,    // camera callback and frame processing thread
+    Copy,       // acquisition frame copy executor
+    Processing, // frame processing stage workers
+    Writer,     // async file writer threads
+    LiveView,   // live view stats and lut executor
+    Pool,       // app wide thread pool, auto tiling and post processing
+    Ui,         // gui thread
+};
+
+/*
+* Number of ThreadRole values.
+*/
+constexpr size_t cThreadRoles = 8;
+
+/*
+* Thread priority, from lowest to highest.
+*/
+enum class ThreadPriority : uint8_t {
+    Idle,
+    Lowest,
+    BelowNormal,
+    Normal,
+    AboveNormal,
+    Highest,
+    TimeCritical,
+};
+
+/*
+* Cores and priority for the threads of one role.
+*/
+struct ThreadPolicy {
+    std::vector<uint32_t> cores{}; // empty to run on any core
+    ThreadPriority priority{ThreadPriority::Normal};
+
+    bool IsDefault() const noexcept { return cores.empty() && priority == ThreadPriority::Normal; }
+};
+
+/*
+* Name of a thread role as used in the [threads] section of nautilai.toml.
+*
+* @param role The role.
+*/
+inline const char* ThreadRoleName(ThreadRole role) noexcept {
+    constexpr std::array<const char*, cThreadRoles> names = {
+        "none", "capture", "copy", "processing", "writer", "live_view", "pool", "ui"
+    };
+    return names[static_cast<size_t>(role)];
+}
+
+/*
+* Name of a thread priority as used in nautilai.toml.
+*
+* @param priority The priority.
+*/
+inline const char* ThreadPriorityName(ThreadPriority priority) noexcept {
+    constexpr std::array<const char*, 7> names = {
+        "idle", "lowest", "below_normal", "normal", "above_normal", "highest", "time_critical"
+    };
+    return names[static_cast<size_t>(priority)];
+}
+
+/*
+* Parses a thread priority name.
+*
+* @param name The priority name.
+*
+* @return The priority or nullopt if the name is unknown.
+*/
+inline std::optional<ThreadPriority> ParseThreadPriority(std::string_view name) noexcept {
+    for (uint8_t p = 0; p <= static_cast<uint8_t>(ThreadPriority::TimeCritical); p++) {
+        if (name == ThreadPriorityName(static_cast<ThreadPriority>(p))) {
+            return static_cast<ThreadPriority>(p);
+        }
+    }
+    return std::nullopt;
+}
+
+namespace detail {
+    inline std::mutex& threadPolicyLock() {
+        static std::mutex lock;
+        return lock;
+    }
+
+    inline std::array<ThreadPolicy, cThreadRoles>& threadPolicies() {
+        static std::array<ThreadPolicy, cThreadRoles> policies{};
+        return policies;
+    }
+}
+
+/*
+* Sets the policy threads of a role apply when they start.
+*
+* @param role The role.
+* @param policy Cores and priority for the role.
+*/
+inline void SetThreadPolicy(ThreadRole role, const ThreadPolicy& policy) {
+    std::lock_guard<std::mutex> lock(detail::threadPolicyLock());
+    detail::threadPolicies()[static_cast<size_t>(role)] = policy;
+}
+
+/*
+* Gets the policy of a role.
+*
+* @param role The role.
+*/
+inline ThreadPolicy GetThreadPolicy(ThreadRole role) {
+    std::lock_guard<std::mutex> lock(detail::threadPolicyLock());
+    return detail::threadPolicies()[static_cast<size_t>(role)];
+}
+
+/*
+* Applies the policy of a role to the calling thread.
+*
+* Does nothing for roles left at the default policy. Failures, e.g. missing
+* permission to raise the priority, are logged and leave the thread as is.
+*
+* @param role The role of the calling thread.
+*
+* @return true if the policy was applied, false otherwise.
+*/
+inline bool ApplyThreadPolicy(ThreadRole role) noexcept {
+    if (role == ThreadRole::None) {
+        return true;
+    }
+
+    const ThreadPolicy policy = GetThreadPolicy(role);
+    if (policy.IsDefault()) {
+        return true;
+    }
+    bool ok = true;
+
+#ifdef _WIN64
+    if (!policy.cores.empty()) {
+        DWORD_PTR mask = 0;
+        for (uint32_t core : policy.cores) {
+            if (core < sizeof(DWORD_PTR) * 8) {
+                mask |= DWORD_PTR(1) << core;
+            }
+        }
+        if (mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0) {
+            spdlog::warn("Failed to set {} thread affinity to cores [{}], Error {}", ThreadRoleName(role), fmt::join(policy.cores, ", "), GetLastError());
+            ok = false;
+        }
+    }
+
+    constexpr std::array<int, 7> priorities = {
+        THREAD_PRIORITY_IDLE, THREAD_PRIORITY_LOWEST, THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL,
+        THREAD_PRIORITY_ABOVE_NORMAL, THREAD_PRIORITY_HIGHEST, THREAD_PRIORITY_TIME_CRITICAL
+    };
+    if (!SetThreadPriority(GetCurrentThread(), priorities[static_cast<size_t>(policy.priority)])) {
+        spdlog::warn("Failed to set {} thread priority to {}, Error {}", ThreadRoleName(role), ThreadPriorityName(policy.priority), GetLastError());
+        ok = false;
+    }
+#elif defined(__linux__)
+    if (!policy.cores.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (uint32_t core : policy.cores) {
+            if (core < CPU_SETSIZE) {
+                CPU_SET(core, &set);
+            }
+        }
+        const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            spdlog::warn("Failed to set {} thread affinity to cores [{}]: {}", ThreadRoleName(role), fmt::join(policy.cores, ", "), std::strerror(err));
+            ok = false;
+        }
+    }
+
+    // raising priority needs CAP_SYS_NICE (or RLIMIT_NICE), once it was refused
+    // threads asking for more than normal priority keep their default
+    static std::atomic<bool> raiseDenied{false};
+    const bool raise = policy.priority > ThreadPriority::Normal;
+    if (raise && raiseDenied.load(std::memory_order_relaxed)) {
+        return ok;
+    }
+
+    // idle and time critical change the scheduling class, the others set the thread's nice value
+    int err = 0;
+    switch (policy.priority) {
+        case ThreadPriority::Idle: {
+            sched_param param{ .sched_priority = 0 };
+            err = pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+        }
+        break;
+        case ThreadPriority::TimeCritical: {
+            sched_param param{ .sched_priority = sched_get_priority_max(SCHED_FIFO) - 1 };
+            err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        }
+        break;
+        default: {
+            constexpr std::array<int, 7> nice = { 19, 10, 5, 0, -5, -10, -15 };
+            if (setpriority(PRIO_PROCESS, static_cast<id_t>(gettid()), nice[static_cast<size_t>(policy.priority)]) != 0) {
+                err = errno;
+            }
+        }
+        break;
+    }
+    if (raise && (err == EPERM || err == EACCES)) {
+        if (!raiseDenied.exchange(true)) {
+            spdlog::warn("Raising thread priority needs CAP_SYS_NICE, threads above normal priority keep their default priority");
+        }
+    } else if (err != 0) {
+        spdlog::warn("Failed to set {} thread priority to {}: {}", ThreadRoleName(role), ThreadPriorityName(policy.priority), std::strerror(err));
+        ok = false;
+    }
+#else
+    spdlog::warn("Thread policies are not supported on this platform");
+    ok = false;
+#endif
+
+    return ok;
+}
+
+#endif //THREAD_POLICY_H
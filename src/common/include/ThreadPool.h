@@ -31,93 +31,282 @@
 #define __THREAD_POOL_H
 
 #include <atomic>
-#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#include <SpscQueue.h> // cCacheLineBytes, cpuRelax
+#include <ThreadPolicy.h>
 
 /**
  * @brief A convenient shorthand for the type of std::thread::hardware_concurrency(). Should evaluate to unsigned int.
  */
 using concurrency_t = std::invoke_result_t<decltype(std::thread::hardware_concurrency)>;
 
+/**
+ * @brief Work stealing thread pool.
+ *
+ * Every worker owns a Chase-Lev deque, tasks submitted from a worker go to the
+ * bottom of its own deque and tasks submitted from other threads go to a shared
+ * injection queue. Idle workers steal from the top of the other deques, then
+ * spin briefly and park on an epoch counter that every submit advances.
+ *
+ * Shared() is the app wide pool, acquisition, live view and post processing
+ * submit to it instead of creating their own threads.
+ */
 class ThreadPool {
     private:
-        /** @brief The total number of threads managed by pool */
-        concurrency_t m_threadCount{0};
+        using Task = std::function<void()>;
+
+        /** @brief Number of spin iterations before an idle worker parks */
+        static constexpr uint32_t cSpinIterations = 2048;
 
-        /** @brief A smart pointer to manage the memory allocated for the threads. */
-        std::unique_ptr<std::thread[]> m_threads{nullptr};
+        /** @brief Initial capacity of a worker deque, grows when full */
+        static constexpr int64_t cDequeCapacity = 256;
 
-        /** @brief Task mutex */
-        mutable std::mutex m_tasksMutex{};
+        /**
+         * @brief Chase-Lev work stealing deque.
+         *
+         * Only the owner pushes and pops at the bottom, any thread steals from the
+         * top. Arrays replaced by a grow are kept until the deque is destroyed since
+         * a concurrent thief may still read from them.
+         */
+        class WorkDeque {
+            private:
+                struct Array {
+                    int64_t capacity;
+                    std::unique_ptr<std::atomic<Task*>[]> slots;
 
-        /** @brief Finished tasks mutex */
-        mutable std::mutex m_tasksFinishedMutex{};
+                    explicit Array(int64_t cap) : capacity(cap), slots(std::make_unique<std::atomic<Task*>[]>(cap)) {}
+                    Task* Get(int64_t i) const noexcept { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+                    void Put(int64_t i, Task* t) noexcept { slots[i & (capacity - 1)].store(t, std::memory_order_relaxed); }
+                };
 
-        /** @brief Finished tasks mutex */
-        mutable std::mutex m_queueMutex{};
+                alignas(cCacheLineBytes) std::atomic<int64_t> m_top{0};
+                alignas(cCacheLineBytes) std::atomic<int64_t> m_bottom{0};
+                std::atomic<Array*> m_array{nullptr};
+                std::vector<std::unique_ptr<Array>> m_arrays;
 
-        /** @brief Task counter */
-        std::atomic<size_t> m_totalTasks{0};
+            public:
+                WorkDeque() {
+                    m_arrays.push_back(std::make_unique<Array>(cDequeCapacity));
+                    m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+                }
 
-        /** @brief Task ready condition variable */
-        std::condition_variable m_taskReady{};
+                /** @brief Push task at the bottom, owner only */
+                void Push(Task* task) noexcept {
+                    const int64_t b = m_bottom.load(std::memory_order_relaxed);
+                    const int64_t t = m_top.load(std::memory_order_acquire);
+                    Array* a = m_array.load(std::memory_order_relaxed);
 
-        /** @brief Task finished condition variable */
-        std::condition_variable m_tasksFinished{};
+                    if (b - t > a->capacity - 1) {
+                        m_arrays.push_back(std::make_unique<Array>(a->capacity * 2));
+                        Array* grown = m_arrays.back().get();
+                        for (int64_t i = t; i < b; i++) {
+                            grown->Put(i, a->Get(i));
+                        }
+                        m_array.store(grown, std::memory_order_release);
+                        a = grown;
+                    }
 
-        /** @brief Task queue */
-        std::queue<std::function<void()>> m_tasks{};
+                    a->Put(b, task);
+                    std::atomic_thread_fence(std::memory_order_release);
+                    m_bottom.store(b + 1, std::memory_order_relaxed);
+                }
+
+                /** @brief Pop task from the bottom, owner only */
+                Task* Pop() noexcept {
+                    const int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+                    Array* a = m_array.load(std::memory_order_relaxed);
+                    m_bottom.store(b, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    int64_t t = m_top.load(std::memory_order_relaxed);
+
+                    if (t > b) { //empty
+                        m_bottom.store(b + 1, std::memory_order_relaxed);
+                        return nullptr;
+                    }
+
+                    Task* task = a->Get(b);
+                    if (t == b) { //last task, race thieves for it
+                        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                            task = nullptr;
+                        }
+                        m_bottom.store(b + 1, std::memory_order_relaxed);
+                    }
+                    return task;
+                }
+
+                /** @brief Steal task from the top, any thread */
+                Task* Steal() noexcept {
+                    int64_t t = m_top.load(std::memory_order_acquire);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    const int64_t b = m_bottom.load(std::memory_order_acquire);
+
+                    if (t >= b) {
+                        return nullptr;
+                    }
+
+                    Array* a = m_array.load(std::memory_order_acquire);
+                    Task* task = a->Get(t);
+                    if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                        return nullptr;
+                    }
+                    return task;
+                }
+        };
+
+        /** @brief Worker that is running on the current thread, if any */
+        inline static thread_local ThreadPool* t_pool{nullptr};
+        inline static thread_local size_t t_workerId{0};
+
+        /** @brief Thread count for the shared pool, read once on first use */
+        inline static std::atomic<concurrency_t> s_sharedThreads{0};
+
+        /** @brief The total number of threads managed by pool */
+        concurrency_t m_threadCount{0};
+
+        /** @brief Thread policy role of the workers */
+        ThreadRole m_role{ThreadRole::None};
+
+        /** @brief Worker threads */
+        std::vector<std::thread> m_threads{};
+
+        /** @brief One deque per worker */
+        std::vector<std::unique_ptr<WorkDeque>> m_deques{};
+
+        /** @brief Tasks submitted from threads outside the pool */
+        std::mutex m_injectMutex{};
+        std::deque<Task*> m_inject{};
+        std::atomic<size_t> m_injectSize{0};
+
+        /** @brief Advanced by every submit and every finished task group, idle threads park on it */
+        alignas(cCacheLineBytes) std::atomic<uint64_t> m_epoch{0};
+
+        /** @brief Submitted tasks that have not finished */
+        alignas(cCacheLineBytes) std::atomic<size_t> m_totalTasks{0};
 
         /** @brief Atomic flag to control stopping worker threads */
         std::atomic<bool> m_running{false};
 
     public:
+        /**
+         * @brief Group of tasks that can be waited on together.
+         *
+         * Wait runs queued pool tasks on the calling thread until every task of
+         * the group finished, the destructor waits for the group so a group can
+         * not go out of scope with tasks still referring to it.
+         */
+        class TaskGroup {
+            private:
+                ThreadPool& m_pool;
+                std::atomic<size_t> m_pending{0};
+
+            public:
+                explicit TaskGroup(ThreadPool& pool) : m_pool(pool) {}
+                TaskGroup(const TaskGroup&) = delete;
+                TaskGroup& operator=(const TaskGroup&) = delete;
+
+                ~TaskGroup() {
+                    Wait();
+                }
+
+                /** @brief Add task with no return value to the group */
+                template <typename F, typename... A>
+                void Run(F&& fn, A&&... args) noexcept {
+                    m_pending.fetch_add(1, std::memory_order_relaxed);
+                    // the waiter may return and destroy the group as soon as pending hits
+                    // zero, so the decrement is the last access to the group and the
+                    // wake up goes through a copy of the pool pointer
+                    ThreadPool* pool = &m_pool;
+                    std::atomic<size_t>* pending = &m_pending;
+                    m_pool.push(new Task([pool, pending, task = std::bind(std::forward<F>(fn), std::forward<A>(args)...)]() mutable {
+                        task();
+                        if (pending->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                            pool->wake();
+                        }
+                    }));
+                }
+
+                /** @brief Wait for all tasks of the group */
+                void Wait() noexcept {
+                    m_pool.helpUntil([this]() { return m_pending.load(std::memory_order_acquire) == 0; });
+                }
+        };
+
         /*
         * @brief Constructor
         *
         * @param threads Number of threads to run the executor.
+        * @param role Thread policy role of the workers.
         */
-        ThreadPool(const concurrency_t threadCount = 0) : 
-            m_threadCount(determineThreadCount(threadCount)),
-            m_threads(std::make_unique<std::thread[]>(determineThreadCount(threadCount)))
-        {
+        ThreadPool(const concurrency_t threadCount = 0, ThreadRole role = ThreadRole::None) :
+            m_threadCount(determineThreadCount(threadCount)), m_role(role) {
             initThreads();
         }
 
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
         /** @brief Destructor */
         ~ThreadPool() {
             WaitForAll();
             destroyThreads();
         }
 
+        /**
+         * @brief App wide pool.
+         *
+         * Created on first use with the count set by SetSharedThreadCount,
+         * hardware concurrency if it was never set.
+         */
+        static ThreadPool& Shared() {
+            static ThreadPool pool(s_sharedThreads.load(), ThreadRole::Pool);
+            return pool;
+        }
+
+        /**
+         * @brief Set the thread count of the shared pool, has no effect once Shared() was called.
+         *
+         * @param threadCount Number of threads, 0 for hardware concurrency.
+         */
+        static void SetSharedThreadCount(const concurrency_t threadCount) noexcept {
+            s_sharedThreads = threadCount;
+        }
+
         /** @brief Add task with no return value */
         template <typename F, typename... A>
         void AddTask(F&& fn, A&&... args) noexcept {
-            {
-                std::unique_lock<std::mutex> _lock(m_tasksMutex);
-                std::function<void()> task = std::bind(std::forward<F>(fn), std::forward<A>(args)...);
-                m_tasks.push(task);
-                ++m_totalTasks;
-                m_taskReady.notify_one();
-            }
+            push(new Task(std::bind(std::forward<F>(fn), std::forward<A>(args)...)));
         }
 
-        /** @brief Wait for all running tasks */
+        /**
+         * @brief Submit task.
+         *
+         * @return Future holding the task result.
+         */
+        template <typename F, typename... A, typename R = std::invoke_result_t<std::decay_t<F>, std::decay_t<A>...>>
+        std::future<R> Submit(F&& fn, A&&... args) {
+            auto task = std::make_shared<std::packaged_task<R()>>(std::bind(std::forward<F>(fn), std::forward<A>(args)...));
+            std::future<R> result = task->get_future();
+            push(new Task([task]() { (*task)(); }));
+            return result;
+        }
+
+        /** @brief Wait for all submitted tasks, runs queued tasks on the calling thread meanwhile */
         void WaitForAll() noexcept {
-            std::unique_lock<std::mutex> _lock(m_tasksFinishedMutex);
-            if (m_totalTasks > 0 ) {
-                m_tasksFinished.wait(_lock, [this]() { return m_totalTasks == 0; });
-            }
+            helpUntil([this]() { return m_totalTasks.load(std::memory_order_acquire) == 0; });
         }
 
+        /** @brief Number of tasks waiting or running */
         size_t Size() noexcept {
-            std::unique_lock<std::mutex> _lock(m_tasksMutex);
-            return m_tasks.size();
+            return m_totalTasks.load(std::memory_order_relaxed);
         }
 
         concurrency_t ThreadCount() const {
@@ -142,40 +331,120 @@ class ThreadPool {
 
         /** @brief Initial threads */
         void initThreads() {
+            // workers check m_running on entry, set it first so they do not exit immediately
+            m_running = true;
             for (concurrency_t c = 0; c < m_threadCount; ++c) {
-                m_threads[c] = std::thread(&ThreadPool::worker, this, c+1);
+                m_deques.push_back(std::make_unique<WorkDeque>());
+            }
+            m_threads.reserve(m_threadCount);
+            for (concurrency_t c = 0; c < m_threadCount; ++c) {
+                m_threads.emplace_back(&ThreadPool::worker, this, c);
             }
-            m_running = true;
         }
 
         /** @brief destroy threads */
         void destroyThreads() {
             m_running = false;
-            m_taskReady.notify_all();
+            wake();
 
-            for (concurrency_t i = 0; i < m_threadCount; ++i) {
-                m_threads[i].join();
+            for (auto& t : m_threads) {
+                t.join();
             }
         }
 
-        /** @brief Thread worker loop */
-        void worker(size_t workerId) noexcept {
-            std::function<void()> task = {};
+        /** @brief Advance the epoch and wake parked threads */
+        void wake() noexcept {
+            m_epoch.fetch_add(1, std::memory_order_release);
+            m_epoch.notify_all();
+        }
 
-            std::unique_lock<std::mutex> lock(m_tasksMutex);
-            while (m_running) {
-                m_taskReady.wait(lock, [&]() { return !m_tasks.empty() || !m_running; });
+        /** @brief Queue task on this worker's deque or the injection queue */
+        void push(Task* task) noexcept {
+            m_totalTasks.fetch_add(1, std::memory_order_relaxed);
+            if (t_pool == this) {
+                m_deques[t_workerId]->Push(task);
+            } else {
+                std::unique_lock<std::mutex> lock(m_injectMutex);
+                m_inject.push_back(task);
+                m_injectSize.fetch_add(1, std::memory_order_release);
+            }
+            wake();
+        }
 
-                if (!m_tasks.empty()) {
-                    task = std::move(m_tasks.front());
-                    m_tasks.pop();
+        /** @brief Find a task, own deque first, then the injection queue, then steal */
+        Task* findTask() noexcept {
+            const bool isWorker = (t_pool == this);
+            if (isWorker) {
+                if (Task* task = m_deques[t_workerId]->Pop()) {
+                    return task;
+                }
+            }
 
-                    lock.unlock();
-                    task();
-                    lock.lock();
-                    if (--m_totalTasks == 0) { m_tasksFinished.notify_one(); }
+            if (m_injectSize.load(std::memory_order_acquire) > 0) {
+                std::unique_lock<std::mutex> lock(m_injectMutex);
+                if (!m_inject.empty()) {
+                    Task* task = m_inject.front();
+                    m_inject.pop_front();
+                    m_injectSize.fetch_sub(1, std::memory_order_relaxed);
+                    return task;
                 }
             }
+
+            const size_t start = isWorker ? t_workerId + 1 : 0;
+            for (size_t i = 0; i < m_deques.size(); i++) {
+                if (Task* task = m_deques[(start + i) % m_deques.size()]->Steal()) {
+                    return task;
+                }
+            }
+            return nullptr;
+        }
+
+        /** @brief Run and free a task */
+        void runTask(Task* task) noexcept {
+            (*task)();
+            delete task;
+            if (m_totalTasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                wake();
+            }
+        }
+
+        /**
+         * @brief Run queued tasks on the calling thread until done returns true.
+         *
+         * Parks on the epoch when there is nothing to run, every submit and
+         * every finished task group advances it.
+         */
+        template <typename P>
+        void helpUntil(P&& done) noexcept {
+            for (;;) {
+                const uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+                if (done()) {
+                    return;
+                }
+
+                if (Task* task = findTask()) {
+                    runTask(task);
+                    continue;
+                }
+
+                uint32_t spin = 0;
+                while (m_epoch.load(std::memory_order_acquire) == epoch && spin < cSpinIterations) {
+                    cpuRelax();
+                    ++spin;
+                }
+                m_epoch.wait(epoch, std::memory_order_acquire);
+            }
+        }
+
+        /** @brief Thread worker loop */
+        void worker(size_t workerId) noexcept {
+            t_pool = this;
+            t_workerId = workerId;
+            ApplyThreadPolicy(m_role);
+
+            helpUntil([this]() { return !m_running.load(std::memory_order_acquire); });
+
+            t_pool = nullptr;
         }
 };
 
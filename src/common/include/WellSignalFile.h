@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  WellSignalFile.h
+ * 
+ * Definition of the WellSignalFile class.
+ *********************************************************************/
+#ifndef WELL_SIGNAL_FILE_H
+#define WELL_SIGNAL_FILE_H
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#pragma pack(push, 1)
+/*
+* Header of a well signal file.
+*
+* The header is followed by wells WellSignalColumn entries and then by one
+* column of frameCount float32 mean intensities per well, in the order of the
+* column entries. Frames that were never recorded hold NaN.
+*/
+struct WellSignalHeader {
+    char magic[4]{'N', 'W', 'S', 'F'};
+    uint32_t version{1};
+    uint32_t wells{0};
+    uint64_t frameCount{0};
+    double fps{0.0};
+    uint32_t roiWidth{0};
+    uint32_t roiHeight{0};
+    uint32_t bitDepth{0};
+};
+
+/*
+* Well of a column, zero based row and column on the plate.
+*/
+struct WellSignalColumn {
+    uint16_t row{0};
+    uint16_t col{0};
+    uint64_t pixels{0}; // pixels averaged, 0 if the roi is outside the frame
+};
+#pragma pack(pop)
+
+
+/*
+* Per well mean intensity of every frame of a single stage position.
+*
+* Values are kept in memory by frame index while the position is acquired and
+* written column by column (time x well, one column per well) on Close, so
+* analysis can read a single well without touching the others.
+*/
+class WellSignalFile {
+    private:
+        std::filesystem::path m_path;
+        std::mutex m_lock;
+        bool m_open{false};
+
+        WellSignalHeader m_header{};
+        std::vector<WellSignalColumn> m_columns;
+        std::vector<float> m_values;
+
+    public:
+        /*
+        * WellSignalFile constructor.
+        *
+        * @param path Path of the well signal file.
+        * @param columns Well of each column, in the order means are passed to Record.
+        * @param frameCount Number of frames of the position.
+        * @param fps Frame rate of the acquisition.
+        * @param roiWidth Roi width in pixels.
+        * @param roiHeight Roi height in pixels.
+        * @param bitDepth Bit depth of the frames.
+        */
+        WellSignalFile(std::filesystem::path path, std::vector<WellSignalColumn> columns, uint64_t frameCount, double fps, uint32_t roiWidth, uint32_t roiHeight, uint8_t bitDepth) :
+            m_path(path), m_columns(std::move(columns)) {
+            m_header.wells = static_cast<uint32_t>(m_columns.size());
+            m_header.frameCount = frameCount;
+            m_header.fps = fps;
+            m_header.roiWidth = roiWidth;
+            m_header.roiHeight = roiHeight;
+            m_header.bitDepth = bitDepth;
+
+            m_values.assign(m_columns.size() * frameCount, std::numeric_limits<float>::quiet_NaN());
+            m_open = true;
+        }
+
+        /*
+        * WellSignalFile destructor, closes the file if still open.
+        */
+        ~WellSignalFile() {
+            Close();
+        }
+
+        WellSignalFile(const WellSignalFile&) = delete;
+        WellSignalFile& operator=(const WellSignalFile&) = delete;
+
+        /*
+        * Number of wells.
+        */
+        size_t Wells() const noexcept {
+            return m_columns.size();
+        }
+
+        /*
+        * Stores the well means of a frame, safe to call from multiple threads for different frames.
+        *
+        * @param index Frame index.
+        * @param means One mean per well, in column order.
+        *
+        * @return true if stored, false if the index is out of range.
+        */
+        bool Record(uint64_t index, const double* means) noexcept {
+            if (index >= m_header.frameCount) {
+                return false;
+            }
+
+            const size_t frames = m_header.frameCount;
+            for (size_t w = 0; w < m_columns.size(); w++) {
+                m_values[w * frames + index] = static_cast<float>(means[w]);
+            }
+            return true;
+        }
+
+        /*
+        * Writes the file, all Record calls must have returned.
+        */
+        void Close() {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_open) {
+                return;
+            }
+            m_open = false;
+
+            std::ofstream out(m_path, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                spdlog::error("Could not write well signals {}", m_path.string());
+                return;
+            }
+
+            out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+            out.write(reinterpret_cast<const char*>(m_columns.data()), m_columns.size() * sizeof(WellSignalColumn));
+            out.write(reinterpret_cast<const char*>(m_values.data()), m_values.size() * sizeof(float));
+
+            if (!out) {
+                spdlog::error("Short write of well signals {}", m_path.string());
+                return;
+            }
+            spdlog::info("Wrote well signals {}, wells: {}, frames: {}", m_path.string(), m_header.wells, m_header.frameCount);
+        }
+};
+
+#endif //WELL_SIGNAL_FILE_H
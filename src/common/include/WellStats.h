@@ -0,0 +1,218 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  WellStats.h
+ * 
+ * Definition of the streaming per well statistics classes.
+ *********************************************************************/
+#ifndef WELL_STATS_H
+#define WELL_STATS_H
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+/*
+* Running statistics of a series of values.
+*
+* The sum is Kahan compensated and the variance uses Welford's update, so
+* both stay accurate over long series without storing the values. Two
+* instances fed with different values can be merged.
+*/
+struct RunningStats {
+    uint64_t count{0};
+    double sum{0.0};
+    double compensation{0.0};
+    double mean{0.0};
+    double m2{0.0};
+    double min{std::numeric_limits<double>::infinity()};
+    double max{-std::numeric_limits<double>::infinity()};
+    uint64_t saturated{0};
+
+    /*
+    * Adds a value.
+    *
+    * @param x The value.
+    * @param saturatedPixels Saturated pixels that went into the value.
+    */
+    void Add(double x, uint64_t saturatedPixels = 0) noexcept {
+        count++;
+        kahanAdd(x, 0.0);
+
+        const double delta = x - mean;
+        mean += delta / double(count);
+        m2 += delta * (x - mean);
+
+        min = std::min(min, x);
+        max = std::max(max, x);
+        saturated += saturatedPixels;
+    }
+
+    /*
+    * Merges the values of another instance into this one.
+    *
+    * @param o The other instance.
+    */
+    void Merge(const RunningStats& o) noexcept {
+        if (o.count == 0) {
+            return;
+        }
+        if (count == 0) {
+            *this = o;
+            return;
+        }
+
+        const double n = double(count) + double(o.count);
+        const double delta = o.mean - mean;
+        mean += delta * double(o.count) / n;
+        m2 += o.m2 + delta * delta * double(count) * double(o.count) / n;
+        count += o.count;
+        kahanAdd(o.sum, o.compensation);
+
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+        saturated += o.saturated;
+    }
+
+    /*
+    * Mean of the values, from the compensated sum.
+    */
+    double Mean() const noexcept {
+        return count ? (sum - compensation) / double(count) : 0.0;
+    }
+
+    /*
+    * Sample variance of the values.
+    */
+    double Variance() const noexcept {
+        return (count > 1) ? m2 / double(count - 1) : 0.0;
+    }
+
+    /*
+    * Sample standard deviation of the values.
+    */
+    double StdDev() const noexcept {
+        return std::sqrt(Variance());
+    }
+
+    private:
+        void kahanAdd(double x, double xCompensation) noexcept {
+            const double y = x - xCompensation - compensation;
+            const double t = sum + y;
+            compensation = (t - sum) - y;
+            sum = t;
+        }
+};
+
+
+/*
+* Streaming statistics of the per frame mean of every well.
+*
+* Only frames inside the kept window are added, the first and last trim
+* fraction of frame indices are dropped. Frames can be added from several
+* threads at once, they are spread over a few independently locked sets of
+* accumulators that are merged by Summary, so memory is constant in the
+* number of frames.
+*/
+class WellAccumulators {
+    private:
+        struct Stripe {
+            std::mutex lock;
+            std::vector<RunningStats> wells;
+        };
+
+        uint64_t m_first{0}, m_last{0};
+        std::vector<std::unique_ptr<Stripe>> m_stripes;
+
+    public:
+        /*
+        * WellAccumulators constructor.
+        *
+        * @param wells Number of wells.
+        * @param frameCount Number of frames that will be recorded.
+        * @param trim Fraction of frames dropped at the start and at the end.
+        * @param stripes Number of accumulator sets, about the number of threads adding frames.
+        */
+        WellAccumulators(size_t wells, uint64_t frameCount, double trim = 0.1, size_t stripes = 4) {
+            const uint64_t n = static_cast<uint64_t>(std::clamp(trim, 0.0, 0.5) * double(frameCount));
+            m_first = n;
+            m_last = (frameCount > n) ? frameCount - n : 0;
+
+            m_stripes.resize(std::max<size_t>(1, stripes));
+            for (auto& s : m_stripes) {
+                s = std::make_unique<Stripe>();
+                s->wells.resize(wells);
+            }
+        }
+
+        WellAccumulators(const WellAccumulators&) = delete;
+        WellAccumulators& operator=(const WellAccumulators&) = delete;
+
+        /*
+        * Adds the means of a contiguous range of wells for one frame.
+        *
+        * @param frameIndex Frame index, frames outside the kept window are ignored.
+        * @param firstWell Well of means[0].
+        * @param means Per well mean intensity.
+        * @param saturated Optional, saturated pixels per well.
+        * @param count Number of wells in means.
+        *
+        * @return true if the frame was added.
+        */
+        bool Add(uint64_t frameIndex, size_t firstWell, const double* means, const uint64_t* saturated, size_t count) {
+            if (frameIndex < m_first || frameIndex >= m_last) {
+                return false;
+            }
+
+            Stripe& stripe = *m_stripes[frameIndex % m_stripes.size()];
+            std::lock_guard<std::mutex> lock(stripe.lock);
+
+            count = std::min(count, stripe.wells.size() - std::min(firstWell, stripe.wells.size()));
+            for (size_t w = 0; w < count; w++) {
+                stripe.wells[firstWell + w].Add(means[w], saturated ? saturated[w] : 0);
+            }
+            return true;
+        }
+
+        /*
+        * Statistics of every well over the kept frames added so far.
+        */
+        std::vector<RunningStats> Summary() {
+            std::vector<RunningStats> out(m_stripes[0]->wells.size());
+            for (auto& s : m_stripes) {
+                std::lock_guard<std::mutex> lock(s->lock);
+                for (size_t w = 0; w < out.size(); w++) {
+                    out[w].Merge(s->wells[w]);
+                }
+            }
+            return out;
+        }
+};
+
+#endif //WELL_STATS_H
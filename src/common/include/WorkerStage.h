@@ -0,0 +1,288 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  WorkerStage.h
+ * 
+ * Definition of the WorkerStage class.
+ *********************************************************************/
+#ifndef WORKER_STAGE_H
+#define WORKER_STAGE_H
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <ThreadPolicy.h>
+
+/*
+* Pipeline stage counters.
+*
+* Queue fields are zero for stages without a queue.
+*/
+struct StageStats {
+    size_t depth{0};
+    size_t capacity{0};
+    size_t highWater{0};
+    uint64_t processed{0};
+    uint64_t serviceTotalNS{0};
+    uint64_t serviceMaxNS{0};
+
+    /*
+    * Mean service time.
+    *
+    * @return Mean time spent per item in microseconds.
+    */
+    double ServiceMeanUS() const {
+        return processed ? (serviceTotalNS / 1000.0) / processed : 0.0;
+    }
+};
+
+
+/*
+* Service time accumulator, safe to update from multiple threads.
+*/
+class ServiceTime {
+    private:
+        std::atomic<uint64_t> m_count{0};
+        std::atomic<uint64_t> m_totalNS{0};
+        std::atomic<uint64_t> m_maxNS{0};
+
+    public:
+        /*
+        * Records one serviced item.
+        *
+        * @param ns Service time in nanoseconds.
+        */
+        void Record(uint64_t ns) noexcept {
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            m_totalNS.fetch_add(ns, std::memory_order_relaxed);
+
+            uint64_t max = m_maxNS.load(std::memory_order_relaxed);
+            while (ns > max && !m_maxNS.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+        }
+
+        /*
+        * Records one serviced item started at start.
+        *
+        * @param start Time the item was started.
+        */
+        void Record(std::chrono::steady_clock::time_point start) noexcept {
+            Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        /*
+        * Resets counters.
+        */
+        void Reset() noexcept {
+            m_count = 0;
+            m_totalNS = 0;
+            m_maxNS = 0;
+        }
+
+        /*
+        * Fills the service time fields of stats.
+        *
+        * @param stats Stats to fill.
+        */
+        void Fill(StageStats& stats) const noexcept {
+            stats.processed = m_count.load(std::memory_order_relaxed);
+            stats.serviceTotalNS = m_totalNS.load(std::memory_order_relaxed);
+            stats.serviceMaxNS = m_maxNS.load(std::memory_order_relaxed);
+        }
+};
+
+
+/*
+* Pipeline stage with a bounded queue served by a fixed number of worker threads.
+*
+* Push blocks while the queue is full so a slow stage applies back pressure
+* to the stage in front of it instead of growing without bound.
+*
+* @tparam T Item type.
+*/
+template<typename T>
+class WorkerStage {
+    private:
+        std::string m_name;
+        std::function<void(T&)> m_fn;
+        ThreadRole m_role{ThreadRole::None};
+
+        std::mutex m_lock;
+        std::condition_variable m_notEmpty;
+        std::condition_variable m_notFull;
+        std::condition_variable m_idle;
+        std::vector<T> m_items;
+        size_t m_head{0};
+        size_t m_count{0};
+        size_t m_active{0};
+        size_t m_highWater{0};
+        bool m_running{true};
+
+        ServiceTime m_serviceTime;
+        std::vector<std::thread> m_workers;
+
+    public:
+        /*
+        * WorkerStage constructor, starts the workers.
+        *
+        * @param name Stage name used for logging.
+        * @param capacity Maximum number of queued items.
+        * @param workers Number of worker threads.
+        * @param fn Function called by the workers for each item, must be thread safe if workers > 1.
+        * @param role Thread policy role of the workers.
+        */
+        WorkerStage(std::string name, size_t capacity, size_t workers, std::function<void(T&)> fn, ThreadRole role = ThreadRole::None) :
+            m_name(name), m_fn(fn), m_role(role), m_items(std::max<size_t>(1, capacity)) {
+            workers = std::max<size_t>(1, workers);
+            for (size_t i = 0; i < workers; i++) {
+                m_workers.emplace_back(&WorkerStage::worker, this);
+            }
+            spdlog::info("Started {} stage, workers: {}, queue capacity: {}", m_name, workers, m_items.size());
+        }
+
+        /*
+        * WorkerStage destructor, finishes queued items and joins the workers.
+        */
+        ~WorkerStage() {
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_running = false;
+            }
+            m_notEmpty.notify_all();
+            m_notFull.notify_all();
+
+            for (auto& t : m_workers) {
+                t.join();
+            }
+        }
+
+        WorkerStage(const WorkerStage&) = delete;
+        WorkerStage& operator=(const WorkerStage&) = delete;
+
+        /*
+        * Queues an item, blocks while the queue is full.
+        *
+        * @param item The item.
+        *
+        * @return true if queued, false if the stage is shutting down.
+        */
+        bool Push(T item) {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_notFull.wait(lock, [this]() { return m_count < m_items.size() || !m_running; });
+            if (!m_running) {
+                return false;
+            }
+
+            m_items[(m_head + m_count) % m_items.size()] = std::move(item);
+            m_highWater = std::max(m_highWater, ++m_count);
+            m_notEmpty.notify_one();
+            return true;
+        }
+
+        /*
+        * Blocks until all queued items have been processed.
+        */
+        void Drain() {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_idle.wait(lock, [this]() { return m_count == 0 && m_active == 0; });
+        }
+
+        /*
+        * Number of worker threads.
+        *
+        * @return Worker count.
+        */
+        size_t Workers() const noexcept {
+            return m_workers.size();
+        }
+
+        /*
+        * Queue occupancy and service time of this stage.
+        *
+        * @return Stage counters.
+        */
+        StageStats Stats() {
+            StageStats stats;
+            m_serviceTime.Fill(stats);
+
+            std::unique_lock<std::mutex> lock(m_lock);
+            stats.depth = m_count;
+            stats.capacity = m_items.size();
+            stats.highWater = m_highWater;
+            return stats;
+        }
+
+        /*
+        * Resets high water mark and service time counters.
+        */
+        void ResetStats() {
+            m_serviceTime.Reset();
+
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_highWater = m_count;
+        }
+
+    private:
+        /*
+        * Worker loop, runs until the stage is destroyed and the queue is empty.
+        */
+        void worker() noexcept {
+            ApplyThreadPolicy(m_role);
+
+            std::unique_lock<std::mutex> lock(m_lock);
+            for (;;) {
+                m_notEmpty.wait(lock, [this]() { return m_count > 0 || !m_running; });
+                if (m_count == 0) {
+                    return;
+                }
+
+                T item = std::move(m_items[m_head]);
+                m_head = (m_head + 1) % m_items.size();
+                --m_count;
+                ++m_active;
+                m_notFull.notify_one();
+
+                lock.unlock();
+                const auto start = std::chrono::steady_clock::now();
+                m_fn(item);
+                m_serviceTime.Record(start);
+                lock.lock();
+
+                if (--m_active == 0 && m_count == 0) {
+                    m_idle.notify_all();
+                }
+            }
+        }
+};
+
+#endif //WORKER_STAGE_H
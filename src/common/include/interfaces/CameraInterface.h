@@ -61,6 +61,16 @@ enum StorageType {
 };
 
 
+/*
+* Defines what happens to a new frame when the frame pool is empty.
+*/
+enum class PoolPolicy : int32_t {
+    Block,      // wait up to a timeout for a frame to be released
+    DropNewest, // drop the new frame
+    DropOldest, // recycle the oldest frame waiting to be processed
+};
+
+
 /*
 * Defines a capture region for an exposure.
 */
@@ -130,6 +140,15 @@ struct ExpSettings {
     float colorWbScaleRed{ 1.0 };
     float colorWbScaleGreen{ 1.0 };
     float colorWbScaleBlue{ 1.0 };
+
+    bool zeroCopy{false};
+    uint64_t framePoolBytes{0};
+    PoolPolicy poolPolicy{PoolPolicy::DropNewest};
+    uint32_t poolTimeoutMS{0};
+    bool directIo{false};
+    uint32_t processingWorkers{2};
+    uint32_t processingQueueDepth{64};
+    uint32_t copyThreads{0};
 };
 
 
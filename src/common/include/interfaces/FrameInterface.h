@@ -47,6 +47,7 @@ struct FrameInfo {
             timestampEOF = other.timestampEOF;
             readoutTime = other.readoutTime;
             expTime = other.expTime;
+            callbackNS = other.callbackNS;
         }
         return *this;
     }
@@ -57,6 +58,7 @@ struct FrameInfo {
     uint32_t readoutTime{ 0 };
 
     uint32_t expTime{ 0 };
+    uint64_t callbackNS{ 0 }; // host time the eof callback fired, see telemetryNowNS
 };
 
 struct FrameCtx {
@@ -64,7 +66,7 @@ struct FrameCtx {
     int height{0};
     uint64_t index{0};
     uint8_t bitDepth{16};
-    std::filesystem::path path;
+    bool retained{false}; // set by the process function if it releases the frame itself
 };
 
 /*
@@ -77,6 +79,8 @@ concept FrameConcept = requires(T c, const T& f, T const cc, void* vptr, const F
     { c.SetData(vptr) } -> std::same_as<void>;
     { c.GetData() } -> std::same_as<void*>;
     { c.CopyData() } -> std::same_as<bool>;
+    { c.LeaseData() } -> std::same_as<bool>;
+    { c.EndLease() } -> std::same_as<void*>;
     { cc.GetInfo() } -> std::same_as<FrameInfo*>;
     { c.SetInfo(pFrameInfo) } -> std::same_as<void>;
     { c.Copy(f, bool()) } -> std::same_as<bool>;
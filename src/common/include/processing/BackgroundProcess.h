@@ -29,47 +29,354 @@
 #ifndef BACKGROUND_PROCESSING_H
 #define BACKGROUND_PROCESSING_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
 #include <pm/Camera.h>
 #include <interfaces/FrameInterface.h>
 #include <Rois.h>
+#include <Simd.h>
+#include <ThreadPool.h>
 
 namespace processing {
-    template<size_t XW, size_t YW>
-    double roiAvg(Rois::RoiCfg* roi, uint8_t* data, size_t x, size_t y, size_t width, uint8_t bitDepth) noexcept {
-        double out = 0.0;
-        uint8_t bytesPerPixel = bitDepth / 8;
+    /*
+    * Sums of a fixed set of equally sized rois, computed for all rois in one pass over a frame.
+    *
+    * Rois sharing a top row form a band. The rows of a band are added into per column
+    * sums once, a prefix sum over those columns then gives the sum of every roi in the
+    * band as the difference of two entries. Pixels outside every band are never read.
+    * Bands are independent and can be run on different threads.
+    */
+    class RoiEngine {
+        private:
+            struct Roi {
+                uint32_t band{0};
+                uint32_t x0{0}, x1{0};
+                uint64_t pixels{0};
+            };
 
-        uint8_t* dataStart = data + Rois::roiToOffset(x, y, width) * bytesPerPixel;
+            struct Band {
+                uint32_t y0{0}, y1{0};
+                uint32_t x0{0}, x1{0};
+                std::vector<uint32_t> rois;
+            };
 
-        for (size_t j = 0; j < YW; j++) {
-            for (size_t i = 0; i < XW; i++) {
-                if (bytesPerPixel == 1) {
-                    out += dataStart[i + j * width];
-                } else {
-                    out += ((uint16_t*)dataStart)[i + j * width];
+            uint32_t m_frameWidth{0}, m_frameHeight{0};
+            std::vector<Roi> m_rois;
+            std::vector<Band> m_bands;
+
+        public:
+            /*
+            * RoiEngine constructor for the rois of a plate format.
+            *
+            * @param roi Roi config, roi size in pixels is width / scale by height / scale.
+            * @param frameWidth Frame width.
+            * @param frameHeight Frame height.
+            */
+            RoiEngine(Rois::RoiCfg* roi, uint32_t frameWidth, uint32_t frameHeight) :
+                RoiEngine(Rois::roiOffsets(roi, frameWidth, frameHeight),
+                          static_cast<uint32_t>(std::ceil(roi->width / roi->scale)),
+                          static_cast<uint32_t>(std::ceil(roi->height / roi->scale)),
+                          frameWidth, frameHeight) {}
+
+            /*
+            * RoiEngine constructor.
+            *
+            * Rois are clipped to the frame.
+            *
+            * @param offsets Top left corner of each roi.
+            * @param roiWidth Roi width in pixels.
+            * @param roiHeight Roi height in pixels.
+            * @param frameWidth Frame width.
+            * @param frameHeight Frame height.
+            */
+            RoiEngine(const std::vector<std::tuple<uint32_t, uint32_t>>& offsets, uint32_t roiWidth, uint32_t roiHeight, uint32_t frameWidth, uint32_t frameHeight) :
+                m_frameWidth(frameWidth), m_frameHeight(frameHeight) {
+                m_rois.resize(offsets.size());
+
+                for (size_t i = 0; i < offsets.size(); i++) {
+                    const auto [x, y] = offsets[i];
+                    const uint32_t y0 = std::min(y, frameHeight);
+                    const uint32_t y1 = static_cast<uint32_t>(std::min<uint64_t>(uint64_t(y) + roiHeight, frameHeight));
+
+                    auto band = std::find_if(m_bands.begin(), m_bands.end(), [&](const Band& b) { return b.y0 == y0 && b.y1 == y1; });
+                    if (band == m_bands.end()) {
+                        band = m_bands.insert(m_bands.end(), Band{ .y0 = y0, .y1 = y1, .x0 = frameWidth, .x1 = 0, .rois = {} });
+                    }
+
+                    Roi& r = m_rois[i];
+                    r.band = static_cast<uint32_t>(band - m_bands.begin());
+                    r.x0 = std::min(x, frameWidth);
+                    r.x1 = static_cast<uint32_t>(std::min<uint64_t>(uint64_t(x) + roiWidth, frameWidth));
+                    r.pixels = uint64_t(r.x1 - r.x0) * (y1 - y0);
+
+                    band->rois.push_back(static_cast<uint32_t>(i));
+                    if (r.x1 > r.x0) {
+                        band->x0 = std::min(band->x0, r.x0);
+                        band->x1 = std::max(band->x1, r.x1);
+                    }
+                }
+            }
+
+            /*
+            * Number of rois.
+            */
+            size_t Count() const noexcept {
+                return m_rois.size();
+            }
+
+            /*
+            * Number of bands, the unit of work Sums can be split in.
+            */
+            size_t Bands() const noexcept {
+                return m_bands.size();
+            }
+
+            /*
+            * Number of frame pixels inside a roi after clipping.
+            *
+            * @param roi Roi index.
+            */
+            uint64_t Pixels(size_t roi) const noexcept {
+                return m_rois[roi].pixels;
+            }
+
+            /*
+            * Sums the rois of a range of bands.
+            *
+            * Safe to call from several threads at once, rois of other bands are not written.
+            *
+            * @param data Frame data.
+            * @param bitDepth Bits per pixel in data, 8 or 16.
+            * @param sums Output, one entry per roi.
+            * @param firstBand First band.
+            * @param lastBand One past the last band.
+            * @param saturated Optional output, number of pixels of each roi at or above threshold.
+            * @param threshold Smallest saturated pixel value.
+            */
+            void Sums(const uint8_t* data, uint8_t bitDepth, uint64_t* sums, size_t firstBand, size_t lastBand, uint64_t* saturated = nullptr, uint32_t threshold = 0) const noexcept {
+                //per thread scratch, rows of a band summed per column and their prefix sum
+                thread_local std::vector<uint32_t> columns;
+                thread_local std::vector<uint32_t> over;
+                thread_local std::vector<uint64_t> prefix;
+
+                for (size_t b = firstBand; b < std::min(lastBand, m_bands.size()); b++) {
+                    const Band& band = m_bands[b];
+                    if (band.x1 <= band.x0 || band.y1 <= band.y0) {
+                        for (uint32_t r : band.rois) {
+                            sums[r] = 0;
+                            if (saturated) { saturated[r] = 0; }
+                        }
+                        continue;
+                    }
+
+                    const size_t n = band.x1 - band.x0;
+                    columns.assign(n, 0);
+                    if (saturated) { over.assign(n, 0); }
+                    prefix.resize(n + 1);
+
+                    for (uint32_t y = band.y0; y < band.y1; y++) {
+                        const size_t offset = size_t(y) * m_frameWidth + band.x0;
+                        if (bitDepth > 8) {
+                            const uint16_t* row = reinterpret_cast<const uint16_t*>(data) + offset;
+                            addRow(row, columns.data(), n);
+                            if (saturated) { countRow(row, over.data(), n, static_cast<uint16_t>(std::min<uint32_t>(threshold, 0xffff))); }
+                        } else {
+                            const uint8_t* row = data + offset;
+                            addRow(row, columns.data(), n);
+                            if (saturated) { countRow(row, over.data(), n, static_cast<uint8_t>(std::min<uint32_t>(threshold, 0xff))); }
+                        }
+                    }
+
+                    bandSums(band, columns, prefix, sums);
+                    if (saturated) {
+                        bandSums(band, over, prefix, saturated);
+                    }
                 }
             }
-        }
-        return out / double((XW * YW));
-    }
 
-    double roiAvgGeneric(Rois::RoiCfg* roi, uint8_t* data, size_t x, size_t y, size_t width, uint8_t bitDepth) noexcept {
-        double out = 0.0;
-        uint8_t bytesPerPixel = bitDepth / 8;
+            /*
+            * Sums all rois on the calling thread.
+            *
+            * @param data Frame data.
+            * @param bitDepth Bits per pixel in data, 8 or 16.
+            * @param sums Output, one entry per roi.
+            * @param saturated Optional output, number of pixels of each roi at or above threshold.
+            * @param threshold Smallest saturated pixel value.
+            */
+            void Sums(const uint8_t* data, uint8_t bitDepth, uint64_t* sums, uint64_t* saturated = nullptr, uint32_t threshold = 0) const noexcept {
+                Sums(data, bitDepth, sums, 0, m_bands.size(), saturated, threshold);
+            }
+
+            /*
+            * Sums all rois with the bands split across a thread pool.
+            *
+            * @param data Frame data.
+            * @param bitDepth Bits per pixel in data, 8 or 16.
+            * @param sums Output, one entry per roi.
+            * @param pool Pool running the bands, the calling thread helps until they are done.
+            * @param saturated Optional output, number of pixels of each roi at or above threshold.
+            * @param threshold Smallest saturated pixel value.
+            */
+            void Sums(const uint8_t* data, uint8_t bitDepth, uint64_t* sums, ThreadPool& pool, uint64_t* saturated = nullptr, uint32_t threshold = 0) const noexcept {
+                const size_t parts = std::min<size_t>(m_bands.size(), pool.ThreadCount() + 1);
+                if (parts <= 1) {
+                    Sums(data, bitDepth, sums, saturated, threshold);
+                    return;
+                }
+
+                ThreadPool::TaskGroup group(pool);
+                for (size_t p = 0; p < parts; p++) {
+                    group.Run([this, data, bitDepth, sums, saturated, threshold, p, parts]() {
+                        Sums(data, bitDepth, sums, p * m_bands.size() / parts, (p + 1) * m_bands.size() / parts, saturated, threshold);
+                    });
+                }
+                group.Wait();
+            }
 
-        uint8_t* dataStart = data + Rois::roiToOffset(x, y, width) * bytesPerPixel;
+            /*
+            * Mean pixel value of every roi.
+            *
+            * @param data Frame data.
+            * @param bitDepth Bits per pixel in data, 8 or 16.
+            * @param means Output, one entry per roi, 0 for rois outside the frame.
+            * @param pool Optional pool to split bands across.
+            * @param saturated Optional output, number of pixels of each roi at or above threshold.
+            * @param threshold Smallest saturated pixel value.
+            */
+            void Means(const uint8_t* data, uint8_t bitDepth, double* means, ThreadPool* pool = nullptr, uint64_t* saturated = nullptr, uint32_t threshold = 0) const noexcept {
+                thread_local std::vector<uint64_t> sums;
+                sums.resize(m_rois.size());
 
-        for (size_t j = 0; j < roi->height / roi->scale; j++) {
-            for (size_t i = 0; i < roi->width / roi->scale; i++) {
-                if (bytesPerPixel == 1) {
-                    out += dataStart[i + j * width];
+                if (pool) {
+                    Sums(data, bitDepth, sums.data(), *pool, saturated, threshold);
                 } else {
-                    out += ((uint16_t*)dataStart)[i + j * width];
+                    Sums(data, bitDepth, sums.data(), saturated, threshold);
+                }
+
+                for (size_t i = 0; i < m_rois.size(); i++) {
+                    means[i] = m_rois[i].pixels ? double(sums[i]) / double(m_rois[i].pixels) : 0.0;
+                }
+            }
+
+        private:
+            /*
+            * Roi sums of a band from its column sums.
+            */
+            void bandSums(const Band& band, const std::vector<uint32_t>& columns, std::vector<uint64_t>& prefix, uint64_t* out) const noexcept {
+                const size_t n = band.x1 - band.x0;
+                prefix[0] = 0;
+                for (size_t i = 0; i < n; i++) {
+                    prefix[i + 1] = prefix[i] + columns[i];
+                }
+
+                for (uint32_t r : band.rois) {
+                    const Roi& roi = m_rois[r];
+                    out[r] = (roi.x1 > roi.x0) ? prefix[roi.x1 - band.x0] - prefix[roi.x0 - band.x0] : 0;
+                }
+            }
+
+            /*
+            * Adds one row of 16 bit pixels to the column sums.
+            */
+            static void addRow(const uint16_t* px, uint32_t* columns, size_t n) noexcept {
+                size_t i = 0;
+#if defined(NAUTILAI_SIMD_AVX2)
+                for (; i + 16 <= n; i += 16) {
+                    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(px + i));
+                    __m256i* c = reinterpret_cast<__m256i*>(columns + i);
+                    _mm256_storeu_si256(c, _mm256_add_epi32(_mm256_loadu_si256(c), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v))));
+                    _mm256_storeu_si256(c + 1, _mm256_add_epi32(_mm256_loadu_si256(c + 1), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1))));
+                }
+#elif defined(NAUTILAI_SIMD_SSE2)
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 8 <= n; i += 8) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + i));
+                    __m128i* c = reinterpret_cast<__m128i*>(columns + i);
+                    _mm_storeu_si128(c, _mm_add_epi32(_mm_loadu_si128(c), _mm_unpacklo_epi16(v, zero)));
+                    _mm_storeu_si128(c + 1, _mm_add_epi32(_mm_loadu_si128(c + 1), _mm_unpackhi_epi16(v, zero)));
+                }
+#endif
+                for (; i < n; i++) {
+                    columns[i] += px[i];
+                }
+            }
+
+            /*
+            * Adds one row of 8 bit pixels to the column sums.
+            */
+            static void addRow(const uint8_t* px, uint32_t* columns, size_t n) noexcept {
+                size_t i = 0;
+#if defined(NAUTILAI_SIMD_AVX2)
+                for (; i + 16 <= n; i += 16) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + i));
+                    __m256i* c = reinterpret_cast<__m256i*>(columns + i);
+                    _mm256_storeu_si256(c, _mm256_add_epi32(_mm256_loadu_si256(c), _mm256_cvtepu8_epi32(v)));
+                    _mm256_storeu_si256(c + 1, _mm256_add_epi32(_mm256_loadu_si256(c + 1), _mm256_cvtepu8_epi32(_mm_srli_si128(v, 8))));
+                }
+#elif defined(NAUTILAI_SIMD_SSE2)
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 16 <= n; i += 16) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + i));
+                    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+                    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+                    __m128i* c = reinterpret_cast<__m128i*>(columns + i);
+                    _mm_storeu_si128(c, _mm_add_epi32(_mm_loadu_si128(c), _mm_unpacklo_epi16(lo, zero)));
+                    _mm_storeu_si128(c + 1, _mm_add_epi32(_mm_loadu_si128(c + 1), _mm_unpackhi_epi16(lo, zero)));
+                    _mm_storeu_si128(c + 2, _mm_add_epi32(_mm_loadu_si128(c + 2), _mm_unpacklo_epi16(hi, zero)));
+                    _mm_storeu_si128(c + 3, _mm_add_epi32(_mm_loadu_si128(c + 3), _mm_unpackhi_epi16(hi, zero)));
+                }
+#endif
+                for (; i < n; i++) {
+                    columns[i] += px[i];
+                }
+            }
+
+            /*
+            * Counts pixels of one row of 16 bit pixels at or above threshold per column.
+            */
+            static void countRow(const uint16_t* px, uint32_t* columns, size_t n, uint16_t threshold) noexcept {
+                size_t i = 0;
+#if defined(NAUTILAI_SIMD_AVX2)
+                const __m256i thr = _mm256_set1_epi16(short(threshold));
+                const __m256i one = _mm256_set1_epi16(1);
+                for (; i + 16 <= n; i += 16) {
+                    // threshold - v saturates to 0 exactly when v >= threshold
+                    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(px + i));
+                    const __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_subs_epu16(thr, v), _mm256_setzero_si256()), one);
+                    __m256i* c = reinterpret_cast<__m256i*>(columns + i);
+                    _mm256_storeu_si256(c, _mm256_add_epi32(_mm256_loadu_si256(c), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(hit))));
+                    _mm256_storeu_si256(c + 1, _mm256_add_epi32(_mm256_loadu_si256(c + 1), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(hit, 1))));
+                }
+#elif defined(NAUTILAI_SIMD_SSE2)
+                const __m128i thr = _mm_set1_epi16(short(threshold));
+                const __m128i one = _mm_set1_epi16(1);
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 8 <= n; i += 8) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + i));
+                    const __m128i hit = _mm_and_si128(_mm_cmpeq_epi16(_mm_subs_epu16(thr, v), zero), one);
+                    __m128i* c = reinterpret_cast<__m128i*>(columns + i);
+                    _mm_storeu_si128(c, _mm_add_epi32(_mm_loadu_si128(c), _mm_unpacklo_epi16(hit, zero)));
+                    _mm_storeu_si128(c + 1, _mm_add_epi32(_mm_loadu_si128(c + 1), _mm_unpackhi_epi16(hit, zero)));
+                }
+#endif
+                for (; i < n; i++) {
+                    columns[i] += (px[i] >= threshold);
+                }
+            }
+
+            /*
+            * Counts pixels of one row of 8 bit pixels at or above threshold per column.
+            */
+            static void countRow(const uint8_t* px, uint32_t* columns, size_t n, uint8_t threshold) noexcept {
+                for (size_t i = 0; i < n; i++) {
+                    columns[i] += (px[i] >= threshold);
                 }
             }
-        }
-        return out / double(((roi->width / roi->scale) * (roi->height / roi->scale)));
-    }
+    };
 }
 
 #endif //BACKGROUND_PROCESSING_H
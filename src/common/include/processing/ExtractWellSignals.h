@@ -0,0 +1,59 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Curi Bio
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*********************************************************************
+ * @file  ExtractWellSignals.h
+ *********************************************************************/
+#ifndef EXTRACT_WELL_SIGNALS_H
+#define EXTRACT_WELL_SIGNALS_H
+
+#include <vector>
+
+#include <interfaces/FrameInterface.h>
+#include <processing/BackgroundProcess.h>
+#include <WellSignalFile.h>
+
+namespace processing {
+    /*
+    * Records the mean intensity of every well of a frame.
+    *
+    * Must run before the frame is handed to the writer, the frame may be
+    * released once an async write completed.
+    *
+    * @param ctx Frame context, ctx->index selects the row in the well signals.
+    * @param frame The frame.
+    * @param rois Roi engine with one roi per well column of signals.
+    * @param wells Well signal file of the current position.
+    */
+    template<FrameConcept F>
+    void extractWellSignals(const FrameCtx* ctx, F* frame, const RoiEngine& rois, WellSignalFile* wells) noexcept {
+        thread_local std::vector<double> means;
+        means.resize(rois.Count());
+
+        rois.Means(static_cast<const uint8_t*>(frame->GetData()), ctx->bitDepth, means.data());
+        wells->Record(ctx->index, means.data());
+    }
+}
+
+#endif //EXTRACT_WELL_SIGNALS_H
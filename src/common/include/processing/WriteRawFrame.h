@@ -28,15 +28,33 @@
 #ifndef WRITE_RAW_FRAME_H
 #define WRITE_RAW_FRAME_H
 
+#include <functional>
+
 #include <pm/Camera.h>
 #include <interfaces/FrameInterface.h>
+#include <AsyncFileWriter.h>
+#include <RawStreamFile.h>
 
 namespace processing {
+    /*
+    * Writes frame to the raw stream of the current position.
+    *
+    * With an async writer the frame is retained (ctx->retained) until the write
+    * completed and is then handed back through release.
+    *
+    * @param ctx Frame context.
+    * @param frame The frame to write.
+    * @param stream Raw stream file for the current position.
+    * @param writer Async writer, nullptr to write synchronously.
+    * @param release Returns a retained frame to the acquisition, must outlive the stream.
+    */
     template<FrameConcept F>
-    void writeRawFrame(FrameCtx* ctx, F* frame) noexcept {
-        RawFile<4> raw(ctx->path, ctx->bitDepth, ctx->width, ctx->height);
-        raw.Write(frame->GetData(), 0);
-        raw.Close();
+    void writeRawFrame(FrameCtx* ctx, F* frame, RawStreamFile* stream, AsyncFileWriter* writer, const std::function<void(F*)>& release) noexcept {
+        if (writer) {
+            ctx->retained = stream->WriteAsync(ctx, frame, writer, release);
+        } else {
+            stream->Write(ctx, frame);
+        }
     }
 }
 
@@ -48,6 +48,24 @@ namespace Rois {
         return name + std::to_string(col+1);
     }
 
+    std::vector<std::tuple<uint32_t, uint32_t>> roiWells(RoiCfg* roi, size_t tile, size_t plateCols, bool vflip, bool hflip) {
+        std::vector<std::tuple<uint32_t, uint32_t>> wells = {};
+
+        //rois are in frame order, flips map them back to their place on the plate
+        for (size_t r = 0; r < roi->rows; r++) {
+            for (size_t c = 0; c < roi->cols; c++) {
+                size_t r_adj = (vflip) ? roi->rows - r - 1 : r;
+                size_t c_adj = (hflip) ? roi->cols - c - 1 : c;
+
+                uint32_t row = static_cast<uint32_t>(r_adj + roi->rows * (tile / plateCols));
+                uint32_t col = static_cast<uint32_t>(c_adj + roi->cols * (tile % plateCols));
+                wells.push_back(std::make_tuple(row, col));
+            }
+        }
+
+        return wells;
+    }
+
     uint32_t roiToOffset(uint32_t x, uint32_t y, uint32_t width) {
         return y * width + x;
     }